@@ -0,0 +1,96 @@
+////  VCSDKBenchSignal.h
+//  VoiceChangerSDKBenchmark
+//
+//  Synthetic test signals shared by the benchmarks, so that results don't
+//  depend on any audio files being around.
+//
+
+
+#ifndef VCSDKBenchSignal_h
+#define VCSDKBenchSignal_h
+
+#include <math.h>
+#include <vector>
+#include "VCSDKCoreType.h"
+
+
+namespace vcsdkbench {
+
+using vcsdkcore::SAMPLETYPE;
+
+
+enum SIGNAL_TYPE {
+    SIGNAL_SPEECH = 0,      ///< voiced speech-like: harmonics of a gliding f0 shaped by formants
+    SIGNAL_NOISE,           ///< white noise
+    SIGNAL_NUM_TYPES
+};
+
+
+inline const char *signalName(SIGNAL_TYPE type) {
+    return (type == SIGNAL_SPEECH) ? "speech" : "noise";
+}
+
+
+/// Converts a -1..1 value to the sample type in use
+inline SAMPLETYPE toSample(double value) {
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+    return (SAMPLETYPE)(value * 16384.0);
+#else
+    return (SAMPLETYPE)(value * 0.5);
+#endif
+}
+
+
+/** Generates 'numFrames' interleaved frames of the given signal type.
+ *
+ *  Speech: f0 glides between ~100 and ~220 Hz, harmonic amplitudes follow three
+ *  formant peaks (vowel-like, slowly moving) and a 4 Hz syllable envelope.
+ *  Channels of a stereo signal are slightly different so that stereo kernels
+ *  can't take shortcuts.
+ */
+inline void generateSignal(std::vector<SAMPLETYPE> &out, SIGNAL_TYPE type, int sampleRate, int channels, int numFrames) {
+    out.resize((size_t)numFrames * channels);
+
+    if (type == SIGNAL_NOISE) {
+        unsigned int seed = 22222;
+        for (size_t i = 0; i < out.size(); i ++) {
+            seed = seed * 1664525u + 1013904223u;
+            out[i] = toSample(((double)(seed >> 8) / (double)(1 << 24)) * 2.0 - 1.0);
+        }
+        return;
+    }
+
+    const double twoPi = 6.283185307179586;
+    double phase = 0;
+    for (int n = 0; n < numFrames; n ++) {
+        double t = (double)n / sampleRate;
+        double f0 = 160.0 + 60.0 * sin(twoPi * 0.7 * t);
+        double f1 = 600.0 + 200.0 * sin(twoPi * 1.3 * t);
+        double f2 = 1500.0 + 500.0 * sin(twoPi * 0.9 * t);
+        double f3 = 2600.0;
+        double envelope = 0.55 + 0.45 * sin(twoPi * 4.0 * t);
+
+        phase += twoPi * f0 / sampleRate;
+        if (phase > twoPi) phase -= twoPi;
+
+        double sum = 0;
+        int numHarmonics = (int)(0.5 * sampleRate / f0);
+        if (numHarmonics > 30) numHarmonics = 30;
+        for (int k = 1; k <= numHarmonics; k ++) {
+            double f = k * f0;
+            double a = exp(-((f - f1) * (f - f1)) / (2 * 150.0 * 150.0))
+                     + 0.6 * exp(-((f - f2) * (f - f2)) / (2 * 200.0 * 200.0))
+                     + 0.3 * exp(-((f - f3) * (f - f3)) / (2 * 250.0 * 250.0));
+            sum += a * sin(k * phase);
+        }
+        sum *= 0.25 * envelope;
+
+        for (int c = 0; c < channels; c ++) {
+            out[(size_t)n * channels + c] = toSample(sum * (1.0 - 0.1 * c));
+        }
+    }
+}
+
+}
+
+#endif /* VCSDKBenchSignal_h */
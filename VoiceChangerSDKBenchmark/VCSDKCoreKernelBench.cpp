@@ -0,0 +1,1171 @@
+////  VCSDKCoreKernelBench.cpp
+//  VoiceChangerSDKBenchmark
+//
+//  Micro-benchmark of the VCSDKCore DSP kernels, each driven in isolation on
+//  synthetic speech-like and noise signals, mono & stereo, 8/16/44.1/48 kHz.
+//
+//  Build with the CMakeLists.txt in the repository root & run:
+//
+//      cmake -S . -B build && cmake --build build -j
+//      build/vcsdk_kernelbench [minimum seconds per case, default 0.05] > kernels.csv
+//      build/vcsdk_kernelbench --check
+//
+//  --check runs only the checks described below, without timing (ctest test "kernelcheck").
+//
+//  Output is CSV, one row per case:
+//
+//      kernel,impl,signal,channels,sample_rate,param,frames,ns_per_sample,samples_per_sec
+//
+//  A "sample" is one frame, i.e. contains all channels, as everywhere in VCSDKCore.
+//  'impl' is "generic" for the plain C++ routines (all CPU extensions disabled) and
+//  "dispatch" for whatever newInstance() selects on this CPU, so that optimized
+//  kernels can be compared against the reference in the same run. Before timing,
+//  the TDStretch kernels (dispatched & below AVX2), anti-alias FIR (every SIMD
+//  tier), polyphase interpolator & anti-alias resampler are checked against the
+//  generic ones (int16: exact correlation, filtering & resampling, overlap within 1
+//  LSB, interpolation within 5 LSB; float: within rounding), the FFT &
+//  coarse-to-fine seeks against the full seek (same positions; correlation loss on
+//  speech), the routines for 4 & 6 channels against the mono routines run on each
+//  channel, segment-parallel processing with the fused anti-alias resampler against
+//  the single stream, the seam crossfades & the tail of 4 segments against the
+//  single stream's steps & fade-out, and the pipelined stages with the preset
+//  parameters against the synchronous pipeline; the program exits with 1 if any
+//  differ. vcsdk_kernelbench_float is the float build
+//  (SOUNDTOUCH_FLOAT_SAMPLES), and vcsdk_kernelbench_stats the VCSDKCORE_ENABLE_STATS
+//  build, where getStats must count every stage & FIFO, also with the stage worker
+//  threads.
+//  Set VCSDKCORE_CPU_TIER=generic/sse2/avx2/avx512 to cap what "dispatch" may use.
+//
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "VCSDKCore.h"
+#include "VCSDKCoreType.h"
+#include "VCSDKCoreCpu_detect.h"
+#include "VCSDKCoreTDStretch.hpp"
+#include "VCSDKCoreAAFilter.hpp"
+#include "VCSDKCoreFIFOSampleBuffer.hpp"
+#include "VCSDKCoreInterpolateLinear.hpp"
+#include "VCSDKCoreInterpolateCubic.hpp"
+#include "VCSDKCoreInterpolateShannon.hpp"
+#include "VCSDKCoreInterpolatePolyphase.hpp"
+#include "VCSDKCoreAAResampler.hpp"
+#include "VCSDKBenchSignal.h"
+
+using namespace vcsdkcore;
+using namespace vcsdkbench;
+
+
+/// The kernels are protected members. These helpers only form member pointers
+/// to them, the calls go to the real (possibly SIMD) instances so that virtual
+/// dispatch is the same as in the library.
+struct TDStretchAccess : public VCSDKCoreTDStretch {
+    typedef double (VCSDKCoreTDStretch::*CorrFunc)(const SAMPLETYPE *, const SAMPLETYPE *, double &) const;
+    typedef void (VCSDKCoreTDStretch::*OverlapFunc)(SAMPLETYPE *, const SAMPLETYPE *) const;
+    typedef void (VCSDKCoreTDStretch::*ClearFunc)();
+    typedef int (VCSDKCoreTDStretch::*SeekFunc)(const SAMPLETYPE *);
+
+    static CorrFunc corrFunc()              { return &TDStretchAccess::calcCrossCorr; }
+    static CorrFunc corrAccumulateFunc()    { return &TDStretchAccess::calcCrossCorrAccumulate; }
+    static OverlapFunc overlapMonoFunc()    { return &TDStretchAccess::overlapMono; }
+    static OverlapFunc overlapStereoFunc()  { return &TDStretchAccess::overlapStereo; }
+    static ClearFunc clearCorrStateFunc()   { return &TDStretchAccess::clearCrossCorrState; }
+    static SeekFunc seekFullFunc()          { return &TDStretchAccess::seekBestOverlapPositionFull; }
+    static SeekFunc seekFFTFunc()           { return &TDStretchAccess::seekBestOverlapPositionFFT; }
+    static SeekFunc seekHierarchicalFunc()  { return &TDStretchAccess::seekBestOverlapPositionHierarchical; }
+    static int VCSDKCoreTDStretch::*overlapLengthMember() { return &TDStretchAccess::overlapLength; }
+    static int VCSDKCoreTDStretch::*seekLengthMember()    { return &TDStretchAccess::seekLength; }
+    static SAMPLETYPE *VCSDKCoreTDStretch::*midBufferMember() { return &TDStretchAccess::pMidBuffer; }
+};
+
+
+struct TransposerAccess : public VCSDKCoreTransposerBase {
+    typedef int (VCSDKCoreTransposerBase::*TransposeFunc)(SAMPLETYPE *, const SAMPLETYPE *, int &);
+
+    static TransposeFunc monoFunc()     { return &TransposerAccess::transposeMono; }
+    static TransposeFunc stereoFunc() { return &TransposerAccess::transposeStereo; }
+    static TransposeFunc multiFunc()    { return &TransposerAccess::transposeMulti; }
+};
+
+
+struct ResamplerAccess : public VCSDKCoreAAResampler {
+    typedef int (VCSDKCoreAAResampler::*ResampleFunc)(SAMPLETYPE *, const SAMPLETYPE *, int &);
+
+    static ResampleFunc monoFunc()      { return &ResamplerAccess::resampleMono; }
+    static ResampleFunc stereoFunc()    { return &ResamplerAccess::resampleStereo; }
+    static ResampleFunc multiFunc()     { return &ResamplerAccess::resampleMulti; }
+};
+
+
+static double g_minSeconds = 0.05;
+
+// --check: only run the checks against the C++ routines, no timing
+static bool g_checkOnly = false;
+
+// Keeps the optimizer from dropping the benchmarked work
+static volatile double g_sink = 0;
+
+// Number of optimized kernel results that differ from the plain C++ routines
+static int g_failures = 0;
+
+
+struct BenchCase {
+    const char *kernel;
+    const char *impl;
+    SIGNAL_TYPE signal;
+    int channels;
+    int sampleRate;
+    const char *param;
+};
+
+
+/// Runs 'body' (which returns the number of frames it processed) until at least
+/// g_minSeconds have passed and prints the CSV row.
+template <class Body>
+static void run(const BenchCase &bc, Body body) {
+    typedef std::chrono::steady_clock Clock;
+    unsigned long long frames = 0;
+    double seconds = 0;
+
+    // warm up caches & branch predictors
+    body();
+
+    Clock::time_point start = Clock::now();
+    do {
+        for (int i = 0; i < 16; i ++) {
+            frames += body();
+        }
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (seconds < g_minSeconds);
+
+    double nsPerSample = seconds * 1e9 / (double)frames;
+    printf("%s,%s,%s,%d,%d,%s,%llu,%.3f,%.0f\n", bc.kernel, bc.impl, signalName(bc.signal),
+           bc.channels, bc.sampleRate, bc.param, frames, nsPerSample, 1e9 / nsPerSample);
+    fflush(stdout);
+}
+
+
+/// calcCrossCorr / calcCrossCorrAccumulate / full, FFT & coarse-to-fine seek / overlapMono / overlapStereo
+static void benchTDStretch(const char *impl, SIGNAL_TYPE signal, int channels, int sampleRate,
+                           const std::vector<SAMPLETYPE> &data) {
+    VCSDKCoreTDStretch *td = VCSDKCoreTDStretch::newInstance();
+    td->setChannels(channels);
+    td->setParameters(sampleRate, 40, 15, 8);
+
+    const int ovl = td->*TDStretchAccess::overlapLengthMember();
+    const int seek = td->*TDStretchAccess::seekLengthMember();
+    const int numFrames = (int)(data.size() / channels);
+    const SAMPLETYPE *compare = &data[0];
+    const SAMPLETYPE *scan = &data[(size_t)channels * (numFrames / 2)];
+
+    std::vector<SAMPLETYPE> output((size_t)ovl * channels);
+    BenchCase bc = {"", impl, signal, channels, sampleRate, "40/15/8ms"};
+
+    // full seek pass with calcCrossCorr at every offset
+    bc.kernel = "calcCrossCorr";
+    run(bc, [&]() -> unsigned long long {
+        double norm, sum = 0;
+        for (int i = 0; i < seek; i ++) {
+            sum += (td->*TDStretchAccess::corrFunc())(scan + channels * i, compare, norm);
+        }
+        (td->*TDStretchAccess::clearCorrStateFunc())();
+        g_sink += sum;
+        return (unsigned long long)seek * ovl;
+    });
+
+    // full seek pass the way seekBestOverlapPositionFull does it
+    bc.kernel = "calcCrossCorrAccumulate";
+    run(bc, [&]() -> unsigned long long {
+        double norm, sum;
+        sum = (td->*TDStretchAccess::corrFunc())(scan, compare, norm);
+        for (int i = 1; i < seek; i ++) {
+            sum += (td->*TDStretchAccess::corrAccumulateFunc())(scan + channels * i, compare, norm);
+        }
+        (td->*TDStretchAccess::clearCorrStateFunc())();
+        g_sink += sum;
+        return (unsigned long long)seek * ovl;
+    });
+
+    // the whole full seek, to compare the FFT seek against; SETTING_USE_FFT_SEEK
+    // falls back to this where it's the cheaper one
+    bc.kernel = "seekBestOverlapPositionFull";
+    run(bc, [&]() -> unsigned long long {
+        g_sink += (td->*TDStretchAccess::seekFullFunc())(scan);
+        return (unsigned long long)seek * ovl;
+    });
+
+    // the same full seek pass as one FFT cross-correlation
+    bc.kernel = "seekBestOverlapPositionFFT";
+    td->enableFFTSeek(TRUE);
+    run(bc, [&]() -> unsigned long long {
+        g_sink += (td->*TDStretchAccess::seekFFTFunc())(scan);
+        return (unsigned long long)seek * ovl;
+    });
+    td->enableFFTSeek(FALSE);
+
+    // the same seek range scanned coarse-to-fine
+    bc.kernel = "seekBestOverlapPositionHierarchical";
+    td->enableHierarchicalSeek(TRUE);
+    run(bc, [&]() -> unsigned long long {
+        g_sink += (td->*TDStretchAccess::seekHierarchicalFunc())(scan);
+        return (unsigned long long)seek * ovl;
+    });
+    td->enableHierarchicalSeek(FALSE);
+
+    if (channels <= 2) {
+        bc.kernel = (channels == 1) ? "overlapMono" : "overlapStereo";
+        TDStretchAccess::OverlapFunc func = (channels == 1) ? TDStretchAccess::overlapMonoFunc()
+                                                            : TDStretchAccess::overlapStereoFunc();
+        run(bc, [&]() -> unsigned long long {
+            for (int i = 0; i < 64; i ++) {
+                (td->*func)(&output[0], scan + channels * i);
+            }
+            g_sink += output[ovl / 2];
+            return (unsigned long long)64 * ovl;
+        });
+    }
+
+    delete td;
+}
+
+
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+// Integer correlation must match exactly. The MMX overlap routine shifts instead
+// of dividing, so allow it to round differently.
+static bool sameCorr(double a, double b, double)  { return a == b; }
+static const double OVERLAP_TOLERANCE = 1;
+// The SSE2 polyphase interpolator rounds the coefficients to 16 bits, each to within
+// 2^-16. For full-scale input that's at most POLYPHASE_TAPS * 32768 * 2^-16 = 4 LSB
+// in the sum, and rounding the sums to samples adds 1 LSB more between the two.
+// (The unity tap of phase 0 saturates to 32767, 1 LSB, but then the other taps
+// are zero.)
+static const double POLYPHASE_TOLERANCE = POLYPHASE_TAPS * 32768.0 / 65536.0 + 1;
+#else
+// Float SIMD routines sum in different order, so allow single precision rounding
+// relative to the magnitude 'scale' of the summed terms
+static bool sameCorr(double a, double b, double scale) { return fabs(a - b) <= 1e-4 * (fabs(a) + scale) + 1e-9; }
+static const double OVERLAP_TOLERANCE = 1e-5;
+static const double POLYPHASE_TOLERANCE = OVERLAP_TOLERANCE;
+#endif
+
+
+// Correlation loss of the coarse-to-fine seek against the full seek on speech, in
+// the mean & at worst; measured up to 0.5 % & 8 % at 16 kHz
+static const double HIERARCHICAL_SEEK_MEAN_LOSS = 0.02;
+static const double HIERARCHICAL_SEEK_MAX_LOSS = 0.12;
+
+
+/// Checks that the TDStretch kernels newInstance() selects, and those of the tier
+/// below AVX2, give the same results as the plain C++ routines, that the FFT seek
+/// finds the same positions as the full seek, and bounds the correlation loss of
+/// the coarse-to-fine seek against it. Mismatches are reported to stderr.
+static void checkTDStretch(SIGNAL_TYPE signal, int channels, int sampleRate, const std::vector<SAMPLETYPE> &data) {
+    static const uint disabled[3] = {0xffffffff, 0, SUPPORT_AVX2};
+    static const char *tierNames[3] = {"generic", "dispatch", "below avx2"};
+    VCSDKCoreTDStretch *td[3];
+
+    for (int t = 0; t < 3; t ++) {
+        disableExtensions(disabled[t]);
+        td[t] = VCSDKCoreTDStretch::newInstance();
+        td[t]->setChannels(channels);
+        td[t]->setParameters(sampleRate, 40, 15, 8);
+    }
+    disableExtensions(0);
+
+    const int ovl = td[0]->*TDStretchAccess::overlapLengthMember();
+    const int seek = td[0]->*TDStretchAccess::seekLengthMember();
+    const int numFrames = (int)(data.size() / channels);
+    const SAMPLETYPE *compare = &data[0];
+    const SAMPLETYPE *scan = &data[(size_t)channels * (numFrames / 2)];
+    std::vector<SAMPLETYPE> output[3];
+    double corr[3], norm[3];
+
+    for (int t = 0; t < 3; t ++) {
+        memcpy(td[t]->*TDStretchAccess::midBufferMember(), compare, sizeof(SAMPLETYPE) * ovl * channels);
+        output[t].resize((size_t)ovl * channels);
+    }
+
+    for (int t = 1; t < 3; t ++) {
+        VCSDKCoreTDStretch *pair[2] = {td[0], td[t]};
+
+        for (int i = 0; i < seek; i ++) {
+            for (int pass = 0; pass < 2; pass ++) {
+                corr[pass] = (pair[pass]->*TDStretchAccess::corrFunc())(scan + channels * i, compare, norm[pass]);
+                (pair[pass]->*TDStretchAccess::clearCorrStateFunc())();
+            }
+            if (!sameCorr(corr[0], corr[1], sqrt(norm[0])) || !sameCorr(norm[0], norm[1], norm[0])) {
+                fprintf(stderr, "FAIL calcCrossCorr %s %s %d ch %d Hz offset %d\n", tierNames[t],
+                        signalName(signal), channels, sampleRate, i);
+                g_failures ++;
+                break;
+            }
+        }
+
+        for (int pass = 0; pass < 2; pass ++) {
+            corr[pass] = (pair[pass]->*TDStretchAccess::corrFunc())(scan, compare, norm[pass]);
+        }
+        for (int i = 1; i < seek; i ++) {
+            for (int pass = 0; pass < 2; pass ++) {
+                corr[pass] = (pair[pass]->*TDStretchAccess::corrAccumulateFunc())(scan + channels * i, compare, norm[pass]);
+            }
+            if (!sameCorr(corr[0], corr[1], sqrt(norm[0])) || !sameCorr(norm[0], norm[1], norm[0])) {
+                fprintf(stderr, "FAIL calcCrossCorrAccumulate %s %s %d ch %d Hz offset %d\n", tierNames[t],
+                        signalName(signal), channels, sampleRate, i);
+                g_failures ++;
+                break;
+            }
+        }
+        for (int pass = 0; pass < 2; pass ++) {
+            (pair[pass]->*TDStretchAccess::clearCorrStateFunc())();
+        }
+    }
+
+    if (channels <= 2) {
+        TDStretchAccess::OverlapFunc func = (channels == 1) ? TDStretchAccess::overlapMonoFunc()
+                                                            : TDStretchAccess::overlapStereoFunc();
+        for (int t = 0; t < 3; t ++) {
+            (td[t]->*func)(&output[t][0], scan);
+        }
+        for (int t = 1; t < 3; t ++) {
+            double maxDiff = 0;
+            for (size_t i = 0; i < output[0].size(); i ++) {
+                double diff = fabs((double)output[0][i] - (double)output[t][i]);
+                if (diff > maxDiff) maxDiff = diff;
+            }
+            if (maxDiff > OVERLAP_TOLERANCE) {
+                fprintf(stderr, "FAIL %s %s %s %d Hz\n", (channels == 1) ? "overlapMono" : "overlapStereo",
+                        tierNames[t], signalName(signal), sampleRate);
+                g_failures ++;
+            }
+        }
+    }
+
+    // the seeks at positions spread over the signal, with the mid buffer taken one
+    // 40 ms sequence before the seek range
+    const int sequence = sampleRate * 40 / 1000;
+    const int numPositions = 64;
+    const int stride = (numFrames - sequence - seek - ovl) / numPositions;
+
+    // the FFT seek must find the same position as the full seek
+    for (int k = 0; k < numPositions; k ++) {
+        const SAMPLETYPE *mid = &data[(size_t)channels * k * stride];
+        const SAMPLETYPE *ref = mid + channels * (sequence - seek / 2);
+        int offs[2];
+
+        memcpy(td[1]->*TDStretchAccess::midBufferMember(), mid, sizeof(SAMPLETYPE) * ovl * channels);
+        offs[0] = (td[1]->*TDStretchAccess::seekFullFunc())(ref);
+        offs[1] = (td[1]->*TDStretchAccess::seekFFTFunc())(ref);
+        if (offs[0] != offs[1]) {
+            fprintf(stderr, "FAIL seekBestOverlapPositionFFT %s %d ch %d Hz: offset %d, full seek %d\n",
+                    signalName(signal), channels, sampleRate, offs[1], offs[0]);
+            g_failures ++;
+            break;
+        }
+    }
+
+    // the coarse-to-fine seek against the full seek. The loss is the shortfall of
+    // the seek score (the correlation weighted towards the middle of the range)
+    // relative to the full seek's. Only for voice, which the ~8 kHz coarse scan is
+    // meant for: white noise correlates above 4 kHz only by chance. Below 16 kHz
+    // the seek falls back to the full one.
+    if (signal == SIGNAL_SPEECH && sampleRate >= 16000) {
+        double sumLoss = 0, maxLoss = 0;
+
+        td[1]->enableHierarchicalSeek(TRUE);
+        for (int k = 0; k < numPositions; k ++) {
+            const SAMPLETYPE *mid = &data[(size_t)channels * k * stride];
+            const SAMPLETYPE *ref = mid + channels * (sequence - seek / 2);
+            int offs[2];
+            double score[2];
+
+            memcpy(td[1]->*TDStretchAccess::midBufferMember(), mid, sizeof(SAMPLETYPE) * ovl * channels);
+            offs[0] = (td[1]->*TDStretchAccess::seekFullFunc())(ref);
+            offs[1] = (td[1]->*TDStretchAccess::seekHierarchicalFunc())(ref);
+            for (int pass = 0; pass < 2; pass ++) {
+                double tmp = (double)(2 * offs[pass] - seek) / (double)seek;
+                double c = (td[0]->*TDStretchAccess::corrFunc())(ref + channels * offs[pass], mid, norm[0]);
+                score[pass] = (c + 0.1) * (1.0 - 0.25 * tmp * tmp);
+            }
+            (td[0]->*TDStretchAccess::clearCorrStateFunc())();
+            double loss = (score[0] > 0) ? (score[0] - score[1]) / score[0] : 0;
+            sumLoss += loss;
+            if (loss > maxLoss) maxLoss = loss;
+        }
+        td[1]->enableHierarchicalSeek(FALSE);
+        if (sumLoss / numPositions > HIERARCHICAL_SEEK_MEAN_LOSS || maxLoss > HIERARCHICAL_SEEK_MAX_LOSS) {
+            fprintf(stderr, "FAIL seekBestOverlapPositionHierarchical %s %d ch %d Hz: correlation loss mean %g, "
+                    "max %g\n", signalName(signal), channels, sampleRate, sumLoss / numPositions, maxLoss);
+            g_failures ++;
+        }
+    }
+
+    delete td[0];
+    delete td[1];
+    delete td[2];
+}
+
+
+/// Checks that the anti-alias FIR routines of each SIMD tier give the same output
+/// as the plain C++ routines (int16: exactly; float: within rounding), also for
+/// lengths & sample counts that leave a remainder to the blocked kernels
+static void checkFIR(SIGNAL_TYPE signal, int channels, int sampleRate, const std::vector<SAMPLETYPE> &data) {
+    static const uint disabled[4] = {0xffffffff, SUPPORT_SSE2 | SUPPORT_AVX2, SUPPORT_AVX2, 0};
+    static const char *tierNames[4] = {"generic", "mmx/sse", "sse2", "dispatch"};
+    static const uint lengths[2] = {64, 40};
+    static const uint blocks[2] = {4096, 4093};
+    std::vector<SAMPLETYPE> output[4];
+
+    for (int l = 0; l < 2; l ++) {
+        for (int b = 0; b < 2; b ++) {
+            uint count[4];
+
+            for (int t = 0; t < 4; t ++) {
+                disableExtensions(disabled[t]);
+                VCSDKCoreAAFilter filter(lengths[l]);
+                filter.setCutoffFreq(0.5 / 1.5);
+                output[t].assign((size_t)blocks[b] * channels, 0);
+                count[t] = filter.evaluate(&output[t][0], &data[0], blocks[b], (uint)channels);
+            }
+            disableExtensions(0);
+
+            for (int t = 1; t < 4; t ++) {
+                // the MMX & SSE stereo routines leave an odd last sample to the next batch
+                bool countOk = (count[t] == count[0]) || (channels == 2 && count[t] == (count[0] & ~1u));
+                double maxDiff = 0;
+
+                for (uint i = 0; i < count[t] * channels && countOk; i ++) {
+                    double diff = fabs((double)output[0][i] - (double)output[t][i]);
+                    if (diff > maxDiff) maxDiff = diff;
+                }
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+                if (!countOk || maxDiff > 0) {
+#else
+                if (!countOk || maxDiff > OVERLAP_TOLERANCE) {
+#endif
+                    fprintf(stderr, "FAIL %s %s %s %d Hz %u taps %u samples: count %u/%u, max difference %g\n",
+                            (channels == 1) ? "evaluateFilterMono" : "evaluateFilterStereo", tierNames[t],
+                            signalName(signal), sampleRate, lengths[l], blocks[b], count[t], count[0], maxDiff);
+                    g_failures ++;
+                }
+            }
+        }
+    }
+}
+
+
+/// Builds 'channels' interleaved channels of 'mono', each at a different offset
+static void interleaveChannels(std::vector<SAMPLETYPE> &dest, const std::vector<SAMPLETYPE> &mono, int channels) {
+    size_t frames = mono.size();
+
+    dest.resize(frames * channels);
+    for (size_t i = 0; i < frames; i ++) {
+        for (int c = 0; c < channels; c ++) {
+            dest[i * channels + c] = mono[(i + 97 * c) % frames];
+        }
+    }
+}
+
+
+/// Returns the largest difference between channel 'c' of 'multi' & 'mono'
+static double maxChannelDiff(const std::vector<SAMPLETYPE> &multi, int channels, int c,
+                             const std::vector<SAMPLETYPE> &mono, int count) {
+    double maxDiff = 0;
+
+    for (int i = 0; i < count; i ++) {
+        double diff = fabs((double)multi[(size_t)i * channels + c] - (double)mono[i]);
+        if (diff > maxDiff) maxDiff = diff;
+    }
+    return maxDiff;
+}
+
+
+static VCSDKCoreTransposerBase *newLinearInteger()  { return new InterpolateLinearInteger; }
+static VCSDKCoreTransposerBase *newLinearFloat()    { return new InterpolateLinearFloat; }
+static VCSDKCoreTransposerBase *newCubic()          { return new VCSDKCoreInterpolateCubic; }
+static VCSDKCoreTransposerBase *newShannon()        { return new InterpolateShannon; }
+static VCSDKCoreTransposerBase *newPolyphase()      { return VCSDKCoreInterpolatePolyphase::newInstance(); }
+
+
+/// Checks that the anti-alias FIR, interpolators & anti-alias resampler give the same
+/// output for 'channels' channels as the plain C++ mono routines run on each channel
+/// (int16: exactly, Shannon within 1 LSB, polyphase within POLYPHASE_TOLERANCE;
+/// float: within rounding). Both the plain
+/// C++ & the dispatched multichannel routines are checked.
+static void checkMultichannel(SIGNAL_TYPE signal, int channels, int sampleRate, const std::vector<SAMPLETYPE> &mono) {
+    typedef VCSDKCoreTransposerBase *(*TransposerFactory)();
+    static const TransposerFactory factories[5] = {newLinearInteger, newLinearFloat, newCubic, newShannon, newPolyphase};
+    static const char *names[5] = {"InterpolateLinearInteger", "InterpolateLinearFloat", "InterpolateCubic",
+                                   "InterpolateShannon", "InterpolatePolyphase"};
+    static const float rates[2] = {1.26f, 0.8f};
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+    static const double tolerances[5] = {0, 0, 0, 1, POLYPHASE_TOLERANCE};
+    const double filterTolerance = 0;
+#else
+    static const double tolerances[5] = {OVERLAP_TOLERANCE, OVERLAP_TOLERANCE, OVERLAP_TOLERANCE,
+                                         OVERLAP_TOLERANCE, OVERLAP_TOLERANCE};
+    const double filterTolerance = OVERLAP_TOLERANCE;
+#endif
+    const int block = 4096;
+    std::vector<SAMPLETYPE> input, channel, monoOutput, output;
+    const char *impl[2] = {"generic", "dispatch"};
+
+    interleaveChannels(input, mono, channels);
+    channel.resize(block);
+    monoOutput.resize((size_t)(block / 0.8f + 16));
+    output.resize((size_t)(block / 0.8f + 16) * channels);
+
+    for (int pass = 0; pass < 2; pass ++) {
+        // anti-alias filter, through the public evaluate() as in the library
+        {
+            double maxDiff = 0;
+            uint count, monoCount = 0;
+
+            disableExtensions((pass == 0) ? 0xffffffff : 0);
+            VCSDKCoreAAFilter filter(64);
+            disableExtensions(0xffffffff);
+            VCSDKCoreAAFilter monoFilter(64);
+            disableExtensions(0);
+            filter.setCutoffFreq(0.5 / 1.5);
+            monoFilter.setCutoffFreq(0.5 / 1.5);
+
+            count = filter.evaluate(&output[0], &input[0], block, (uint)channels);
+            for (int c = 0; c < channels; c ++) {
+                for (int i = 0; i < block; i ++) channel[i] = input[(size_t)i * channels + c];
+                monoCount = monoFilter.evaluate(&monoOutput[0], &channel[0], block, 1);
+                if (monoCount != count) break;
+                double diff = maxChannelDiff(output, channels, c, monoOutput, (int)count);
+                if (diff > maxDiff) maxDiff = diff;
+            }
+            if (monoCount != count || maxDiff > filterTolerance) {
+                fprintf(stderr, "FAIL evaluateFilterMulti %s %s %d ch %d Hz: count %u/%u, max difference %g\n",
+                        impl[pass], signalName(signal), channels, sampleRate, count, monoCount, maxDiff);
+                g_failures ++;
+            }
+        }
+
+        // interpolators
+        for (int t = 0; t < 5; t ++) {
+            disableExtensions((pass == 0) ? 0xffffffff : 0);
+            VCSDKCoreTransposerBase *multi = factories[t]();
+            disableExtensions(0xffffffff);
+            VCSDKCoreTransposerBase *single = factories[t]();
+            disableExtensions(0);
+            multi->setChannels(channels);
+            single->setChannels(1);
+
+            for (int r = 0; r < 2; r ++) {
+                int srcSamples = block, count, monoSrcSamples = 0, monoCount = 0;
+                double maxDiff = 0;
+
+                multi->setRate(rates[r]);
+                multi->resetRegisters();
+                count = (multi->*TransposerAccess::multiFunc())(&output[0], &input[0], srcSamples);
+                for (int c = 0; c < channels; c ++) {
+                    for (int i = 0; i < block; i ++) channel[i] = input[(size_t)i * channels + c];
+                    single->setRate(rates[r]);
+                    single->resetRegisters();
+                    monoSrcSamples = block;
+                    monoCount = (single->*TransposerAccess::monoFunc())(&monoOutput[0], &channel[0], monoSrcSamples);
+                    if (monoCount != count || monoSrcSamples != srcSamples) break;
+                    double diff = maxChannelDiff(output, channels, c, monoOutput, count);
+                    if (diff > maxDiff) maxDiff = diff;
+                }
+                if (monoCount != count || monoSrcSamples != srcSamples || maxDiff > tolerances[t]) {
+                    fprintf(stderr, "FAIL %s transposeMulti %s %s %d ch %d Hz rate %g: count %d/%d, max difference %g\n",
+                            names[t], impl[pass], signalName(signal), channels, sampleRate, rates[r], count, monoCount, maxDiff);
+                    g_failures ++;
+                }
+            }
+            delete multi;
+            delete single;
+        }
+
+        // anti-alias resampler
+        {
+            disableExtensions((pass == 0) ? 0xffffffff : 0);
+            VCSDKCoreAAResampler *multi = VCSDKCoreAAResampler::newInstance();
+            disableExtensions(0xffffffff);
+            VCSDKCoreAAResampler *single = VCSDKCoreAAResampler::newInstance();
+            disableExtensions(0);
+            int srcSamples = block, count, monoSrcSamples = 0, monoCount = 0;
+            double maxDiff = 0;
+
+            multi->setChannels(channels);
+            single->setChannels(1);
+            multi->setParameters(1.26f, 64);
+            single->setParameters(1.26f, 64);
+            count = (multi->*ResamplerAccess::multiFunc())(&output[0], &input[0], srcSamples);
+            for (int c = 0; c < channels; c ++) {
+                for (int i = 0; i < block; i ++) channel[i] = input[(size_t)i * channels + c];
+                single->resetRegisters();
+                monoSrcSamples = block;
+                monoCount = (single->*ResamplerAccess::monoFunc())(&monoOutput[0], &channel[0], monoSrcSamples);
+                if (monoCount != count || monoSrcSamples != srcSamples) break;
+                double diff = maxChannelDiff(output, channels, c, monoOutput, count);
+                if (diff > maxDiff) maxDiff = diff;
+            }
+            if (monoCount != count || monoSrcSamples != srcSamples || maxDiff > filterTolerance) {
+                fprintf(stderr, "FAIL AAResampler resampleMulti %s %s %d ch %d Hz: count %d/%d, max difference %g\n",
+                        impl[pass], signalName(signal), channels, sampleRate, count, monoCount, maxDiff);
+                g_failures ++;
+            }
+            delete multi;
+            delete single;
+        }
+    }
+}
+
+
+/// Checks that the polyphase interpolator newInstance() selects gives the same
+/// output as the plain C++ routines, within POLYPHASE_TOLERANCE (int16: 16bit
+/// coefficients in the SSE2 routines; float: rounding of the dot products). Runs
+/// the signal as is and scaled to full scale, where the coefficient rounding
+/// errors are the largest.
+static void checkPolyphase(SIGNAL_TYPE signal, int channels, int sampleRate, const std::vector<SAMPLETYPE> &data) {
+    static const float rates[2] = {1.26f, 0.8f};
+    const int block = 4096;
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+    const double fullScale = 32767;
+#else
+    const double fullScale = 1;
+#endif
+    VCSDKCoreTransposerBase *interp[2];
+    std::vector<SAMPLETYPE> output[2];
+    std::vector<SAMPLETYPE> input[2];
+    double peak = 0;
+    TransposerAccess::TransposeFunc func = (channels == 1) ? TransposerAccess::monoFunc() : TransposerAccess::stereoFunc();
+
+    input[0].assign(data.begin(), data.begin() + (size_t)block * channels);
+    for (size_t i = 0; i < input[0].size(); i ++) {
+        peak = std::max(peak, fabs((double)input[0][i]));
+    }
+    input[1].resize(input[0].size());
+    for (size_t i = 0; i < input[0].size(); i ++) {
+        double value = (double)input[0][i] * fullScale / peak;
+        input[1][i] = (SAMPLETYPE)((value > fullScale) ? fullScale : (value < -fullScale) ? -fullScale : value);
+    }
+
+    for (int pass = 0; pass < 2; pass ++) {
+        disableExtensions((pass == 0) ? 0xffffffff : 0);
+        interp[pass] = VCSDKCoreInterpolatePolyphase::newInstance();
+        interp[pass]->setChannels(channels);
+        output[pass].resize((size_t)(block / 0.8f + 16) * channels);
+    }
+    disableExtensions(0);
+
+    for (int level = 0; level < 2; level ++) {
+        for (int r = 0; r < 2; r ++) {
+            int count[2];
+            double maxDiff = 0;
+
+            for (int pass = 0; pass < 2; pass ++) {
+                int srcSamples = block;
+                interp[pass]->setRate(rates[r]);
+                count[pass] = (interp[pass]->*func)(&output[pass][0], &input[level][0], srcSamples);
+            }
+            for (int i = 0; i < count[0] * channels && count[0] == count[1]; i ++) {
+                double diff = fabs((double)output[0][i] - (double)output[1][i]);
+                if (diff > maxDiff) maxDiff = diff;
+            }
+            if (count[0] != count[1] || maxDiff > POLYPHASE_TOLERANCE) {
+                fprintf(stderr, "FAIL InterpolatePolyphase %s%s %d Hz rate %g: max difference %g\n",
+                        signalName(signal), (level == 0) ? "" : " full scale", sampleRate, rates[r], maxDiff);
+                g_failures ++;
+            }
+        }
+    }
+
+    delete interp[0];
+    delete interp[1];
+}
+
+
+/// Checks that the fused anti-alias resampler newInstance() selects gives the
+/// same output as the plain C++ routines (int16: exactly; float: within rounding)
+static void checkResampler(SIGNAL_TYPE signal, int channels, int sampleRate, const std::vector<SAMPLETYPE> &data) {
+    static const float rates[2] = {1.26f, 2.0f};
+    const int block = 4096;
+    VCSDKCoreAAResampler *resampler[2];
+    std::vector<SAMPLETYPE> output[2];
+    ResamplerAccess::ResampleFunc func = (channels == 1) ? ResamplerAccess::monoFunc() : ResamplerAccess::stereoFunc();
+
+    for (int pass = 0; pass < 2; pass ++) {
+        disableExtensions((pass == 0) ? 0xffffffff : 0);
+        resampler[pass] = VCSDKCoreAAResampler::newInstance();
+        resampler[pass]->setChannels(channels);
+        output[pass].resize((size_t)(block + 16) * channels);
+    }
+    disableExtensions(0);
+
+    for (int r = 0; r < 2; r ++) {
+        int count[2];
+        double maxDiff = 0;
+
+        for (int pass = 0; pass < 2; pass ++) {
+            int srcSamples = block;
+            resampler[pass]->setParameters(rates[r], 64);
+            count[pass] = (resampler[pass]->*func)(&output[pass][0], &data[0], srcSamples);
+        }
+        for (int i = 0; i < count[0] * channels && count[0] == count[1]; i ++) {
+            double diff = fabs((double)output[0][i] - (double)output[1][i]);
+            if (diff > maxDiff) maxDiff = diff;
+        }
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+        if (count[0] != count[1] || maxDiff > 0) {
+#else
+        if (count[0] != count[1] || maxDiff > OVERLAP_TOLERANCE) {
+#endif
+            fprintf(stderr, "FAIL AAResampler %s %d Hz rate %g: max difference %g\n",
+                    signalName(signal), sampleRate, rates[r], maxDiff);
+            g_failures ++;
+        }
+    }
+
+    delete resampler[0];
+    delete resampler[1];
+}
+
+
+/// Tempo, pitch & rate of the VoiceChangerSDKPublic presets
+struct PresetParams {
+    const char *name;
+    float tempo, pitch, rate;
+};
+
+static const PresetParams g_presets[] = {
+    {"luoliSound",          1.0f, 1.5874f, 1.0f},
+    {"uncleSound",          1.0f, 0.8f,    1.0f},
+    {"funnySound",          1.0f, 1.0f,    2.0f},
+    {"littleYellowSound",   1.0f, 1.5874f, 2.0f},
+    {"slowlySound",         0.5f, 1.0f,    1.0f},
+    {"monsterSound",        1.0f, 0.5f,    1.0f},
+    {"heavyMachinery",      1.0f, 0.7071f, 1.0f},
+    {"quicklySaySound",     3.0f, 1.0f,    1.0f},
+};
+
+
+/// Checks that the segment workers of processSegmented run with the fused
+/// anti-alias resampler too: the first segment is copied to the output up to the
+/// first seam as is, so there it must equal the single stream output exactly.
+static void checkSegmented(SIGNAL_TYPE signal, int channels, int sampleRate) {
+    std::vector<SAMPLETYPE> input;
+    // long enough for two segments with their pre-roll & post-roll
+    generateSignal(input, signal, sampleRate, channels, 4 * sampleRate);
+    const ulonglong numInput = input.size() / channels;
+
+    VCSDKCore core;
+    core.setSampleRate(sampleRate);
+    core.setChannels(channels);
+    core.setPitchSemiTones(4);
+    core.setSetting(SETTING_USE_FUSED_AA_FILTER, 1);
+
+    const ulonglong numOutput = core.getOutputSampleCount(numInput);
+    const ulonglong numFirst = core.getOutputSampleCount(numInput / 2);
+    std::vector<SAMPLETYPE> single((size_t)numOutput * channels), segmented((size_t)numOutput * channels);
+
+    core.processSegmented(&input[0], numInput, &single[0], 1);
+    core.processSegmented(&input[0], numInput, &segmented[0], 2);
+
+    for (ulonglong i = 0; i < numFirst * channels; i ++) {
+        if (single[i] != segmented[i]) {
+            fprintf(stderr, "FAIL processSegmented fused AA filter %s %d ch %d Hz: differs from the single stream at sample %llu\n",
+                    signalName(signal), channels, sampleRate, i / channels);
+            g_failures ++;
+            break;
+        }
+    }
+}
+
+
+/// Longest run of all-zero frames within frames ['begin', 'end') of 'output', and
+/// the largest step between two successive samples of a channel there
+static void outputDefects(const std::vector<SAMPLETYPE> &output, int channels, size_t begin, size_t end,
+                          size_t &maxZeroRun, double &maxStep) {
+    size_t run = 0;
+    maxZeroRun = 0;
+    maxStep = 0;
+    for (size_t i = begin; i < end; i ++) {
+        bool zero = true;
+        for (int c = 0; c < channels; c ++) {
+            zero = zero && (output[i * channels + c] == 0);
+            if (i > begin) {
+                double step = fabs((double)output[i * channels + c] - (double)output[(i - 1) * channels + c]);
+                if (step > maxStep) maxStep = step;
+            }
+        }
+        run = zero ? run + 1 : 0;
+        if (run > maxZeroRun) maxZeroRun = run;
+    }
+}
+
+
+/// Number of frames at the end of 'output' after its last frame louder than 'quiet',
+/// and the largest magnitude in a frame followed by at least 'minRun' all-zero
+/// frames, i.e. how abruptly the output falls silent
+static void outputTail(const std::vector<SAMPLETYPE> &output, int channels, double quiet, size_t minRun,
+                       size_t &quietTail, double &maxCut) {
+    const size_t numFrames = output.size() / channels;
+    size_t run = 0;
+    bool loud = false;
+    quietTail = 0;
+    maxCut = 0;
+    for (size_t i = numFrames; i -- > 0; ) {
+        bool zero = true;
+        double level = 0;
+        for (int c = 0; c < channels; c ++) {
+            zero = zero && (output[i * channels + c] == 0);
+            if (fabs((double)output[i * channels + c]) > level) level = fabs((double)output[i * channels + c]);
+        }
+        if (run >= minRun && level > maxCut) maxCut = level;
+        run = zero ? run + 1 : 0;
+        if (level > quiet && !loud) {
+            quietTail = numFrames - 1 - i;
+            loud = true;
+        }
+    }
+}
+
+
+/// Checks the seams & the tail of processSegmented on 4 segments against the single
+/// stream output for the tempo/pitch/rate of every VoiceChangerSDKPublic preset.
+/// Across each seam crossfade the output may have no longer run of zeros than the
+/// single stream has before its tail, and no larger sample step than the single
+/// stream's largest or the segments' own largest away from the seams. Each segment
+/// drifts from the nominal timeline by up to the stretch seek window on its own, so
+/// the output may fall quiet that much plus the seam search range earlier than the
+/// single stream, but it may not cut to silence from a louder sample than the
+/// single stream does anywhere.
+static void checkSegmentSeams(SIGNAL_TYPE signal, int channels, int sampleRate) {
+    std::vector<SAMPLETYPE> input, output[2];
+    // long enough for 4 segments with their pre-roll & post-roll at every preset
+    generateSignal(input, signal, sampleRate, channels, 8 * sampleRate);
+    const ulonglong numInput = input.size() / channels;
+    // crossfade & seam search range of processSegmented, 10 ms each
+    const size_t crossfade = (size_t)(sampleRate / 100);
+    const size_t seekLength = crossfade;
+    // 1 % of full scale counts as quiet, & silence from 8 zero frames on
+    const double quiet = (double)toSample(0.01);
+    const size_t minRun = 8;
+
+    for (size_t p = 0; p < sizeof(g_presets) / sizeof(g_presets[0]); p ++) {
+        VCSDKCore core;
+        size_t zeroRun[2], quietTail[2];
+        double step[2], maxCut[2];
+
+        core.setSampleRate(sampleRate);
+        core.setChannels(channels);
+        core.setTempo(g_presets[p].tempo);
+        core.setPitch(g_presets[p].pitch);
+        core.setRate(g_presets[p].rate);
+        const ulonglong numOutput = core.getOutputSampleCount(numInput);
+
+        // the automatic seek window is at most 25 ms
+        int seekWindowMs = core.getSetting(SETTING_SEEKWINDOW_MS);
+        if (seekWindowMs <= 0) seekWindowMs = 25;
+        const size_t drift = (size_t)((double)seekWindowMs * sampleRate / 1000 * numOutput / numInput) + seekLength;
+
+        for (int k = 0; k < 2; k ++) {
+            output[k].resize((size_t)numOutput * channels);
+            core.processSegmented(&input[0], numInput, &output[k][0], (k == 0) ? 1 : 4);
+            outputTail(output[k], channels, quiet, minRun, quietTail[k], maxCut[k]);
+        }
+        outputDefects(output[0], channels, 0, (size_t)numOutput - quietTail[0], zeroRun[0], step[0]);
+
+        size_t seam[5];
+        double maxStep = step[0];
+        for (int s = 0; s <= 4; s ++) {
+            seam[s] = (size_t)core.getOutputSampleCount(numInput * s / 4);
+        }
+        for (int s = 0; s < 4; s ++) {
+            size_t run;
+            double segmentStep;
+            outputDefects(output[1], channels, (s > 0) ? seam[s] + crossfade : 0, seam[s + 1], run, segmentStep);
+            if (segmentStep > maxStep) maxStep = segmentStep;
+        }
+        for (int s = 1; s < 4; s ++) {
+            outputDefects(output[1], channels, seam[s] - 1, seam[s] + crossfade + 1, zeroRun[1], step[1]);
+            if (zeroRun[1] > zeroRun[0] || step[1] > maxStep) {
+                fprintf(stderr, "FAIL processSegmented %s %s %d ch %d Hz: %zu zero samples & step %g at seam %d, "
+                        "allowed %zu & %g\n", g_presets[p].name, signalName(signal), channels, sampleRate,
+                        zeroRun[1], step[1], s, zeroRun[0], maxStep);
+                g_failures ++;
+            }
+        }
+        if (quietTail[1] > quietTail[0] + drift || maxCut[1] > std::max(maxCut[0], quiet)) {
+            fprintf(stderr, "FAIL processSegmented %s %s %d ch %d Hz: quiet for the last %zu samples, cuts to "
+                    "silence from %g, single stream %zu & %g\n", g_presets[p].name, signalName(signal), channels,
+                    sampleRate, quietTail[1], maxCut[1], quietTail[0], maxCut[0]);
+            g_failures ++;
+        }
+    }
+}
+
+
+/// Streams 'input' in 10 ms blocks, receiving after every block, and returns the
+/// whole output including the flushed tail. Multiplies the tempo by 'tempoChange'
+/// halfway through.
+static void streamCore(VCSDKCore &core, const std::vector<SAMPLETYPE> &input, int channels, int sampleRate,
+                       float tempo, float tempoChange, std::vector<SAMPLETYPE> &output) {
+    const uint block = (uint)(sampleRate / 100);
+    const size_t numInput = input.size() / channels;
+    std::vector<SAMPLETYPE> buffer(16384 * channels);
+    uint num;
+
+    output.clear();
+    for (size_t pos = 0; pos + block <= numInput; pos += block) {
+        if (pos / block == numInput / block / 2) core.setTempo(tempo * tempoChange);
+        core.putSamples(&input[pos * channels], block);
+        while ((num = core.receiveSamples(&buffer[0], 16384)) > 0) {
+            output.insert(output.end(), buffer.begin(), buffer.begin() + num * channels);
+        }
+    }
+    core.flush();
+    while ((num = core.receiveSamples(&buffer[0], 16384)) > 0) {
+        output.insert(output.end(), buffer.begin(), buffer.begin() + num * channels);
+    }
+}
+
+
+/// Checks that SETTING_PIPELINED_STAGES gives exactly the output of the synchronous
+/// pipeline for the tempo/pitch/rate of every VoiceChangerSDKPublic preset, also
+/// across a tempo change in the middle of the stream.
+static void checkPipelined(SIGNAL_TYPE signal, int channels, int sampleRate) {
+    std::vector<SAMPLETYPE> input, output[2];
+    generateSignal(input, signal, sampleRate, channels, 2 * sampleRate);
+
+    for (size_t p = 0; p < sizeof(g_presets) / sizeof(g_presets[0]); p ++) {
+        for (int pipelined = 0; pipelined < 2; pipelined ++) {
+            VCSDKCore core;
+            core.setSampleRate(sampleRate);
+            core.setChannels(channels);
+            core.setTempo(g_presets[p].tempo);
+            core.setPitch(g_presets[p].pitch);
+            core.setRate(g_presets[p].rate);
+            core.setSetting(SETTING_PIPELINED_STAGES, pipelined);
+            streamCore(core, input, channels, sampleRate, g_presets[p].tempo, 1.25f, output[pipelined]);
+        }
+        if (output[0] != output[1]) {
+            fprintf(stderr, "FAIL pipelined stages %s %s %d ch %d Hz: differ from the synchronous pipeline\n",
+                    g_presets[p].name, signalName(signal), channels, sampleRate);
+            g_failures ++;
+        }
+    }
+}
+
+
+/// Checks VCSDKCore::getStats: in a VCSDKCORE_ENABLE_STATS build every stage must
+/// have counted calls & samples and every FIFO a high-water mark, for pitch up &
+/// down (the stage order differs), with & without the stage worker threads.
+/// Without VCSDKCORE_ENABLE_STATS getStats must return FALSE.
+static void checkStats() {
+    static const float pitches[2] = {1.5f, 0.7f};
+    const int sampleRate = 44100;
+    std::vector<SAMPLETYPE> input, output(16384);
+    generateSignal(input, SIGNAL_SPEECH, sampleRate, 1, 2 * sampleRate);
+
+    for (int p = 0; p < 2; p ++) {
+        for (int pipelined = 0; pipelined < 2; pipelined ++) {
+            VCSDKCore core;
+            core.setSampleRate(sampleRate);
+            core.setChannels(1);
+            core.setPitch(pitches[p]);
+            core.setSetting(SETTING_PIPELINED_STAGES, pipelined);
+
+            // 10 ms blocks
+            for (size_t pos = 0; pos + sampleRate / 100 <= input.size(); pos += sampleRate / 100) {
+                core.putSamples(&input[pos], sampleRate / 100);
+                core.receiveSamples(&output[0], (uint)output.size());
+            }
+
+            VCSDKCoreStats stats;
+            BOOL enabled = core.getStats(stats);
+#ifdef VCSDKCORE_ENABLE_STATS
+            bool ok = (enabled != FALSE);
+            for (int k = 0; k < STATS_NUM_STAGES; k ++) {
+                ok = ok && (stats.stage[k].calls > 0) && (stats.stage[k].samples > 0);
+            }
+            ok = ok && (stats.tdInputHighWater > 0) && (stats.tdOutputHighWater > 0) &&
+                 (stats.transposerInputHighWater > 0) && (stats.transposerMidHighWater > 0) &&
+                 (stats.transposerOutputHighWater > 0);
+#else
+            bool ok = (enabled == FALSE) && (stats.stage[STATS_SEEK].calls == 0);
+#endif
+            if (!ok) {
+                fprintf(stderr, "FAIL getStats pitch %g%s: a stage counter or high-water mark is zero\n",
+                        pitches[p], pipelined ? " pipelined" : "");
+                g_failures ++;
+            }
+        }
+    }
+}
+
+
+/// VCSDKCoreFIRFilter::evaluateFilterMono/Stereo/Multi through the anti-alias filter
+static void benchFIR(const char *impl, SIGNAL_TYPE signal, int channels, int sampleRate,
+                     const std::vector<SAMPLETYPE> &data) {
+    VCSDKCoreAAFilter filter(64);
+    filter.setCutoffFreq(0.5 / 1.5);
+
+    const int block = 4096;
+    std::vector<SAMPLETYPE> output((size_t)block * channels);
+    BenchCase bc = {(channels == 1) ? "evaluateFilterMono" : (channels == 2) ? "evaluateFilterStereo" : "evaluateFilterMulti",
+                    impl, signal, channels, sampleRate, "64taps"};
+
+    run(bc, [&]() -> unsigned long long {
+        uint count = filter.evaluate(&output[0], &data[0], block, (uint)channels);
+        g_sink += output[count / 2];
+        return count;
+    });
+}
+
+
+/// Interpolator transposeMono/Stereo for both pitch directions
+static void benchTransposer(VCSDKCoreTransposerBase *transposer, const char *kernel, const char *impl,
+                            SIGNAL_TYPE signal, int channels, int sampleRate, const std::vector<SAMPLETYPE> &data) {
+    static const float rates[2] = {1.26f, 0.8f};
+    static const char *rateNames[2] = {"rate1.26", "rate0.8"};
+    const int block = 4096;
+    std::vector<SAMPLETYPE> output((size_t)(block / 0.8f + 16) * channels);
+    TransposerAccess::TransposeFunc func = (channels == 1) ? TransposerAccess::monoFunc() : TransposerAccess::stereoFunc();
+
+    transposer->setChannels(channels);
+    for (int r = 0; r < 2; r ++) {
+        transposer->setRate(rates[r]);
+        BenchCase bc = {kernel, impl, signal, channels, sampleRate, rateNames[r]};
+        run(bc, [&]() -> unsigned long long {
+            int srcSamples = block;
+            int count = (transposer->*func)(&output[0], &data[0], srcSamples);
+            g_sink += output[count / 2];
+            return (unsigned long long)count;
+        });
+    }
+    delete transposer;
+}
+
+
+/// VCSDKCoreAAResampler filtering & transposing in one pass, 64 taps
+static void benchResampler(const char *impl, SIGNAL_TYPE signal, int channels, int sampleRate,
+                           const std::vector<SAMPLETYPE> &data) {
+    static const float rates[2] = {1.26f, 2.0f};
+    static const char *rateNames[2] = {"rate1.26", "rate2"};
+    const int block = 4096;
+    VCSDKCoreAAResampler *resampler = VCSDKCoreAAResampler::newInstance();
+    std::vector<SAMPLETYPE> output((size_t)(block + 16) * channels);
+    ResamplerAccess::ResampleFunc func = (channels == 1) ? ResamplerAccess::monoFunc() : ResamplerAccess::stereoFunc();
+
+    resampler->setChannels(channels);
+    for (int r = 0; r < 2; r ++) {
+        resampler->setParameters(rates[r], 64);
+        BenchCase bc = {"AAResampler", impl, signal, channels, sampleRate, rateNames[r]};
+        run(bc, [&]() -> unsigned long long {
+            int srcSamples = block;
+            int count = (resampler->*func)(&output[0], &data[0], srcSamples);
+            g_sink += output[count / 2];
+            return (unsigned long long)count;
+        });
+    }
+    delete resampler;
+}
+
+
+/// VCSDKCoreFIFOSampleBuffer put/receive in 10 ms blocks
+static void benchFIFO(SIGNAL_TYPE signal, int channels, int sampleRate, const std::vector<SAMPLETYPE> &data) {
+    VCSDKCoreFIFOSampleBuffer fifo(channels);
+    const uint block = (uint)(sampleRate / 100);
+    std::vector<SAMPLETYPE> output((size_t)block * channels);
+    BenchCase bc = {"FIFOSampleBuffer", "generic", signal, channels, sampleRate, "10ms"};
+
+    run(bc, [&]() -> unsigned long long {
+        for (int i = 0; i < 16; i ++) {
+            fifo.putSamples(&data[(size_t)channels * block * i], block);
+            fifo.receiveSamples(&output[0], block);
+        }
+        g_sink += output[block / 2];
+        return (unsigned long long)16 * block;
+    });
+}
+
+
+int main(int argc, char **argv) {
+    static const int sampleRates[] = {8000, 16000, 44100, 48000};
+
+    if (argc > 1 && strcmp(argv[1], "--check") == 0) {
+        g_checkOnly = true;
+    } else if (argc > 1) {
+        g_minSeconds = atof(argv[1]);
+        if (g_minSeconds <= 0) g_minSeconds = 0.05;
+    }
+
+    fprintf(stderr, "cpu extensions 0x%x\n", detectCPUextensions());
+    checkStats();
+    if (!g_checkOnly) printf("kernel,impl,signal,channels,sample_rate,param,frames,ns_per_sample,samples_per_sec\n");
+
+    for (int s = 0; s < SIGNAL_NUM_TYPES; s ++) {
+        for (int r = 0; r < 4; r ++) {
+            for (int channels = 1; channels <= 2; channels ++) {
+                SIGNAL_TYPE signal = (SIGNAL_TYPE)s;
+                int sampleRate = sampleRates[r];
+                std::vector<SAMPLETYPE> data;
+                // one second, enough for the widest seek window & the largest blocks
+                generateSignal(data, signal, sampleRate, channels, sampleRate > 8192 ? sampleRate : 8192);
+
+                checkTDStretch(signal, channels, sampleRate, data);
+                checkFIR(signal, channels, sampleRate, data);
+                checkPolyphase(signal, channels, sampleRate, data);
+                checkResampler(signal, channels, sampleRate, data);
+                checkSegmented(signal, channels, sampleRate);
+                checkPipelined(signal, channels, sampleRate);
+                checkSegmentSeams(signal, channels, sampleRate);
+                if (g_checkOnly) continue;
+
+                for (int pass = 0; pass < 2; pass ++) {
+                    const char *impl = (pass == 0) ? "generic" : "dispatch";
+                    disableExtensions((pass == 0) ? 0xffffffff : 0);
+                    benchTDStretch(impl, signal, channels, sampleRate, data);
+                    benchFIR(impl, signal, channels, sampleRate, data);
+                    benchResampler(impl, signal, channels, sampleRate, data);
+                    benchTransposer(VCSDKCoreInterpolatePolyphase::newInstance(), "InterpolatePolyphase", impl,
+                                    signal, channels, sampleRate, data);
+                }
+                disableExtensions(0);
+
+                benchTransposer(new InterpolateLinearInteger, "InterpolateLinearInteger", "generic", signal, channels, sampleRate, data);
+                benchTransposer(new VCSDKCoreInterpolateCubic, "InterpolateCubic", "generic", signal, channels, sampleRate, data);
+                benchTransposer(new InterpolateShannon, "InterpolateShannon", "generic", signal, channels, sampleRate, data);
+                benchFIFO(signal, channels, sampleRate, data);
+            }
+
+            // surround & ambisonic channel counts, the multichannel routines only
+            for (int channels = 4; channels <= 6; channels += 2) {
+                SIGNAL_TYPE signal = (SIGNAL_TYPE)s;
+                int sampleRate = sampleRates[r];
+                std::vector<SAMPLETYPE> mono, data;
+                generateSignal(mono, signal, sampleRate, 1, sampleRate > 8192 ? sampleRate : 8192);
+                interleaveChannels(data, mono, channels);
+
+                checkMultichannel(signal, channels, sampleRate, mono);
+                if (g_checkOnly) continue;
+
+                for (int pass = 0; pass < 2; pass ++) {
+                    disableExtensions((pass == 0) ? 0xffffffff : 0);
+                    benchFIR((pass == 0) ? "generic" : "dispatch", signal, channels, sampleRate, data);
+                }
+                disableExtensions(0);
+            }
+        }
+    }
+
+    fprintf(stderr, "checksum %g\n", (double)g_sink);
+    if (g_failures) {
+        fprintf(stderr, "%d optimized kernel results differ from the C++ routines\n", g_failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,335 @@
+////  VCSDKPresetBench.cpp
+//  VoiceChangerSDKBenchmark
+//
+//  End-to-end throughput of every VoiceChangerSDKPublic preset over a fixed set
+//  of synthetic clips, as offline conversion on one thread & on all cores, and
+//  as 10 ms streaming.
+//
+//  Build with the CMakeLists.txt in the repository root (Linux with glibc) & run:
+//
+//      cmake -S . -B build && cmake --build build -j
+//      build/vcsdk_presetbench [minimum seconds per case, default 1.0] > presets.csv
+//      build/vcsdk_presetbench --check
+//
+//  vcsdk_presetbench_float measures the float processing build; the 16bit PCM
+//  interface & the rows stay the same. --check prints no CSV, converts 2 second
+//  clips once per preset & mode and exits with 1 if any output length differs
+//  from getOutputSampleCount, or the 10 ms streaming output from the offline
+//  conversion (ctest test "presetcheck").
+//
+//  Output is CSV, one row per preset, clip & mode:
+//
+//      preset,clip,mode,sample_rate,channels,audio_seconds,process_seconds,rtf,streams_per_core,allocs_per_audio_second,peak_rss_kb
+//
+//  rtf = wall-clock processing time / audio duration, streams_per_core = 1 / rtf.
+//  The offline_mt rows use setOfflineThreadCount(0), i.e. all cores, so for them
+//  1 / rtf is the whole machine's throughput instead.
+//  allocs_per_audio_second counts the heap allocations made during the timed runs on
+//  all threads: malloc & co (intercepted in this file, as in VCSDKRealtimeCheck),
+//  which operator new & the default VCSDKCoreAllocator go through, and mmap calls
+//  that map new memory, e.g. the mirrored FIFO buffers. peak_rss_kb is the process
+//  peak resident set so far, so it only grows from row to row.
+//
+
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <dlfcn.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+#include "VoiceChangerSDKPublic.h"
+#include "VCSDKBenchSignal.h"
+
+using namespace vcsdkbench;
+
+
+// --- allocation counting ---
+
+static std::atomic<unsigned long long> g_allocCount(0);
+
+static inline void countAlloc() {
+    g_allocCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+extern "C" {
+
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *ptr);
+
+void *malloc(size_t size) {
+    countAlloc();
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    countAlloc();
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    countAlloc();
+    return __libc_realloc(ptr, size);
+}
+
+void *memalign(size_t alignment, size_t size) {
+    countAlloc();
+    return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+    countAlloc();
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size) {
+    countAlloc();
+    *ptr = __libc_memalign(alignment, size);
+    return (*ptr != NULL) ? 0 : ENOMEM;
+}
+
+void free(void *ptr) {
+    __libc_free(ptr);
+}
+
+
+typedef void *(*MmapFunc)(void *, size_t, int, int, int, off_t);
+
+static MmapFunc g_mmap = NULL;
+
+// MAP_FIXED only remaps an address range reserved before, e.g. the two views of
+// a mirrored FIFO buffer, so count the reservation only
+void *mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset) {
+    if ((flags & MAP_FIXED) == 0) countAlloc();
+    return g_mmap(addr, length, prot, flags, fd, offset);
+}
+
+}   // extern "C"
+
+
+static void resolveIntercepted() {
+    g_mmap = (MmapFunc)dlsym(RTLD_NEXT, "mmap");
+    if (!g_mmap) {
+        fprintf(stderr, "can't resolve mmap\n");
+        exit(2);
+    }
+}
+
+
+void *operator new(size_t size) {
+    void *p = malloc(size ? size : 1);
+    if (p == NULL) throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size) {
+    void *p = malloc(size ? size : 1);
+    if (p == NULL) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    free(p);
+}
+
+
+// --- presets & clips ---
+
+typedef void (VoiceChangerSDKPublic::*PresetFunc)();
+
+struct Preset {
+    const char *name;
+    PresetFunc func;
+};
+
+static const Preset g_presets[] = {
+    {"luoliSound",          &VoiceChangerSDKPublic::luoliSound},
+    {"uncleSound",          &VoiceChangerSDKPublic::uncleSound},
+    {"funnySound",          &VoiceChangerSDKPublic::funnySound},
+    {"littleYellowSound",   &VoiceChangerSDKPublic::littleYellowSound},
+    {"slowlySound",         &VoiceChangerSDKPublic::slowlySound},
+    {"monsterSound",        &VoiceChangerSDKPublic::monsterSound},
+    {"heavyMachinery",      &VoiceChangerSDKPublic::heavyMachinery},
+    {"quicklySaySound",     &VoiceChangerSDKPublic::quicklySaySound},
+};
+
+struct Clip {
+    const char *name;
+    SIGNAL_TYPE signal;
+    int sampleRate;
+    int channels;
+    int seconds;
+};
+
+/// Standard clip set: telephony, wideband & full-band speech plus a noise clip
+static const Clip g_clips[] = {
+    {"speech8k_mono",       SIGNAL_SPEECH, 8000,  1, 10},
+    {"speech16k_mono",      SIGNAL_SPEECH, 16000, 1, 10},
+    {"speech44k_mono",      SIGNAL_SPEECH, 44100, 1, 10},
+    {"speech48k_stereo",    SIGNAL_SPEECH, 48000, 2, 10},
+    {"noise48k_mono",       SIGNAL_NOISE,  48000, 1, 10},
+};
+
+
+static double g_minSeconds = 1.0;
+
+/// --check: no timing, converts 2 second clips once per preset & mode and checks the output length
+static bool g_checkOnly = false;
+static int g_failures = 0;
+
+
+static long peakRssKb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;     // kilobytes on Linux
+}
+
+
+/// Offline conversion of the whole clip
+static size_t runOffline(VoiceChangerSDKPublic &vc, const Clip &clip, const std::vector<short> &pcm,
+                         std::vector<short> &out) {
+    size_t numFrames = pcm.size() / clip.channels;
+    return vc.processPcmToVoiceChanger(&pcm[0], numFrames, clip.channels, clip.sampleRate, &out[0], out.size());
+}
+
+
+/// Live-chat style processing in 10 ms blocks (mono only, as the streaming API)
+static size_t runStream(VoiceChangerSDKPublic &vc, const Clip &clip, const std::vector<short> &pcm,
+                        std::vector<short> &out) {
+    size_t block = clip.sampleRate / 100;
+    size_t total = 0;
+
+    vc.setStreamSampleRate(clip.sampleRate);
+    for (size_t pos = 0; pos + block <= pcm.size(); pos += block) {
+        total += vc.process(&pcm[pos], block, &out[total], out.size() - total);
+    }
+    total += vc.flushStream(&out[total], out.size() - total);
+    return total;
+}
+
+
+static void benchPreset(const Preset &preset, const Clip &clip, const std::vector<short> &pcm, bool stream,
+                        uint32_t offlineThreads = 1) {
+    typedef std::chrono::steady_clock Clock;
+    VoiceChangerSDKPublic vc;
+    (vc.*preset.func)();
+    vc.setOfflineThreadCount(offlineThreads);
+
+    const char *mode = stream ? "stream10ms" : (offlineThreads == 1) ? "offline" : "offline_mt";
+    double clipSeconds = (double)(pcm.size() / clip.channels) / clip.sampleRate;
+    size_t expected = (size_t)vc.getOutputSampleCount(pcm.size() / clip.channels);
+    std::vector<short> out(expected + 16);
+
+    // warm up, lets the FIFOs reach their working size
+    size_t produced = stream ? runStream(vc, clip, pcm, out) : runOffline(vc, clip, pcm, out);
+    if (produced != expected) {
+        fprintf(stderr, "FAIL %s %s %s: %zu output samples instead of %zu\n", preset.name, clip.name, mode,
+                produced, expected);
+        g_failures ++;
+    }
+    if (g_checkOnly) return;
+
+    unsigned long long allocStart = g_allocCount.load();
+    int runs = 0;
+    double seconds = 0;
+    Clock::time_point start = Clock::now();
+    do {
+        produced = stream ? runStream(vc, clip, pcm, out) : runOffline(vc, clip, pcm, out);
+        runs ++;
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (seconds < g_minSeconds);
+    unsigned long long allocs = g_allocCount.load() - allocStart;
+
+    double audioSeconds = clipSeconds * runs;
+    double rtf = seconds / audioSeconds;
+    printf("%s,%s,%s,%d,%d,%.1f,%.4f,%.5f,%.1f,%.3f,%ld\n", preset.name, clip.name, mode, clip.sampleRate,
+           clip.channels, audioSeconds, seconds, rtf, 1.0 / rtf, (double)allocs / audioSeconds, peakRssKb());
+    fflush(stdout);
+}
+
+
+/// Streaming in 10 ms blocks must give exactly the offline conversion output
+static void checkStream(const Preset &preset, const Clip &clip, const std::vector<short> &pcm) {
+    VoiceChangerSDKPublic vc;
+    (vc.*preset.func)();
+
+    size_t expected = (size_t)vc.getOutputSampleCount(pcm.size());
+    std::vector<short> offline(expected + 16), stream(expected + 16);
+    size_t numOffline = runOffline(vc, clip, pcm, offline);
+    size_t numStream = runStream(vc, clip, pcm, stream);
+
+    for (size_t i = 0; i < numOffline && i < numStream; i ++) {
+        if (offline[i] != stream[i]) {
+            fprintf(stderr, "FAIL %s %s: 10 ms streaming differs from offline conversion at sample %zu\n",
+                    preset.name, clip.name, i);
+            g_failures ++;
+            return;
+        }
+    }
+}
+
+
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "--check") == 0) {
+        g_checkOnly = true;
+    } else if (argc > 1) {
+        g_minSeconds = atof(argv[1]);
+        if (g_minSeconds <= 0) g_minSeconds = 1.0;
+    }
+
+    resolveIntercepted();
+
+    if (!g_checkOnly) printf("preset,clip,mode,sample_rate,channels,audio_seconds,process_seconds,rtf,"
+           "streams_per_core,allocs_per_audio_second,peak_rss_kb\n");
+
+    for (size_t c = 0; c < sizeof(g_clips) / sizeof(g_clips[0]); c ++) {
+        const Clip &clip = g_clips[c];
+        std::vector<SAMPLETYPE> data;
+        generateSignal(data, clip.signal, clip.sampleRate, clip.channels,
+                       clip.sampleRate * (g_checkOnly ? 2 : clip.seconds));
+
+        // the public interface takes 16bit PCM; float samples are in -1..1
+        std::vector<short> pcm(data.size());
+        for (size_t i = 0; i < data.size(); i ++) {
+#ifdef SOUNDTOUCH_FLOAT_SAMPLES
+            double value = (double)data[i] * 32768.0;
+            pcm[i] = (short)((value > 32767.0) ? 32767.0 : (value < -32768.0) ? -32768.0 : value);
+#else
+            pcm[i] = (short)data[i];
+#endif
+        }
+
+        for (size_t p = 0; p < sizeof(g_presets) / sizeof(g_presets[0]); p ++) {
+            benchPreset(g_presets[p], clip, pcm, false);
+            benchPreset(g_presets[p], clip, pcm, false, 0);
+            if (clip.channels == 1) {
+                benchPreset(g_presets[p], clip, pcm, true);
+                if (g_checkOnly) checkStream(g_presets[p], clip, pcm);
+            }
+        }
+    }
+
+    if (g_failures) {
+        fprintf(stderr, "%d preset runs produced the wrong output\n", g_failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,351 @@
+////  VCSDKRealtimeCheck.cpp
+//  VoiceChangerSDKBenchmark
+//
+//  Checks the guarantee of SETTING_REALTIME_SAFE: once prepared, VCSDKCore's
+//  putSamples & receiveSamples make no heap allocation, take no locks, throw no
+//  exceptions & make no memory mapping system calls. Streams synthetic speech
+//  through a set of tempo/pitch/rate & processing setting cases in callback
+//  blocks of varying size, with parameter changes between the blocks, while malloc & co,
+//  operator new, mmap, munmap, syscall & pthread_mutex_lock are intercepted.
+//
+//  Build with the CMakeLists.txt in the repository root (Linux with glibc) & run:
+//
+//      cmake -S . -B build && cmake --build build -j
+//      build/vcsdk_realtimecheck
+//
+//  vcsdk_realtimecheck_float checks the float build. Both run as ctest test "realtimecheck".
+//
+//  Output is one line per case:
+//
+//      case,sample_rate,channels,input_samples,output_samples,dropped_samples,violations
+//
+//  Calls intercepted outside of putSamples & receiveSamples, e.g. in the setters,
+//  are allowed. The program exits with 1 if any case has a violation, or drops
+//  input although the output is received after every block.
+//
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <string.h>
+#include <new>
+#include <vector>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "VCSDKCore.h"
+#include "VCSDKBenchSignal.h"
+
+using namespace vcsdkcore;
+using namespace vcsdkbench;
+
+
+// --- interception ---
+
+/// Nonzero while inside putSamples / receiveSamples
+static volatile int g_armed = 0;
+static unsigned long long g_violations = 0;
+
+static inline void violation() {
+    if (g_armed) g_violations ++;
+}
+
+
+extern "C" {
+
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *ptr);
+
+void *malloc(size_t size) {
+    violation();
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    violation();
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    violation();
+    return __libc_realloc(ptr, size);
+}
+
+void *memalign(size_t alignment, size_t size) {
+    violation();
+    return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+    violation();
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size) {
+    violation();
+    *ptr = __libc_memalign(alignment, size);
+    return (*ptr != NULL) ? 0 : ENOMEM;
+}
+
+void free(void *ptr) {
+    violation();
+    __libc_free(ptr);
+}
+
+
+typedef void *(*MmapFunc)(void *, size_t, int, int, int, off_t);
+typedef int (*MunmapFunc)(void *, size_t);
+typedef long (*SyscallFunc)(long, ...);
+typedef int (*MutexLockFunc)(pthread_mutex_t *);
+
+static MmapFunc g_mmap = NULL;
+static MunmapFunc g_munmap = NULL;
+static SyscallFunc g_syscall = NULL;
+static MutexLockFunc g_mutexLock = NULL;
+
+void *mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset) {
+    violation();
+    return g_mmap(addr, length, prot, flags, fd, offset);
+}
+
+int munmap(void *addr, size_t length) {
+    violation();
+    return g_munmap(addr, length);
+}
+
+long syscall(long number, ...) {
+    va_list args;
+    long a[6];
+
+    violation();
+    va_start(args, number);
+    for (int i = 0; i < 6; i ++) a[i] = va_arg(args, long);
+    va_end(args);
+    return g_syscall(number, a[0], a[1], a[2], a[3], a[4], a[5]);
+}
+
+int pthread_mutex_lock(pthread_mutex_t *mutex) {
+    violation();
+    return g_mutexLock(mutex);
+}
+
+}   // extern "C"
+
+
+static void resolveIntercepted() {
+    g_mmap = (MmapFunc)dlsym(RTLD_NEXT, "mmap");
+    g_munmap = (MunmapFunc)dlsym(RTLD_NEXT, "munmap");
+    g_syscall = (SyscallFunc)dlsym(RTLD_NEXT, "syscall");
+    g_mutexLock = (MutexLockFunc)dlsym(RTLD_NEXT, "pthread_mutex_lock");
+    if (!g_mmap || !g_munmap || !g_syscall || !g_mutexLock) {
+        fprintf(stderr, "can't resolve the intercepted functions\n");
+        exit(2);
+    }
+}
+
+
+void *operator new(size_t size) {
+    void *p = malloc(size ? size : 1);
+    if (p == NULL) throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size) {
+    void *p = malloc(size ? size : 1);
+    if (p == NULL) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    free(p);
+}
+
+
+// --- cases ---
+
+struct Case {
+    const char *name;
+    float tempo;
+    float pitchSemiTones;
+    float rate;
+    int settingId;          ///< extra setting to enable, -1 for none
+    int settingValue;
+};
+
+static const Case g_cases[] = {
+    {"pitch_up",            1.0f,   8.0f,   1.0f,   -1, 0},
+    {"pitch_down",          1.0f,  -6.0f,   1.0f,   -1, 0},
+    {"tempo_up",            1.5f,   0.0f,   1.0f,   -1, 0},
+    {"tempo_down",          0.7f,   0.0f,   1.0f,   -1, 0},
+    {"rate_up",             1.0f,   0.0f,   1.4f,   -1, 0},
+    {"rate_down",           1.0f,   0.0f,   0.7f,   -1, 0},
+    {"no_aa_filter",        1.0f,   5.0f,   1.0f,   SETTING_USE_AA_FILTER, 0},
+    {"fused_aa_filter",     1.0f,   5.0f,   1.0f,   SETTING_USE_FUSED_AA_FILTER, 1},
+    {"aa_filter_64",        1.1f,  -3.0f,   1.0f,   SETTING_AA_FILTER_LENGTH, 64},
+    {"quickseek",           1.2f,   3.0f,   0.9f,   SETTING_USE_QUICKSEEK, 1},
+    {"fft_seek",            0.9f,   4.0f,   1.0f,   SETTING_USE_FFT_SEEK, 1},
+    {"hierarchical_seek",   1.0f,  -4.0f,   1.2f,   SETTING_USE_HIERARCHICAL_SEEK, 1},
+    {"target_latency_20ms", 1.0f,   6.0f,   1.0f,   SETTING_TARGET_LATENCY_MS, 20},
+};
+
+struct Format {
+    int sampleRate;
+    int channels;
+};
+
+static const Format g_formats[] = {
+    {16000, 1},
+    {44100, 1},
+    {48000, 2},
+};
+
+/// Largest audio callback block, the core is prepared for it; the blocks put vary
+/// from 1 sample up to that
+#define CALLBACK_BLOCK      480
+
+/// Length of each case in seconds
+#define CASE_SECONDS        6
+
+
+static unsigned int g_seed = 12345;
+
+static uint randomBlock(uint maxSize) {
+    g_seed = g_seed * 1664525u + 1013904223u;
+    return 1 + (g_seed >> 8) % maxSize;
+}
+
+
+/// Streams one case. Returns FALSE on a violation or unexpectedly dropped input.
+static bool runCase(const Case &c, const Format &f, const std::vector<SAMPLETYPE> &input) {
+    VCSDKCore core;
+    std::vector<SAMPLETYPE> output((size_t)CALLBACK_BLOCK * 8 * f.channels);
+    const uint numInput = (uint)(input.size() / f.channels);
+    unsigned long long numOutput = 0;
+    unsigned long long violations;
+    uint pos = 0;
+    int step = 0;
+    bool thrown = false;
+
+    core.setSampleRate(f.sampleRate);
+    core.setChannels(f.channels);
+    core.setTempo(c.tempo);
+    core.setPitchSemiTones(c.pitchSemiTones);
+    core.setRate(c.rate);
+    if (c.settingId >= 0) core.setSetting(c.settingId, c.settingValue);
+    core.setSetting(SETTING_REALTIME_SAFE, CALLBACK_BLOCK);
+
+    g_violations = 0;
+    while (pos < numInput) {
+        uint block = randomBlock(CALLBACK_BLOCK);
+        uint num;
+
+        if (block > numInput - pos) block = numInput - pos;
+
+        // parameter changes between the callbacks, also across rate 1.0 where the
+        // stages swap places
+        if (++ step % 200 == 0) {
+            core.setPitchSemiTones(c.pitchSemiTones + (float)((step / 200) % 3) * 2.0f - 2.0f);
+        }
+
+        g_armed = 1;
+        try {
+            core.putSamples(&input[(size_t)pos * f.channels], block);
+            while ((num = core.receiveSamples(&output[0], (uint)(output.size() / f.channels))) > 0) {
+                numOutput += num;
+            }
+        } catch (...) {
+            thrown = true;
+        }
+        g_armed = 0;
+        pos += block;
+    }
+    violations = g_violations + (thrown ? 1 : 0);
+
+    int dropped = core.getSetting(SETTING_REALTIME_DROPPED_SAMPLES);
+    printf("%s,%d,%d,%u,%llu,%d,%llu\n", c.name, f.sampleRate, f.channels, numInput, numOutput, dropped, violations);
+    if (thrown) fprintf(stderr, "FAIL %s: exception thrown\n", c.name);
+    return violations == 0 && dropped == 0;
+}
+
+
+/// Puts input without receiving the output: the input must be dropped instead
+/// of growing the buffers. Also puts input before the format is set.
+static bool runBackPressure(const std::vector<SAMPLETYPE> &input) {
+    VCSDKCore core;
+    unsigned long long violations;
+    bool thrown = false;
+
+    core.setSetting(SETTING_REALTIME_SAFE, CALLBACK_BLOCK);
+
+    g_violations = 0;
+    g_armed = 1;
+    try {
+        // no sample rate nor channels yet
+        core.putSamples(&input[0], CALLBACK_BLOCK);
+    } catch (...) {
+        thrown = true;
+    }
+    g_armed = 0;
+
+    core.setSampleRate(44100);
+    core.setChannels(1);
+    core.setPitchSemiTones(-5);
+
+    g_armed = 1;
+    try {
+        for (uint pos = 0; pos + CALLBACK_BLOCK <= input.size(); pos += CALLBACK_BLOCK) {
+            core.putSamples(&input[pos], CALLBACK_BLOCK);
+        }
+    } catch (...) {
+        thrown = true;
+    }
+    g_armed = 0;
+    violations = g_violations + (thrown ? 1 : 0);
+
+    int dropped = core.getSetting(SETTING_REALTIME_DROPPED_SAMPLES);
+    printf("back_pressure,44100,1,%u,%u,%d,%llu\n", (uint)input.size(), core.numSamples(), dropped, violations);
+    return violations == 0 && dropped > CALLBACK_BLOCK;
+}
+
+
+int main() {
+    int failures = 0;
+
+    resolveIntercepted();
+    printf("case,sample_rate,channels,input_samples,output_samples,dropped_samples,violations\n");
+
+    for (size_t f = 0; f < sizeof(g_formats) / sizeof(g_formats[0]); f ++) {
+        std::vector<SAMPLETYPE> input;
+        generateSignal(input, SIGNAL_SPEECH, g_formats[f].sampleRate, g_formats[f].channels,
+                       g_formats[f].sampleRate * CASE_SECONDS);
+
+        for (size_t c = 0; c < sizeof(g_cases) / sizeof(g_cases[0]); c ++) {
+            if (!runCase(g_cases[c], g_formats[f], input)) failures ++;
+        }
+    }
+
+    {
+        std::vector<SAMPLETYPE> input;
+        generateSignal(input, SIGNAL_SPEECH, 44100, 1, 44100 * CASE_SECONDS);
+        if (!runBackPressure(input)) failures ++;
+    }
+
+    if (failures) {
+        fprintf(stderr, "%d cases not real-time safe\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -10,11 +10,14 @@
 #include <memory.h>
 #include <math.h>
 #include <stdio.h>
+#include <limits.h>
 
 
 #include "VCSDKCore.h"
 #include "VCSDKCoreTDStretch.hpp"
 #include "VCSDKCoreRateTransposer.hpp"
+#include "VCSDKCorePipeline.hpp"
+#include "VCSDKCoreAllocator.hpp"
 #include "VCSDKCoreCpu_detect.h"
 
 using namespace vcsdkcore;
@@ -22,6 +25,16 @@ using namespace vcsdkcore;
 /// test if two floating point numbers are equal
 #define TEST_FLOAT_EQUAL(a, b)  (fabs(a - b) < 1e-10)
 
+/// Sequence length range searched for SETTING_TARGET_LATENCY_MS. Seek window &
+/// overlap lengths keep the proportions of the 40/15/8 ms speech defaults.
+#define TARGET_LATENCY_MAX_SEQUENCE_MS      40
+#define TARGET_LATENCY_MIN_SEQUENCE_MS      10
+
+/// Number of blank samples 'flush' feeds to the pipeline per round
+#define FLUSH_BATCH         256
+/// Don't feed more than this many blank samples in any case
+#define FLUSH_MAX_ROUNDS    128
+
 
 /// Print library version string for autoconf
 extern "C" void soundtouch_ac_test()
@@ -38,8 +51,19 @@ VCSDKCore::VCSDKCore()
     pTDStretch = VCSDKCoreTDStretch::newInstance();
 
     setOutPipe(pTDStretch);
+    pPipeline = NULL;
 
     rate = tempo = 0;
+    targetLatencyMs = 0;
+
+    outputExpectedBase = 0;
+    inputSinceChange = 0;
+    outputReceived = 0;
+
+    bRealtimeSafe = FALSE;
+    preparedBlockSize = 0;
+    realtimeDropped = 0;
+    pFlushBuffer = NULL;
 
     virtualPitch =
     virtualRate =
@@ -55,8 +79,11 @@ VCSDKCore::VCSDKCore()
 
 VCSDKCore::~VCSDKCore()
 {
+    // stop the stage workers before deleting the stages
+    delete pPipeline;
     delete pRateTransposer;
     delete pTDStretch;
+    VCSDKCoreAllocator::free(pFlushBuffer);
 }
 
 
@@ -85,9 +112,21 @@ void VCSDKCore::setChannels(uint numChannels)
         //ST_THROW_RT_ERROR("Illegal number of channels");
         return;
     }*/
+    BOOL pipelined = (pPipeline != NULL);
+
+    // the pipeline queues have a fixed frame format, restart the workers
+    enablePipeline(FALSE);
+
     channels = numChannels;
     pRateTransposer->setChannels((int)numChannels);
     pTDStretch->setChannels((int)numChannels);
+
+    VCSDKCoreAllocator::free(pFlushBuffer);
+    pFlushBuffer = VCSDKCoreAllocator::allocArray<SAMPLETYPE>(FLUSH_BATCH * numChannels);
+    memset(pFlushBuffer, 0, FLUSH_BATCH * numChannels * sizeof(SAMPLETYPE));
+    prepareStages();
+
+    enablePipeline(pipelined);
 }
 
 
@@ -174,9 +213,18 @@ void VCSDKCore::calcEffectiveRateAndTempo()
     float oldTempo = tempo;
     float oldRate = rate;
 
+    syncPipeline();
+
     tempo = virtualTempo / virtualPitch;
     rate = virtualPitch * virtualRate;
 
+    if (!TEST_FLOAT_EQUAL(tempo * rate, oldTempo * oldRate) && oldTempo * oldRate > 0)
+    {
+        // close the output length accounting of the input put with the old settings
+        outputExpectedBase += (double)inputSinceChange / ((double)oldTempo * oldRate);
+        inputSinceChange = 0;
+    }
+
     if (!TEST_FLOAT_EQUAL(rate,oldRate)) pRateTransposer->setRate(rate);
     if (!TEST_FLOAT_EQUAL(tempo, oldTempo)) pTDStretch->setTempo(tempo);
 
@@ -185,12 +233,12 @@ void VCSDKCore::calcEffectiveRateAndTempo()
     {
         if (output != pTDStretch)
         {
-            VCSDKCoreFIFOSamplePipe *tempoOut;
+            VCSDKCoreFIFOSampleBuffer *tempoOut;
 
             assert(output == pRateTransposer);
             // move samples in the current output buffer to the output of pTDStretch
             tempoOut = pTDStretch->getOutput();
-            tempoOut->moveSamples(*output);
+            tempoOut->moveSamples(*pRateTransposer->getOutput());
             // move samples in pitch transposer's store buffer to tempo changer's input
             // deprecated : pTDStretch->moveSamples(*pRateTransposer->getStore());
 
@@ -202,18 +250,107 @@ void VCSDKCore::calcEffectiveRateAndTempo()
     {
         if (output != pRateTransposer)
         {
-            VCSDKCoreFIFOSamplePipe *transOut;
+            VCSDKCoreFIFOSampleBuffer *transOut;
 
             assert(output == pTDStretch);
             // move samples in the current output buffer to the output of pRateTransposer
             transOut = pRateTransposer->getOutput();
-            transOut->moveSamples(*output);
+            transOut->moveSamples(*pTDStretch->getOutput());
             // move samples in tempo changer's input to pitch transposer's input
             pRateTransposer->moveSamples(*pTDStretch->getInput());
 
             output = pRateTransposer;
         }
     }
+
+    if (pPipeline)
+    {
+        // the stage order may have changed; 'output' is the last stage
+        if (output == pTDStretch)
+        {
+            pPipeline->setStages(pRateTransposer, pTDStretch);
+        }
+        else
+        {
+            pPipeline->setStages(pTDStretch, pRateTransposer);
+        }
+    }
+
+    if (targetLatencyMs > 0) applyTargetLatency();
+    prepareStages();
+}
+
+
+// Waits until the stage workers are idle
+void VCSDKCore::syncPipeline() const
+{
+    if (pPipeline) pPipeline->sync();
+}
+
+
+// Starts/stops the stage worker threads. The samples in the processing stages
+// stay, and the collected output moves back to the last stage.
+BOOL VCSDKCore::enablePipeline(BOOL enable)
+{
+    VCSDKCoreFIFOSampleBuffer *last = (output == pTDStretch) ? pTDStretch->getOutput()
+                                                              : pRateTransposer->getOutput();
+
+    if (enable && pPipeline == NULL)
+    {
+        if (channels == 0) return FALSE;
+
+        pPipeline = (output == pTDStretch) ? new VCSDKCorePipeline(pRateTransposer, pTDStretch, channels)
+                                           : new VCSDKCorePipeline(pTDStretch, pRateTransposer, channels);
+        // hand the samples that are ready already over to the caller side output
+        pPipeline->collectOutput()->moveSamples(*last);
+    }
+    else if (!enable && pPipeline != NULL)
+    {
+        pPipeline->sync();
+        last->moveSamples(*pPipeline->collectOutput());
+
+        delete pPipeline;
+        pPipeline = NULL;
+    }
+    return TRUE;
+}
+
+
+// Returns the pipe where the ready output samples are
+VCSDKCoreFIFOSamplePipe *VCSDKCore::outputPipe() const
+{
+    if (pPipeline) return pPipeline->collectOutput();
+    return output;
+}
+
+
+// Copies the sample format, tempo/pitch/rate & processing settings of 'other'
+void VCSDKCore::copySettings(const VCSDKCore &other)
+{
+    int sampleRate, sequenceMs, seekWindowMs, overlapMs;
+
+    setChannels(other.channels);
+
+    targetLatencyMs = 0;
+    virtualRate = other.virtualRate;
+    virtualTempo = other.virtualTempo;
+    virtualPitch = other.virtualPitch;
+    calcEffectiveRateAndTempo();
+
+    // copy the effective time-stretch parameters, also those chosen for a latency target
+    other.pTDStretch->getParameters(&sampleRate, &sequenceMs, &seekWindowMs, &overlapMs);
+    pTDStretch->setParameters(sampleRate, sequenceMs, seekWindowMs, overlapMs);
+    bSrateSet = other.bSrateSet;
+    targetLatencyMs = other.targetLatencyMs;
+
+    pTDStretch->enableQuickSeek(other.pTDStretch->isQuickSeekEnabled());
+    pTDStretch->enableFFTSeek(other.pTDStretch->isFFTSeekEnabled());
+    pTDStretch->enableHierarchicalSeek(other.pTDStretch->isHierarchicalSeekEnabled());
+    pRateTransposer->enableAAFilter(other.pRateTransposer->isAAFilterEnabled());
+    pRateTransposer->enableFusedAAFilter(other.pRateTransposer->isFusedAAFilterEnabled());
+    pRateTransposer->getAAFilter()->setLength(other.pRateTransposer->getAAFilter()->getLength());
+
+    clear();
 }
 
 
@@ -221,8 +358,33 @@ void VCSDKCore::calcEffectiveRateAndTempo()
 void VCSDKCore::setSampleRate(uint srate)
 {
     bSrateSet = TRUE;
+    syncPipeline();
     // set sample rate, leave other tempo changer parameters as they are.
     pTDStretch->setParameters((int)srate);
+
+    if (targetLatencyMs > 0) applyTargetLatency();
+    prepareStages();
+}
+
+
+// Chooses the longest time-stretch sequence, seek window & overlap lengths for
+// which the processing latency fits into 'targetLatencyMs'.
+BOOL VCSDKCore::applyTargetLatency()
+{
+    int sampleRate;
+    int seq;
+    uint budget;
+
+    pTDStretch->getParameters(&sampleRate, NULL, NULL, NULL);
+    budget = (uint)((double)targetLatencyMs * sampleRate / 1000.0);
+
+    for (seq = TARGET_LATENCY_MAX_SEQUENCE_MS; seq >= TARGET_LATENCY_MIN_SEQUENCE_MS; seq --)
+    {
+        pTDStretch->setParameters(sampleRate, seq, seq * 3 / 8, seq / 5);
+        if (getLatencySamples() <= budget) return TRUE;
+    }
+    // budget can't be met, the shortest lengths are now in use
+    return FALSE;
 }
 
 
@@ -230,6 +392,12 @@ void VCSDKCore::setSampleRate(uint srate)
 // the input of the object.
 void VCSDKCore::putSamples(const SAMPLETYPE *samples, uint nSamples)
 {
+    if (bRealtimeSafe)
+    {
+        putSamplesRealtime(samples, nSamples);
+        return;
+    }
+
     if (bSrateSet == FALSE)
     {
         ST_THROW_RT_ERROR("SoundTouch : Sample rate not defined");
@@ -254,21 +422,72 @@ void VCSDKCore::putSamples(const SAMPLETYPE *samples, uint nSamples)
         pTDStretch->putSamples(samples, nSamples);
     }
     */
+    else if (pPipeline)
+    {
+        // the stage workers take it from here
+        pPipeline->putSamples(samples, nSamples);
+        inputSinceChange += nSamples;
+    }
+    else
+    {
+        processBlock(samples, nSamples);
+    }
+}
+
+
+// Feeds the samples through the stages on the calling thread
+void VCSDKCore::processBlock(const SAMPLETYPE *samples, uint nSamples)
+{
 #ifndef SOUNDTOUCH_PREVENT_CLICK_AT_RATE_CROSSOVER
-    else if (rate <= 1.0f)
+    if (rate <= 1.0f)
     {
-        // transpose the rate down, output the transposed sound to tempo changer buffer
+        // transpose the rate down, output the transposed sound straight to the
+        // end of the tempo changer input buffer
         assert(output == pTDStretch);
-        pRateTransposer->putSamples(samples, nSamples);
-        pTDStretch->moveSamples(*pRateTransposer);
+        pRateTransposer->putSamples(samples, nSamples, *pTDStretch->getInput());
+        pTDStretch->processInput();
     }
     else
 #endif
     {
-        // evaluate the tempo changer, then transpose the rate up,
+        // evaluate the tempo changer straight to the end of the pitch transposer
+        // input buffer, then transpose the rate up
+        VCSDKCoreFIFOSampleBuffer *transIn = pRateTransposer->getInput();
+        uint before = transIn->numSamples();
+
         assert(output == pRateTransposer);
-        pTDStretch->putSamples(samples, nSamples);
-        pRateTransposer->moveSamples(*pTDStretch);
+        pTDStretch->putSamples(samples, nSamples, *transIn);
+        if (transIn->numSamples() != before) pRateTransposer->processInput();
+    }
+
+    inputSinceChange += nSamples;
+}
+
+
+// Real-time safe 'putSamples': feeds the input in blocks of up to the prepared
+// size, each only if the buffers have room for it. Otherwise drops the rest of
+// the input instead of growing the buffers.
+void VCSDKCore::putSamplesRealtime(const SAMPLETYPE *samples, uint nSamples)
+{
+    uint block;
+
+    if (bSrateSet == FALSE || channels == 0 || preparedBlockSize == 0)
+    {
+        realtimeDropped += nSamples;
+        return;
+    }
+
+    while (nSamples > 0)
+    {
+        block = (nSamples > preparedBlockSize) ? preparedBlockSize : nSamples;
+        if (!isPrepared(block))
+        {
+            realtimeDropped += nSamples;
+            return;
+        }
+        processBlock(samples, block);
+        samples += block * channels;
+        nSamples -= block;
     }
 }
 
@@ -277,49 +496,118 @@ void VCSDKCore::putSamples(const SAMPLETYPE *samples, uint nSamples)
 // Clears also the internal processing buffers.
 //
 // Note: This function is meant for extracting the last samples of a sound
-// stream. This function may introduce additional blank samples in the end
-// of the sound stream, and thus it's not recommended to call this function
-// in the middle of a sound stream.
+// stream. The output is truncated or padded so that the whole stream produces
+// exactly 'expectedStreamOutput' samples, i.e. what 'getOutputSampleCount'
+// predicts for the input since the latest 'clear'; thus it's not recommended
+// to call this function in the middle of a sound stream.
 void VCSDKCore::flush()
 {
     int i;
-    int nUnprocessed;
-    int nOut;
-    SAMPLETYPE *buff=(SAMPLETYPE*)alloca(64*channels*sizeof(SAMPLETYPE));
+    uint nOut;
+    ulonglong nTarget;
+    VCSDKCoreFIFOSamplePipe *outBuffer;
+    const SAMPLETYPE *buff = pFlushBuffer;
 
-    // check how many samples still await processing, and scale
-    // that by tempo & rate to get expected output sample count
-    nUnprocessed = numUnprocessedSamples();
-    nUnprocessed = (int)((double)nUnprocessed / (tempo * rate) + 0.5);
+    // the whole stream shall produce exactly 'expectedStreamOutput' samples; check
+    // how many of those still are to be received
+    nTarget = expectedStreamOutput();
+    nOut = (nTarget > outputReceived) ? (uint)(nTarget - outputReceived) : 0;
 
-    nOut = numSamples();        // ready samples currently in buffer ...
-    nOut += nUnprocessed;       // ... and how many we expect there to be in the end
-    
-    memset(buff, 0, 64 * channels * sizeof(SAMPLETYPE));
     // "Push" the last active samples out from the processing pipeline by
-    // feeding blank samples into the processing pipeline until new,
-    // processed samples appear in the output (not however, more than
-    // 8ksamples in any case)
-    for (i = 0; i < 128; i ++)
+    // feeding blank samples into the processing pipeline until enough
+    // processed samples appear in the output. With the stage workers, each
+    // round waits for the batch to get through, as in the synchronous pipeline.
+    syncPipeline();
+    for (i = 0; (i < FLUSH_MAX_ROUNDS) && (numSamples() < nOut); i ++)
     {
-        putSamples(buff, 64);
-        if ((int)numSamples() >= nOut)
-        {
-            // Enough new samples have appeared into the output!
-            // As samples come from processing with bigger chunks, now truncate it
-            // back to maximum "nOut" samples to improve duration accuracy
-            adjustAmountOfSamples(nOut);
+        putSamples(buff, FLUSH_BATCH);
+        syncPipeline();
+    }
 
-            // finish
-            break;
-        }
+    // As samples come from processing with bigger chunks, now truncate it
+    // back to exactly "nOut" samples ...
+    adjustAmountOfSamples(nOut);
+
+    // ... or in the unlikely case that the pipeline didn't yield enough samples,
+    // pad the end of the stream with silence
+    outBuffer = outputPipe();
+    if (pPipeline == NULL)
+    {
+        outBuffer = (output == pTDStretch) ? pTDStretch->getOutput() : pRateTransposer->getOutput();
+    }
+    while (outBuffer->numSamples() < nOut)
+    {
+        uint nPad = nOut - outBuffer->numSamples();
+        outBuffer->putSamples(buff, (nPad > FLUSH_BATCH) ? FLUSH_BATCH : nPad);
     }
 
+    // the stream ends here; blank samples fed above don't count as its input
+    outputExpectedBase = (double)nTarget;
+    inputSinceChange = 0;
+
     // Clear working buffers
-    pRateTransposer->clear();
+    pRateTransposer->clearInput();
     pTDStretch->clearInput();
-    // yet leave the 'tempoChanger' output intouched as that's where the
-    // flushed samples are!
+    // yet leave the last stage's output intouched as that's where the
+    // flushed samples are! The intermediate stage's output is cleared.
+    if (output == pTDStretch)
+    {
+        pRateTransposer->getOutput()->clear();
+    }
+    else
+    {
+        pTDStretch->getOutput()->clear();
+    }
+}
+
+
+// Sizes the buffers for 'maxBlockSize', and again whenever the settings change
+void VCSDKCore::prepare(uint maxBlockSize)
+{
+    syncPipeline();
+
+    // flush feeds blank samples in batches of FLUSH_BATCH
+    if (maxBlockSize < FLUSH_BATCH) maxBlockSize = FLUSH_BATCH;
+
+    preparedBlockSize = maxBlockSize;
+    prepareStages();
+}
+
+
+// Sizes the buffers of both stages, the second one for the output of the first.
+// The caller syncs the stage workers.
+void VCSDKCore::prepareStages()
+{
+    const uint maxBlockSize = preparedBlockSize;
+    uint numMid;
+
+    if (maxBlockSize == 0) return;
+
+    if (output == pTDStretch)
+    {
+        numMid = pRateTransposer->prepare(maxBlockSize);
+        pTDStretch->prepare(numMid);
+    }
+    else
+    {
+        numMid = pTDStretch->prepare(maxBlockSize);
+        pRateTransposer->prepare(numMid);
+    }
+}
+
+
+// Checks both stages like 'prepareStages' sizes them
+BOOL VCSDKCore::isPrepared(uint blockSize) const
+{
+    uint numMid, numOut;
+
+    if (output == pTDStretch)
+    {
+        return pRateTransposer->isPrepared(blockSize, &numMid) &&
+               pTDStretch->isPrepared(numMid, &numOut);
+    }
+    return pTDStretch->isPrepared(blockSize, &numMid) &&
+           pRateTransposer->isPrepared(numMid, &numOut);
 }
 
 
@@ -328,6 +616,10 @@ void VCSDKCore::flush()
 BOOL VCSDKCore::setSetting(int settingId, int value)
 {
     int sampleRate, sequenceMs, seekWindowMs, overlapMs;
+    BOOL result = TRUE;
+
+    // the stages may be changed only while the stage workers are idle
+    syncPipeline();
 
     // read current tdstretch routine parameters
     pTDStretch->getParameters(&sampleRate, &sequenceMs, &seekWindowMs, &overlapMs);
@@ -337,36 +629,80 @@ BOOL VCSDKCore::setSetting(int settingId, int value)
         case SETTING_USE_AA_FILTER :
             // enables / disabless anti-alias filter -- 抗混叠滤波器
             pRateTransposer->enableAAFilter((value != 0) ? TRUE : FALSE);
-            return TRUE;
+            break;
 
         case SETTING_AA_FILTER_LENGTH :
             // sets anti-alias filter length -- 抗混叠滤波器长度
             pRateTransposer->getAAFilter()->setLength(value);
-            return TRUE;
+            break;
+
+        case SETTING_USE_FUSED_AA_FILTER :
+            // filters only at the output positions -- 抗混叠滤波与插值合并
+            pRateTransposer->enableFusedAAFilter((value != 0) ? TRUE : FALSE);
+            break;
 
         case SETTING_USE_QUICKSEEK :
             // enables / disables tempo routine quick seeking algorithm -- 节奏常规快速搜索算法
             pTDStretch->enableQuickSeek((value != 0) ? TRUE : FALSE);
-            return TRUE;
+            break;
+
+        case SETTING_USE_FFT_SEEK :
+            // enables / disables FFT cross-correlation seeking -- FFT互相关搜索
+            pTDStretch->enableFFTSeek((value != 0) ? TRUE : FALSE);
+            break;
+
+        case SETTING_USE_HIERARCHICAL_SEEK :
+            // enables / disables coarse-to-fine seeking -- 多分辨率搜索
+            pTDStretch->enableHierarchicalSeek((value != 0) ? TRUE : FALSE);
+            break;
 
         case SETTING_SEQUENCE_MS:
             // change time-stretch sequence duration parameter -- 更改时间拉伸序列持续时间参数
+            targetLatencyMs = 0;
             pTDStretch->setParameters(sampleRate, value, seekWindowMs, overlapMs);
-            return TRUE;
+            break;
 
         case SETTING_SEEKWINDOW_MS:
             // change time-stretch seek window length parameter -- 更改时间拉伸搜索窗口长度参数
+            targetLatencyMs = 0;
             pTDStretch->setParameters(sampleRate, sequenceMs, value, overlapMs);
-            return TRUE;
+            break;
 
         case SETTING_OVERLAP_MS:
             // change time-stretch overlap length parameter -- 更改时间拉伸重叠长度参数
+            targetLatencyMs = 0;
             pTDStretch->setParameters(sampleRate, sequenceMs, seekWindowMs, value);
+            break;
+
+        case SETTING_TARGET_LATENCY_MS:
+            // choose time-stretch parameters for the latency budget -- 按目标延时选择参数
+            targetLatencyMs = (value > 0) ? value : 0;
+            if (targetLatencyMs > 0) result = applyTargetLatency();
+            break;
+
+        case SETTING_PIPELINED_STAGES:
+            // runs the processing stages on threads of their own -- 流水线多线程
+            // the stage workers wait on a lock, not for the real-time safe mode
+            if (bRealtimeSafe && value != 0) return FALSE;
+            return enablePipeline((value != 0) ? TRUE : FALSE);
+
+        case SETTING_REALTIME_SAFE:
+            // no allocation, locks or exceptions in processing -- 实时安全模式
+            bRealtimeSafe = (value != 0) ? TRUE : FALSE;
+            if (bRealtimeSafe)
+            {
+                enablePipeline(FALSE);
+                prepare(((uint)value > preparedBlockSize) ? (uint)value : preparedBlockSize);
+            }
             return TRUE;
 
         default :
             return FALSE;
     }
+
+    // the new settings may need larger buffers
+    prepareStages();
+    return result;
 }
 
 
@@ -386,9 +722,21 @@ int VCSDKCore::getSetting(int settingId) const
         case SETTING_AA_FILTER_LENGTH :
             return pRateTransposer->getAAFilter()->getLength();
 
+        case SETTING_USE_FUSED_AA_FILTER :
+            return (uint)pRateTransposer->isFusedAAFilterEnabled();
+
         case SETTING_USE_QUICKSEEK :
             return (uint)   pTDStretch->isQuickSeekEnabled();
 
+        case SETTING_USE_FFT_SEEK :
+            return (uint)pTDStretch->isFFTSeekEnabled();
+
+        case SETTING_FFT_SEEK_IN_USE :
+            return (uint)pTDStretch->isFFTSeekInUse();
+
+        case SETTING_USE_HIERARCHICAL_SEEK :
+            return (uint)pTDStretch->isHierarchicalSeekEnabled();
+
         case SETTING_SEQUENCE_MS:
             pTDStretch->getParameters(NULL, &temp, NULL, NULL);
             return temp;
@@ -407,6 +755,18 @@ int VCSDKCore::getSetting(int settingId) const
         case SETTING_NOMINAL_OUTPUT_SEQUENCE :
             return pTDStretch->getOutputBatchSize();
 
+        case SETTING_TARGET_LATENCY_MS :
+            return targetLatencyMs;
+
+        case SETTING_PIPELINED_STAGES :
+            return (pPipeline != NULL) ? 1 : 0;
+
+        case SETTING_REALTIME_SAFE :
+            return (uint)bRealtimeSafe;
+
+        case SETTING_REALTIME_DROPPED_SAMPLES :
+            return (realtimeDropped > INT_MAX) ? INT_MAX : (int)realtimeDropped;
+
         default :
             return 0;
     }
@@ -417,16 +777,143 @@ int VCSDKCore::getSetting(int settingId) const
 // buffers.
 void VCSDKCore::clear()
 {
+    syncPipeline();
+    if (pPipeline) pPipeline->clear();
     pRateTransposer->clear();
     pTDStretch->clear();
+
+    outputExpectedBase = 0;
+    inputSinceChange = 0;
+    outputReceived = 0;
+    realtimeDropped = 0;
 }
 
 
+// Returns the exact number of output samples produced by 'numInputSamples' input
+// samples with the current settings
+ulonglong VCSDKCore::getOutputSampleCount(ulonglong numInputSamples) const
+{
+    return (ulonglong)((double)numInputSamples / ((double)tempo * rate) + 0.5);
+}
+
+
+// Returns the exact output length of the current stream so far
+ulonglong VCSDKCore::expectedStreamOutput() const
+{
+    return (ulonglong)(outputExpectedBase + (double)inputSinceChange / ((double)tempo * rate) + 0.5);
+}
+
+
+uint VCSDKCore::receiveSamples(SAMPLETYPE *outBuffer, uint maxSamples)
+{
+    uint num = outputPipe()->receiveSamples(outBuffer, maxSamples);
+    outputReceived += num;
+    return num;
+}
+
+
+uint VCSDKCore::receiveSamples(uint maxSamples)
+{
+    uint num = outputPipe()->receiveSamples(maxSamples);
+    outputReceived += num;
+    return num;
+}
+
+
+uint VCSDKCore::numSamples() const
+{
+    return outputPipe()->numSamples();
+}
+
+
+int VCSDKCore::isEmpty() const
+{
+    return outputPipe()->isEmpty();
+}
+
+
+uint VCSDKCore::adjustAmountOfSamples(uint numSamples)
+{
+    return outputPipe()->adjustAmountOfSamples(numSamples);
+}
+
+
+SAMPLETYPE *VCSDKCore::ptrBegin()
+{
+    return outputPipe()->ptrBegin();
+}
+
+
+
+/// Returns the worst-case number of output samples the processing pipeline
+/// holds back with the current settings
+uint VCSDKCore::getLatencySamples() const
+{
+    double latency;
+
+#ifndef SOUNDTOUCH_PREVENT_CLICK_AT_RATE_CROSSOVER
+    if (rate <= 1.0f)
+    {
+        // rate transposer first, its output feeds the tempo changer
+        latency = ((double)pRateTransposer->getLatency() / rate + pTDStretch->getLatency()) / tempo;
+    }
+    else
+#endif
+    {
+        // tempo changer first, its output feeds the rate transposer
+        latency = ((double)pTDStretch->getLatency() / tempo + pRateTransposer->getLatency()) / rate;
+    }
+
+    // one more sample for the fractional skip & output length rounding
+    return (uint)ceil(latency) + 1;
+}
+
+
+/// Reads the per-stage processing statistics
+BOOL VCSDKCore::getStats(VCSDKCoreStats &stats) const
+{
+#ifdef VCSDKCORE_ENABLE_STATS
+    // the stage workers update the counters
+    syncPipeline();
+
+    const VCSDKCoreStats &td = pTDStretch->getStats();
+    const VCSDKCoreStats &tr = pRateTransposer->getStats();
+
+    // each stage fills in its own counters, the rest stay zero
+    stats = td;
+    stats.stage[STATS_AA_FILTER] = tr.stage[STATS_AA_FILTER];
+    stats.stage[STATS_TRANSPOSE] = tr.stage[STATS_TRANSPOSE];
+    stats.transposerInputHighWater = tr.transposerInputHighWater;
+    stats.transposerMidHighWater = tr.transposerMidHighWater;
+    stats.transposerOutputHighWater = tr.transposerOutputHighWater;
+    return TRUE;
+#else
+    stats.reset();
+    return FALSE;
+#endif
+}
+
+
+/// Resets the per-stage processing statistics
+void VCSDKCore::resetStats()
+{
+#ifdef VCSDKCORE_ENABLE_STATS
+    syncPipeline();
+    pTDStretch->resetStats();
+    pRateTransposer->resetStats();
+#endif
+}
+
 
 /// Returns number of samples currently unprocessed.
 uint VCSDKCore::numUnprocessedSamples() const
 {
     VCSDKCoreFIFOSamplePipe * psp;
+    if (pPipeline)
+    {
+        // the stage buffers belong to the worker threads, count the queued input only
+        return pPipeline->numQueuedInput();
+    }
     if (pTDStretch)
     {
         psp = pTDStretch->getInput();
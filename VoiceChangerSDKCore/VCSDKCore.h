@@ -28,6 +28,7 @@
 
 #include "VCSDKCoreFIFOSamplePipe.h"
 #include "VCSDKCoreType.h"
+#include "VCSDKCoreStats.h"
 
 
 namespace vcsdkcore {
@@ -96,6 +97,72 @@ namespace vcsdkcore {
 #define SETTING_NOMINAL_OUTPUT_SEQUENCE        7
 
 
+/// Target processing latency in milliseconds. When nonzero, the time-stretch sequence,
+/// seek window & overlap lengths are chosen as the longest ones for which
+/// 'getLatencySamples' fits into the given budget, and chosen again whenever the
+/// tempo/pitch/rate or sample rate change. Zero (default) keeps the manual settings;
+/// setting SETTING_SEQUENCE_MS, SETTING_SEEKWINDOW_MS or SETTING_OVERLAP_MS clears it.
+///
+/// setSetting returns FALSE if even the shortest lengths exceed the budget; the
+/// shortest lengths are used in that case. -- 目标延时(ms)，自动选择帧长/搜索窗/叠加长度
+#define SETTING_TARGET_LATENCY_MS   8
+
+/// Enable/disable computing the full overlap position search of the tempo changer
+/// with FFT cross-correlation (0 = disable). Same search & result quality as the
+/// default full seek, but the cost grows as O(n log n) instead of seek window x
+/// overlap length. Enabling times both seeks once, and the full seek is still used
+/// where it measured cheaper, which with the SIMD correlation routines is all but
+/// very long overlaps. SETTING_USE_QUICKSEEK has precedence when both are enabled.
+/// "getSetting" returns whether it's enabled, see SETTING_FFT_SEEK_IN_USE for
+/// whether it's used. -- 是否使用FFT互相关做完整查找
+#define SETTING_USE_FFT_SEEK        9
+
+/// Enable/disable coarse-to-fine overlap position search of the tempo changer
+/// (0 = disable). The seek window is scanned on ~8 kHz decimated signals and the
+/// best position refined at full rate, cutting the correlation work by about the
+/// decimation factor (sample rate / 8 kHz) at close to full search quality.
+/// SETTING_USE_QUICKSEEK has precedence, this one over SETTING_USE_FFT_SEEK.
+/// -- 是否使用多分辨率(先降采样粗查再精查)查找
+#define SETTING_USE_HIERARCHICAL_SEEK   10
+
+/// Enable/disable running the rate transposer & tempo changer each on a thread of
+/// its own (0 = disable, default), connected with bounded lock-free queues. The
+/// calling thread then only queues the input & collects the output, which shortens
+/// its processing time on multi-core hosts. Output, 'flush' & 'getOutputSampleCount'
+/// behave the same as in the synchronous pipeline, but 'numSamples' only grows as
+/// the worker threads get the samples through. -- 是否各处理环节分别在独立线程上流水线运行
+#define SETTING_PIPELINED_STAGES    11
+
+/// Enable/disable the real-time safe mode (0 = disable, default) for running
+/// 'putSamples' & 'receiveSamples' in an audio callback thread. Enabling calls
+/// 'prepare' with the value as the block size (or the size of an earlier 'prepare'
+/// call if that's larger), and after that those calls do no heap allocation, take
+/// no locks, throw no exceptions & make no system calls. 'putSamples' feeds longer
+/// input to the stages in prepared size blocks, and instead of growing a buffer
+/// it drops the rest of the input, see SETTING_REALTIME_DROPPED_SAMPLES; that
+/// happens if the output isn't received often enough, or if the sample rate or
+/// channels aren't set. Stops the stage worker threads of SETTING_PIPELINED_STAGES,
+/// which can't be enabled in this mode. -- 实时安全模式，处理时不分配内存、不加锁、不抛异常
+#define SETTING_REALTIME_SAFE       12
+
+/// Call "getSetting" with this ID to query the number of input samples dropped
+/// in the real-time safe mode since the latest 'clear'. Read-only.
+/// -- 实时安全模式下丢弃的输入采样数
+#define SETTING_REALTIME_DROPPED_SAMPLES    13
+
+/// Enable/disable the fused anti-alias filter of the pitch transposer (0 = disable,
+/// default). When the rate is above 1.0, the low-pass filter is evaluated only at
+/// the output positions instead of for every input sample before interpolating,
+/// so the cost scales with the output rate. -- 抗混叠滤波与插值合并，只在输出位置计算滤波
+#define SETTING_USE_FUSED_AA_FILTER 14
+
+/// Call "getSetting" with this ID to query whether the tempo changer actually
+/// seeks with FFT: SETTING_USE_FFT_SEEK is enabled, no other seek has precedence,
+/// and the FFT seek measured faster for the current parameters. Read-only.
+/// -- 当前参数下是否实际使用FFT互相关查找
+#define SETTING_FFT_SEEK_IN_USE     15
+
+
 class VCSDKCore: public VCSDKCoreFIFOProcessor {
     
     
@@ -106,6 +173,45 @@ private:
     /// Time-stretch class instance
     class VCSDKCoreTDStretch *pTDStretch;
 
+    /// Stage worker threads, see SETTING_PIPELINED_STAGES. NULL when not used.
+    class VCSDKCorePipeline *pPipeline;
+
+    /// Waits until the stage worker threads have processed all the queued input.
+    /// The stages may be accessed from the calling thread only after this.
+    void syncPipeline() const;
+
+    /// Starts/stops the stage worker threads. Returns FALSE if the number of
+    /// channels isn't set yet.
+    BOOL enablePipeline(BOOL enable);
+
+    /// Returns the pipe where the ready output samples are
+    VCSDKCoreFIFOSamplePipe *outputPipe() const;
+
+    /// Flag: real-time safe mode, see SETTING_REALTIME_SAFE
+    BOOL bRealtimeSafe;
+
+    /// Input block size of the latest 'prepare' call, zero if not prepared
+    uint preparedBlockSize;
+
+    /// Input samples dropped in the real-time safe mode since the latest 'clear'
+    ulonglong realtimeDropped;
+
+    /// Blank samples fed by 'flush', allocated along with the number of channels
+    SAMPLETYPE *pFlushBuffer;
+
+    /// Feeds 'nSamples' samples through the stages
+    void processBlock(const SAMPLETYPE *samples, uint nSamples);
+
+    /// 'putSamples' of the real-time safe mode
+    void putSamplesRealtime(const SAMPLETYPE *samples, uint nSamples);
+
+    /// Sizes the stage buffers for 'preparedBlockSize', if set
+    void prepareStages();
+
+    /// Returns nonzero if the stages can process a block of 'blockSize' input
+    /// samples without allocating
+    BOOL isPrepared(uint blockSize) const;
+
     /// Virtual pitch parameter. Effective rate & tempo are calculated from these parameters.
     float virtualRate;
 
@@ -118,11 +224,38 @@ private:
     /// Flag: Has sample rate been set?
     BOOL  bSrateSet;
 
+    /// Target latency in milliseconds, see SETTING_TARGET_LATENCY_MS. Zero = not used.
+    int targetLatencyMs;
+
+    /// Chooses the time-stretch parameters for 'targetLatencyMs'. Returns FALSE if
+    /// the budget can't be met.
+    BOOL applyTargetLatency();
+
+    /// Output length accounting of the current stream: expected output of the input
+    /// that was put before the latest effective rate/tempo change.
+    double outputExpectedBase;
+
+    /// Input samples put since the latest effective rate/tempo change.
+    ulonglong inputSinceChange;
+
+    /// Output samples received from the current stream.
+    ulonglong outputReceived;
+
+    /// Returns the exact output length of the current stream so far, see 'getOutputSampleCount'.
+    ulonglong expectedStreamOutput() const;
+
     /// Calculates effective rate & tempo valuescfrom 'virtualRate', 'virtualTempo' and
     /// 'virtualPitch' parameters.
     void calcEffectiveRateAndTempo();
 
+    /// Copies the sample format, tempo/pitch/rate & processing settings of 'other',
+    /// used for setting up the segment workers of 'processSegmented'.
+    void copySettings(const VCSDKCore &other);
+
 protected :
+    /// Returns a pointer to the beginning of the ready output samples.
+    virtual SAMPLETYPE *ptrBegin();
+
     /// Number of channels
     uint  channels;
 
@@ -192,16 +325,17 @@ public:
     /// Clears also the internal processing buffers.
     //
     /// Note: This function is meant for extracting the last samples of a sound
-    /// stream. This function may introduce additional blank samples in the end
-    /// of the sound stream, and thus it's not recommended to call this function
-    /// in the middle of a sound stream.
+    /// stream. After flushing, the stream has produced exactly as many samples as
+    /// 'getOutputSampleCount' predicts for the input put since the latest 'clear',
+    /// so it's not recommended to call this function in the middle of a sound stream.
     // 冲出处理管道中的最后一组“残留”的数据，应在最后执行
     void flush();
 
     // 输入采样数据
     /// Adds 'numSamples' pcs of samples from the 'samples' memory position into
     /// the input of the object. Notice that sample rate _has_to_ be set before
-    /// calling this function, otherwise throws a runtime_error exception.
+    /// calling this function, otherwise throws a runtime_error exception
+    /// (drops the input in the real-time safe mode, see SETTING_REALTIME_SAFE).
     virtual void putSamples(
             const SAMPLETYPE *samples,  ///< Pointer to sample buffer.
             uint numSamples                         ///< Number of samples in buffer. Notice
@@ -213,6 +347,36 @@ public:
     /// buffers.
     virtual void clear();
 
+    /// Returns the exact number of output samples that 'numInputSamples' input samples
+    /// produce with the current tempo/rate/pitch settings once the stream is flushed,
+    /// i.e. round(numInputSamples / (tempo * rate)). Use this to preallocate output
+    /// buffers. -- 预测输出采样数，用于一次性分配输出缓冲区
+    ulonglong getOutputSampleCount(ulonglong numInputSamples) const;
+
+    /// Processes a whole sound at once: 'numSamples' samples from 'input' are split
+    /// into 'numThreads' overlapping segments that are processed in parallel, each
+    /// with its own tempo changer & rate transposer, and the segment seams are
+    /// joined with a correlation-aligned crossfade. Writes exactly
+    /// 'getOutputSampleCount(numSamples)' samples to 'output' and returns that count.
+    ///
+    /// Meant for offline file conversion. Clears the object's stream like 'clear';
+    /// short sounds, and 'numThreads' <= 1, are processed sequentially.
+    /// -- 离线分段多线程处理整段音频，输出长度与顺序处理相同
+    ulonglong processSegmented(const SAMPLETYPE *input, ulonglong numSamples,
+                               SAMPLETYPE *output, uint numThreads);
+    /// Output samples from beginning of the sample buffer, see 'FIFOProcessor'.
+    /// Overridden for the output length accounting used by 'flush'.
+    virtual uint receiveSamples(SAMPLETYPE *outBuffer, uint maxSamples);
+
+    /// Removes samples from beginning of the sample buffer, see 'FIFOProcessor'.
+    virtual uint receiveSamples(uint maxSamples);
+    /// Returns number of samples ready for receiving, see 'FIFOProcessor'.
+    virtual uint numSamples() const;
+    /// Returns nonzero if there aren't any samples ready for receiving.
+    virtual int isEmpty() const;
+    /// Trims the amount of ready samples, see 'FIFOProcessor'.
+    virtual uint adjustAmountOfSamples(uint numSamples);
+
     /// Changes a setting controlling the processing system behaviour. See the
     /// 'SETTING_...' defines for available setting ID's.
     ///  >>> mSoundTouch.setSetting(SETTING_USE_QUICKSEEK, quick);
@@ -231,6 +395,31 @@ public:
     /// Returns number of samples currently unprocessed.
     virtual uint numUnprocessedSamples() const;
 
+    /// Returns the worst-case number of output samples the processing pipeline
+    /// holds back with the current settings, i.e. how far the output may lag
+    /// behind the input after any 'putSamples' call. The value depends only on
+    /// the settings, not on the sound content. -- 处理管道的最大延时(输出采样数)
+    uint getLatencySamples() const;
+
+    /// Sizes all the processing buffers up front for 'putSamples' calls of up to
+    /// 'maxBlockSize' samples with the current settings, when the output is received
+    /// after each call. Then processing allocates no memory. The block size is
+    /// remembered and the buffers are sized again whenever the tempo/pitch/rate,
+    /// the format or the settings change, so those calls may allocate instead; the
+    /// buffers never shrink. Not done for the stage worker threads of
+    /// SETTING_PIPELINED_STAGES. -- 预先分配处理缓冲区，之后处理时不再分配内存
+    void prepare(uint maxBlockSize);
+
+    /// Reads the per-stage timing & sample counters and the FIFO high-water marks
+    /// accumulated since construction or the latest 'resetStats'. Returns FALSE and
+    /// zeroes 'stats' if the library was built without VCSDKCORE_ENABLE_STATS.
+    /// With SETTING_PIPELINED_STAGES, waits for the stage worker threads first.
+    /// -- 各处理环节的耗时统计，需定义VCSDKCORE_ENABLE_STATS
+    BOOL getStats(VCSDKCoreStats &stats) const;
+
+    /// Resets the statistics read by 'getStats'
+    void resetStats();
+
 
     /// Other handy functions that are implemented in the ancestor classes (see
     /// classes 'FIFOProcessor' and 'FIFOSamplePipe')
@@ -12,6 +12,7 @@
 #include <stdlib.h>
 #include "VCSDKCoreAAFilter.hpp"
 #include "VCSDKCoreFIRFilter.hpp"
+#include "VCSDKCoreFilterCache.hpp"
 
 using namespace vcsdkcore;
 
@@ -53,6 +54,7 @@ VCSDKCoreAAFilter::VCSDKCoreAAFilter(uint len)
 {
     pFIR = VCSDKCoreFIRFilter::newInstance();
     cutoffFreq = 0.5;
+    length = 0;
     setLength(len);
 }
 
@@ -86,23 +88,21 @@ void VCSDKCoreAAFilter::setLength(uint newLength)
 
 
 // Calculates coefficients for a low-pass FIR filter using Hamming window
-void VCSDKCoreAAFilter::calculateCoeffs()
+static VCSDKCoreFilterDesign *_designAAFilter(double cutoffFreq, uint length)
 {
     uint i;
     double cntTemp, temp, tempCoeff,h, w;
     double wc;
     double scaleCoeff, sum;
-    double *work;
-    SAMPLETYPE *coeffs;
+    double *work = new double[length];
+    SAMPLETYPE *coeffs = new SAMPLETYPE[length];
+    VCSDKCoreFIRCoeffs *design;
 
     assert(length >= 2);
     assert(length % 4 == 0);
     assert(cutoffFreq >= 0);
     assert(cutoffFreq <= 0.5);
 
-    work = new double[length];
-    coeffs = new SAMPLETYPE[length];
-
     wc = 2.0 * PI * cutoffFreq;
     tempCoeff = TWOPI / (double)length;
 
@@ -153,13 +153,24 @@ void VCSDKCoreAAFilter::calculateCoeffs()
         coeffs[i] = (SAMPLETYPE)temp;
     }
 
-    // Set coefficients. Use divide factor 14 => divide result by 2^14 = 16384
-    pFIR->setCoefficients(coeffs, length, 14);
-
     _DEBUG_SAVE_AAFIR_COEFFS(coeffs, length);
 
+    // Use divide factor 14 => divide result by 2^14 = 16384
+    design = new VCSDKCoreFIRCoeffs(coeffs, length, 14);
+
     delete[] work;
     delete[] coeffs;
+    return design;
+}
+
+
+// Takes the coefficients for the cutoff-frequency & length from the filter cache
+void VCSDKCoreAAFilter::calculateCoeffs()
+{
+    VCSDKCoreFilterDesignPtr design;
+
+    design = VCSDKCoreFilterCache::get(VCSDKCoreFilterCache::AA_FILTER, cutoffFreq, length, _designAAFilter);
+    pFIR->shareCoefficients(std::static_pointer_cast<const VCSDKCoreFIRCoeffs>(design));
 }
 
 
@@ -31,7 +31,8 @@ protected:
     /// num of filter taps
     uint length;
 
-    /// Calculate the FIR coefficients realizing the given cutoff-frequency
+    /// Takes the FIR coefficients realizing the given cutoff-frequency from the
+    /// process-wide filter cache, designing them if not found
     void calculateCoeffs();
 public:
     VCSDKCoreAAFilter(uint length);
@@ -40,7 +41,8 @@ public:
 
     /// Sets new anti-alias filter cut-off edge frequency, scaled to sampling
     /// frequency (nyquist frequency = 0.5). The filter will cut off the
-    /// frequencies than that.
+    /// frequencies than that. Doesn't allocate if the filter has been designed
+    /// before, by any instance.
     void setCutoffFreq(double newCutoffFreq);
 
     /// Sets number of FIR filter taps, i.e. ~filter complexity
@@ -0,0 +1,321 @@
+////  VCSDKCoreAAResampler.cpp
+//  VoiceChanger
+//
+//  Anti-alias filtering & sample rate transposing in one pass.
+//
+
+#include <assert.h>
+#include <math.h>
+#include "VCSDKCoreAAResampler.hpp"
+#include "VCSDKCoreCpu_detect.h"
+#include "VCSDKCoreAllocator.hpp"
+
+using namespace vcsdkcore;
+
+
+#define PI        3.141592655357989
+#define TWOPI    (2 * PI)
+
+
+/// Kernel table kept in the filter cache
+class VCSDKCoreAAResamplerTable : public VCSDKCoreFilterDesign
+{
+public:
+    SAMPLETYPE *table;
+
+    VCSDKCoreAAResamplerTable(uint length)
+    {
+        table = (SAMPLETYPE *)VCSDKCoreAllocator::allocShared((size_t)(AA_RESAMPLER_PHASES + 1) * length * sizeof(SAMPLETYPE));
+    }
+
+    virtual ~VCSDKCoreAAResamplerTable()
+    {
+        VCSDKCoreAllocator::free(table);
+    }
+};
+
+
+VCSDKCoreAAResampler::VCSDKCoreAAResampler()
+{
+    pTable = NULL;
+    length = 0;
+    cutoffFreq = 0;
+    rate = 1.0f;
+    fract = 0;
+    numChannels = 1;
+}
+
+
+VCSDKCoreAAResampler::~VCSDKCoreAAResampler()
+{
+}
+
+
+VCSDKCoreAAResampler *VCSDKCoreAAResampler::newInstance()
+{
+#ifdef SOUNDTOUCH_ALLOW_MMX
+    if (detectCPUextensions() & SUPPORT_MMX)
+    {
+        return new VCSDKCoreAAResamplerMMX;
+    }
+#endif // SOUNDTOUCH_ALLOW_MMX
+#ifdef SOUNDTOUCH_ALLOW_SSE
+    if (detectCPUextensions() & SUPPORT_SSE)
+    {
+        return new VCSDKCoreAAResamplerSSE;
+    }
+#endif // SOUNDTOUCH_ALLOW_SSE
+    return new VCSDKCoreAAResampler;
+}
+
+
+// Sets the rate & the filter length, designs a new kernel table if they changed
+void VCSDKCoreAAResampler::setParameters(float newRate, uint newLength)
+{
+    assert(newRate > 1.0f);
+    if (newLength % 8) ST_THROW_RT_ERROR("FIR filter length not divisible by 8");
+
+    rate = newRate;
+    if (isDesigned(newRate, newLength)) return;
+
+    length = newLength;
+    cutoffFreq = 0.5 / newRate;
+    pDesign = VCSDKCoreFilterCache::get(VCSDKCoreFilterCache::AA_RESAMPLER, cutoffFreq, length, design);
+    pTable = static_cast<const VCSDKCoreAAResamplerTable *>(pDesign.get())->table;
+}
+
+
+BOOL VCSDKCoreAAResampler::isDesigned(float newRate, uint newLength) const
+{
+    return (length == newLength) && (cutoffFreq == 0.5 / newRate);
+}
+
+
+// Designs the low-pass filter as VCSDKCoreAAFilter does, a Hamming windowed sinc,
+// but sampled at the fractional offset of each phase. Tap k of row p weights the
+// input sample at k - (length / 2 - 1) - p / phases from the output position, so
+// that the taps stay within the window for all phases. The sines & cosines of
+// a row advance by a constant angle per tap, so they're rotated instead of
+// calling sin & cos for every tap of every phase.
+VCSDKCoreFilterDesign *VCSDKCoreAAResampler::design(double cutoffFreq, uint length)
+{
+    VCSDKCoreAAResamplerTable *result = new VCSDKCoreAAResamplerTable(length);
+    const double wc = TWOPI * cutoffFreq;
+    const double tempCoeff = TWOPI / (double)length;
+    const double stepSin = sin(wc);
+    const double stepCos = cos(wc);
+    const double stepWinSin = sin(tempCoeff);
+    const double stepWinCos = cos(tempCoeff);
+    double work[128];
+    double *pWork = (length <= 128) ? work : VCSDKCoreAllocator::allocArray<double>(length);
+    uint p, k;
+
+    for (p = 0; p <= AA_RESAMPLER_PHASES; p ++)
+    {
+        SAMPLETYPE *row = result->table + p * length;
+        const double first = -(double)(length / 2 - 1) - (double)p / (double)AA_RESAMPLER_PHASES;
+        double s = sin(first * wc);
+        double c = cos(first * wc);
+        double ws = sin(first * tempCoeff);
+        double wcos = cos(first * tempCoeff);
+        double sum = 0;
+
+        for (k = 0; k < length; k ++)
+        {
+            double temp = ((double)k + first) * wc;
+            double h = (temp != 0) ? s / temp : 1.0;        // sinc function
+            double w = 0.54 + 0.46 * wcos;                   // hamming window
+            double next;
+
+            pWork[k] = w * h;
+            sum += pWork[k];
+
+            next = s * stepCos + c * stepSin;
+            c = c * stepCos - s * stepSin;
+            s = next;
+            next = ws * stepWinCos + wcos * stepWinSin;
+            wcos = wcos * stepWinCos - ws * stepWinSin;
+            ws = next;
+        }
+        assert(sum > 0);
+
+        for (k = 0; k < length; k ++)
+        {
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+            // scale so that the result can be divided by 16384, and round
+            double temp = pWork[k] * 16384.0 / sum;
+            temp += (temp >= 0) ? 0.5 : -0.5;
+            assert(temp >= -32768 && temp <= 32767);
+            row[k] = (SAMPLETYPE)temp;
+#else
+            row[k] = (SAMPLETYPE)(pWork[k] / sum);
+#endif
+        }
+    }
+
+    if (pWork != work) VCSDKCoreAllocator::free(pWork);
+    return result;
+}
+
+
+void VCSDKCoreAAResampler::setChannels(int channels)
+{
+    assert(channels > 0);
+    numChannels = channels;
+    resetRegisters();
+}
+
+
+void VCSDKCoreAAResampler::resetRegisters()
+{
+    fract = 0;
+}
+
+
+uint VCSDKCoreAAResampler::getLength() const
+{
+    return length;
+}
+
+
+// Scales an accumulated sum to the sample type
+static inline SAMPLETYPE _toSample(LONG_SAMPLETYPE sum)
+{
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+    sum >>= 14;
+    // saturate to 16 bit integer limits
+    sum = (sum < -32768) ? -32768 : (sum > 32767) ? 32767 : sum;
+#endif // SOUNDTOUCH_INTEGER_SAMPLES
+    return (SAMPLETYPE)sum;
+}
+
+
+// Usual C-version of the resampling routine for mono sound
+int VCSDKCoreAAResampler::resampleMono(SAMPLETYPE *pdest, const SAMPLETYPE *psrc, int &srcSamples)
+{
+    int i = 0;
+    int srcSampleEnd = srcSamples - (int)length;
+    int srcCount = 0;
+
+    while (srcCount < srcSampleEnd)
+    {
+        const SAMPLETYPE *coeffs = getRow();
+        LONG_SAMPLETYPE sum = 0;
+
+        for (uint k = 0; k < length; k += 4)
+        {
+            // loop is unrolled by factor of 4 here for efficiency
+            sum += psrc[k + 0] * coeffs[k + 0] +
+                   psrc[k + 1] * coeffs[k + 1] +
+                   psrc[k + 2] * coeffs[k + 2] +
+                   psrc[k + 3] * coeffs[k + 3];
+        }
+        pdest[i] = _toSample(sum);
+        i ++;
+
+        int whole = advance();
+        psrc += whole;
+        srcCount += whole;
+    }
+    srcSamples = srcCount;
+    return i;
+}
+
+
+// Usual C-version of the resampling routine for stereo sound
+int VCSDKCoreAAResampler::resampleStereo(SAMPLETYPE *pdest, const SAMPLETYPE *psrc, int &srcSamples)
+{
+    int i = 0;
+    int srcSampleEnd = srcSamples - (int)length;
+    int srcCount = 0;
+
+    while (srcCount < srcSampleEnd)
+    {
+        const SAMPLETYPE *coeffs = getRow();
+        LONG_SAMPLETYPE suml = 0, sumr = 0;
+
+        for (uint k = 0; k < length; k += 2)
+        {
+            suml += psrc[2 * k + 0] * coeffs[k + 0] +
+                    psrc[2 * k + 2] * coeffs[k + 1];
+            sumr += psrc[2 * k + 1] * coeffs[k + 0] +
+                    psrc[2 * k + 3] * coeffs[k + 1];
+        }
+        pdest[2 * i] = _toSample(suml);
+        pdest[2 * i + 1] = _toSample(sumr);
+        i ++;
+
+        int whole = advance();
+        psrc += 2 * whole;
+        srcCount += whole;
+    }
+    srcSamples = srcCount;
+    return i;
+}
+
+
+// Usual C-version of the resampling routine for any number of channels
+int VCSDKCoreAAResampler::resampleMulti(SAMPLETYPE *pdest, const SAMPLETYPE *psrc, int &srcSamples)
+{
+    int i = 0;
+    int srcSampleEnd = srcSamples - (int)length;
+    int srcCount = 0;
+
+    while (srcCount < srcSampleEnd)
+    {
+        const SAMPLETYPE *coeffs = getRow();
+
+        for (int c = 0; c < numChannels; c ++)
+        {
+            const SAMPLETYPE *ptr = psrc + c;
+            LONG_SAMPLETYPE sum = 0;
+
+            for (uint k = 0; k < length; k ++)
+            {
+                sum += *ptr * coeffs[k];
+                ptr += numChannels;
+            }
+            *pdest = _toSample(sum);
+            pdest ++;
+        }
+        i ++;
+
+        int whole = advance();
+        psrc += numChannels * whole;
+        srcCount += whole;
+    }
+    srcSamples = srcCount;
+    return i;
+}
+
+
+// Filters & transposes the samples of 'src' to the end of 'dest'
+uint VCSDKCoreAAResampler::evaluate(VCSDKCoreFIFOSampleBuffer &dest, VCSDKCoreFIFOSampleBuffer &src)
+{
+    int numSrcSamples = src.numSamples();
+    int sizeDemand = (int)((float)numSrcSamples / rate) + 8;
+    int numOutput;
+    const SAMPLETYPE *psrc = src.ptrBegin();
+    SAMPLETYPE *pdest = dest.ptrEnd(sizeDemand);
+
+    assert(length > 0);
+    assert(numChannels == (int)src.getChannels());
+
+#ifndef USE_MULTICH_ALWAYS
+    if (numChannels == 1)
+    {
+        numOutput = resampleMono(pdest, psrc, numSrcSamples);
+    }
+    else if (numChannels == 2)
+    {
+        numOutput = resampleStereo(pdest, psrc, numSrcSamples);
+    }
+    else
+#endif // USE_MULTICH_ALWAYS
+    {
+        numOutput = resampleMulti(pdest, psrc, numSrcSamples);
+    }
+    dest.putSamples(numOutput);
+    src.receiveSamples(numSrcSamples);
+    return (uint)numOutput;
+}
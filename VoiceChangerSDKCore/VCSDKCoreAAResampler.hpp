@@ -0,0 +1,119 @@
+////  VCSDKCoreAAResampler.hpp
+//  VoiceChanger
+//
+//  Anti-alias filtering & sample rate transposing in one pass for rates above
+//  1.0: the band-limiting low-pass filter is evaluated only at the output
+//  positions, with a kernel table of fractional phases, instead of filtering
+//  every input sample & interpolating between the filtered samples.
+//
+
+#ifndef VCSDKCoreAAResampler_hpp
+#define VCSDKCoreAAResampler_hpp
+
+#include <stddef.h>
+#include "VCSDKCoreFIFOSampleBuffer.hpp"
+#include "VCSDKCoreFilterCache.hpp"
+#include "VCSDKCoreType.h"
+
+
+namespace vcsdkcore {
+
+
+/// Number of fractional phases in the kernel table. An output position is
+/// rounded to the nearest phase, i.e. by at most 1/512 of an input sample.
+#define AA_RESAMPLER_PHASES     256
+
+
+class VCSDKCoreAAResampler {
+
+protected:
+    /// Kernel table, AA_RESAMPLER_PHASES + 1 rows of 'length' taps. Row 'p' is the
+    /// low-pass filter shifted by p / AA_RESAMPLER_PHASES input samples. Integer
+    /// coefficients are scaled by 2^14 like those of VCSDKCoreAAFilter. Points
+    /// into 'pDesign', which is shared with the other instances via the filter cache.
+    const SAMPLETYPE *pTable;
+    VCSDKCoreFilterDesignPtr pDesign;
+
+    /// Filter taps & cut-off frequency (nyquist = 0.5) of the current table,
+    /// zero when not designed
+    uint length;
+    double cutoffFreq;
+
+    float rate;
+    float fract;
+    int numChannels;
+
+    /// Designs the kernel table for 'length' taps & 'cutoffFreq'
+    static VCSDKCoreFilterDesign *design(double cutoffFreq, uint length);
+
+    /// Returns the kernel table row for the current 'fract'
+    inline const SAMPLETYPE *getRow() const
+    {
+        return pTable + (int)(fract * AA_RESAMPLER_PHASES + 0.5f) * length;
+    }
+
+    /// Advances the position by 'rate', returns the number of whole input samples
+    inline int advance()
+    {
+        fract += rate;
+        int whole = (int)fract;
+        fract -= whole;
+        return whole;
+    }
+
+    virtual int resampleMono(SAMPLETYPE *dest, const SAMPLETYPE *src, int &srcSamples);
+    virtual int resampleStereo(SAMPLETYPE *dest, const SAMPLETYPE *src, int &srcSamples);
+    virtual int resampleMulti(SAMPLETYPE *dest, const SAMPLETYPE *src, int &srcSamples);
+
+public:
+    VCSDKCoreAAResampler();
+    virtual ~VCSDKCoreAAResampler();
+
+    /// Use this function instead of "new" operator to create a new instance of this class.
+    /// Chooses an implementation optimized for the CPU if one is available.
+    static VCSDKCoreAAResampler *newInstance();
+
+    /// Sets the transposing rate (> 1.0) & the number of filter taps (divisible by
+    /// 8). Takes the kernel table with cut-off frequency 0.5 / rate from the filter
+    /// cache if either changed; allocates only if the table isn't cached yet.
+    void setParameters(float newRate, uint newLength);
+
+    /// Returns nonzero if the kernel table is designed for 'newRate' & 'newLength'
+    BOOL isDesigned(float newRate, uint newLength) const;
+
+    void setChannels(int channels);
+
+    /// Resets the position so that the next sample starts a new stream
+    void resetRegisters();
+
+    /// Returns the number of input samples held back between two batches
+    uint getLength() const;
+
+    /// Filters & transposes the samples of 'src' to the end of 'dest'. The consumed
+    /// samples are removed from 'src'. Returns the number of output samples.
+    uint evaluate(VCSDKCoreFIFOSampleBuffer &dest, VCSDKCoreFIFOSampleBuffer &src);
+};
+
+
+#ifdef SOUNDTOUCH_ALLOW_MMX
+/// Class that implements MMX optimized dot products for the integer sample type.
+class VCSDKCoreAAResamplerMMX : public VCSDKCoreAAResampler {
+protected:
+    virtual int resampleMono(short *dest, const short *src, int &srcSamples);
+    virtual int resampleStereo(short *dest, const short *src, int &srcSamples);
+};
+#endif // SOUNDTOUCH_ALLOW_MMX
+
+
+#ifdef SOUNDTOUCH_ALLOW_SSE
+/// Class that implements SSE optimized dot products for the float sample type.
+class VCSDKCoreAAResamplerSSE : public VCSDKCoreAAResampler {
+protected:
+    virtual int resampleMono(float *dest, const float *src, int &srcSamples);
+    virtual int resampleStereo(float *dest, const float *src, int &srcSamples);
+};
+#endif // SOUNDTOUCH_ALLOW_SSE
+
+}
+
+#endif /* VCSDKCoreAAResampler_hpp */
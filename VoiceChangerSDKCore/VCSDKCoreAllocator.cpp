@@ -0,0 +1,264 @@
+////  VCSDKCoreAllocator.cpp
+//  VoiceChanger
+//
+//  Pluggable memory allocator for the sample & work buffers of the core.
+//
+
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "VCSDKCoreAllocator.hpp"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+using namespace vcsdkcore;
+
+
+/// Huge page size assumed for rounding up a huge page backed arena
+#define HUGE_PAGE_SIZE      (2 * 1024 * 1024)
+
+/// Helper for aligning a size or an address up to 'alignment', a power of two
+#define ALIGN_UP(x, alignment)      ( ( (size_t)(x) + (alignment) - 1 ) & ~((size_t)(alignment) - 1) )
+
+
+/// Book-keeping stored in front of each block returned by 'alloc'. Takes a whole
+/// VCSDKCORE_ALIGNMENT bytes so that the block stays aligned.
+struct AllocHeader
+{
+    VCSDKCoreAllocator *owner;
+    size_t size;                ///< Size of the whole block including the header
+};
+
+
+/// Default allocator: malloc with the alignment done by over-allocating. The
+/// original pointer is stored just before the aligned block.
+class DefaultAllocator : public VCSDKCoreAllocator
+{
+public:
+    virtual void *allocate(size_t size, size_t alignment)
+    {
+        char *raw = (char *)malloc(size + alignment + sizeof(void *));
+        char *aligned;
+
+        if (raw == NULL) return NULL;
+        aligned = (char *)ALIGN_UP(raw + sizeof(void *), alignment);
+        ((void **)aligned)[-1] = raw;
+        return aligned;
+    }
+
+    virtual void deallocate(void *ptr, size_t size)
+    {
+        (void)size;
+        if (ptr) ::free(((void **)ptr)[-1]);
+    }
+};
+
+
+static VCSDKCoreAllocator *_defaultAllocator()
+{
+    static DefaultAllocator allocator;
+    return &allocator;
+}
+
+
+// Custom allocator, NULL for the default one
+static std::atomic<VCSDKCoreAllocator *> _customAllocator(NULL);
+
+
+/*****************************************************************************
+ *
+ * Implementation of the class 'VCSDKCoreAllocator'
+ *
+ *****************************************************************************/
+
+void VCSDKCoreAllocator::setAllocator(VCSDKCoreAllocator *allocator)
+{
+    _customAllocator.store(allocator);
+}
+
+
+VCSDKCoreAllocator *VCSDKCoreAllocator::getAllocator()
+{
+    VCSDKCoreAllocator *allocator = _customAllocator.load();
+    return allocator ? allocator : _defaultAllocator();
+}
+
+
+BOOL VCSDKCoreAllocator::isCustomAllocator()
+{
+    return (_customAllocator.load() != NULL) ? TRUE : FALSE;
+}
+
+
+// Allocates an aligned block with a header from 'allocator'
+static void *_allocFrom(VCSDKCoreAllocator *allocator, size_t size)
+{
+    size_t total = size + VCSDKCORE_ALIGNMENT;
+    char *block;
+    AllocHeader *header;
+
+    block = (char *)allocator->allocate(total, VCSDKCORE_ALIGNMENT);
+    if (block == NULL)
+    {
+        ST_THROW_RT_ERROR("Couldn't allocate memory!\n");
+    }
+    assert(((size_t)block & (VCSDKCORE_ALIGNMENT - 1)) == 0);
+
+    header = (AllocHeader *)block;
+    header->owner = allocator;
+    header->size = total;
+    return block + VCSDKCORE_ALIGNMENT;
+}
+
+
+void *VCSDKCoreAllocator::alloc(size_t size)
+{
+    return _allocFrom(getAllocator(), size);
+}
+
+
+void *VCSDKCoreAllocator::allocShared(size_t size)
+{
+    return _allocFrom(_defaultAllocator(), size);
+}
+
+
+void VCSDKCoreAllocator::free(void *ptr)
+{
+    AllocHeader *header;
+
+    if (ptr == NULL) return;
+    header = (AllocHeader *)((char *)ptr - VCSDKCORE_ALIGNMENT);
+    header->owner->deallocate(header, header->size);
+}
+
+
+/*****************************************************************************
+ *
+ * Implementation of the class 'VCSDKCoreArenaAllocator'
+ *
+ *****************************************************************************/
+
+VCSDKCoreArenaAllocator::VCSDKCoreArenaAllocator(size_t capacityBytes, BOOL useHugePages)
+{
+    pool = NULL;
+    capacity = capacityBytes;
+    used.store(0);
+    bMapped = FALSE;
+    bHugePages = FALSE;
+
+#if defined(__linux__) && defined(MAP_ANONYMOUS)
+    if (useHugePages)
+    {
+        void *ptr = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        // explicit huge pages, available if the system has reserved some
+        size_t hugeCapacity = ALIGN_UP(capacityBytes, HUGE_PAGE_SIZE);
+        ptr = mmap(NULL, hugeCapacity, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr != MAP_FAILED)
+        {
+            capacity = hugeCapacity;
+            bHugePages = TRUE;
+        }
+#endif
+        if (ptr == MAP_FAILED)
+        {
+            // regular pages, but ask for transparent huge pages
+            ptr = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#ifdef MADV_HUGEPAGE
+            if (ptr != MAP_FAILED) madvise(ptr, capacity, MADV_HUGEPAGE);
+#endif
+        }
+        if (ptr != MAP_FAILED)
+        {
+            pool = (char *)ptr;
+            bMapped = TRUE;
+        }
+    }
+#else
+    (void)useHugePages;
+#endif
+
+    if (pool == NULL)
+    {
+        pool = (char *)_defaultAllocator()->allocate(capacity, VCSDKCORE_ALIGNMENT);
+        if (pool == NULL) capacity = 0;
+    }
+}
+
+
+VCSDKCoreArenaAllocator::~VCSDKCoreArenaAllocator()
+{
+#if defined(__linux__) && defined(MAP_ANONYMOUS)
+    if (bMapped)
+    {
+        munmap(pool, capacity);
+        return;
+    }
+#endif
+    _defaultAllocator()->deallocate(pool, capacity);
+}
+
+
+// Bumps the arena pointer, or falls back to the default allocator if the arena is full
+void *VCSDKCoreArenaAllocator::allocate(size_t size, size_t alignment)
+{
+    size_t current = used.load();
+    size_t start, end;
+
+    do
+    {
+        start = ALIGN_UP(pool + current, alignment) - (size_t)pool;
+        end = start + size;
+        if (pool == NULL || end > capacity)
+        {
+            return _defaultAllocator()->allocate(size, alignment);
+        }
+    } while (!used.compare_exchange_weak(current, end));
+
+    return pool + start;
+}
+
+
+// Reclaims the memory if it's the latest block of the arena, otherwise it's
+// reclaimed only by 'reset'
+void VCSDKCoreArenaAllocator::deallocate(void *ptr, size_t size)
+{
+    char *block = (char *)ptr;
+
+    if (block >= pool && block < pool + capacity)
+    {
+        size_t end = (size_t)(block - pool) + size;
+        used.compare_exchange_strong(end, (size_t)(block - pool));
+        return;
+    }
+    _defaultAllocator()->deallocate(ptr, size);
+}
+
+
+void VCSDKCoreArenaAllocator::reset()
+{
+    used.store(0);
+}
+
+
+size_t VCSDKCoreArenaAllocator::getUsed() const
+{
+    return used.load();
+}
+
+
+size_t VCSDKCoreArenaAllocator::getCapacity() const
+{
+    return capacity;
+}
+
+
+BOOL VCSDKCoreArenaAllocator::isHugePages() const
+{
+    return bHugePages;
+}
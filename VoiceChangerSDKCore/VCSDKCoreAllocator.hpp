@@ -0,0 +1,118 @@
+////  VCSDKCoreAllocator.hpp
+//  VoiceChanger
+//
+//  Pluggable memory allocator for the sample & work buffers of the core.
+//
+
+
+#ifndef VCSDKCoreAllocator_hpp
+#define VCSDKCoreAllocator_hpp
+
+#include <stddef.h>
+#include <atomic>
+#include "VCSDKCoreType.h"
+
+
+/// Alignment of all buffers allocated through VCSDKCoreAllocator: a cache line,
+/// and the width of an AVX-512 register.
+#define VCSDKCORE_ALIGNMENT     64
+
+
+namespace vcsdkcore {
+
+
+/// Memory allocator interface for the buffers of the core.
+///
+/// All the sample buffers, filter coefficients & work arrays are allocated through
+/// 'alloc' / 'free', which use the allocator set with 'setAllocator'. Every block
+/// remembers its allocator, so an allocator may be changed any time but must stay
+/// alive until the buffers allocated from it are freed. Filter designs shared
+/// through VCSDKCoreFilterCache are the exception, see 'allocShared'.
+class VCSDKCoreAllocator
+{
+public:
+    virtual ~VCSDKCoreAllocator() {}
+
+    /// Returns 'size' bytes of memory aligned to 'alignment' bytes, a power of two,
+    /// or NULL if out of memory. May be called from several threads at a time.
+    virtual void *allocate(size_t size, size_t alignment) = 0;
+
+    /// Releases memory returned by 'allocate'.
+    virtual void deallocate(void *ptr, size_t size) = 0;
+
+    /// Sets the allocator for the buffers allocated after this call. NULL restores
+    /// the default allocator that uses malloc.
+    static void setAllocator(VCSDKCoreAllocator *allocator);
+
+    /// Returns the current allocator
+    static VCSDKCoreAllocator *getAllocator();
+
+    /// Returns nonzero if an allocator other than the default one is set
+    static BOOL isCustomAllocator();
+
+    /// Allocates 'size' bytes aligned to VCSDKCORE_ALIGNMENT with the current
+    /// allocator. Throws a runtime error if out of memory.
+    static void *alloc(size_t size);
+
+    /// Allocates 'size' bytes aligned to VCSDKCORE_ALIGNMENT with the default
+    /// allocator, for memory that isn't owned by any one instance & may outlive
+    /// a custom allocator, e.g. the cached filter designs. Release with 'free'.
+    static void *allocShared(size_t size);
+
+    /// Releases memory allocated by 'alloc' or 'allocShared'. NULL is ignored.
+    static void free(void *ptr);
+
+    /// Allocates an uninitialized array of 'count' items of a plain type
+    template <class T> static T *allocArray(size_t count)
+    {
+        return (T *)alloc(count * sizeof(T));
+    }
+};
+
+
+/// Arena allocator: hands out memory from one block reserved up front by
+/// bumping a pointer, so allocations are cheap & lock-free and the buffers are
+/// close together. Memory is reclaimed only when the latest block is freed or
+/// by 'reset'. When the arena is full, allocations fall back to the default
+/// allocator.
+///
+/// On Linux the arena can be backed by huge pages to reduce TLB misses; if huge
+/// pages aren't available, regular pages are used with a transparent huge page
+/// hint.
+class VCSDKCoreArenaAllocator : public VCSDKCoreAllocator
+{
+private:
+    char *pool;
+    size_t capacity;
+    std::atomic<size_t> used;
+
+    /// Nonzero if 'pool' is mapped with mmap, zero if allocated by the default allocator
+    BOOL bMapped;
+    BOOL bHugePages;
+
+public:
+    VCSDKCoreArenaAllocator(size_t capacityBytes,   ///< Size of the arena
+                            BOOL useHugePages = FALSE  ///< Back the arena by huge pages if possible
+                            );
+    virtual ~VCSDKCoreArenaAllocator();
+
+    virtual void *allocate(size_t size, size_t alignment);
+    virtual void deallocate(void *ptr, size_t size);
+
+    /// Makes the whole arena available again. Only call when none of the memory
+    /// allocated from the arena is in use anymore.
+    void reset();
+
+    /// Returns the number of arena bytes in use
+    size_t getUsed() const;
+
+    /// Returns the arena size in bytes
+    size_t getCapacity() const;
+
+    /// Returns nonzero if the arena is backed by huge pages
+    BOOL isHugePages() const;
+};
+
+}
+
+#endif /* VCSDKCoreAllocator_hpp */
@@ -15,16 +15,41 @@
 #define SUPPORT_ALTIVEC     0x0004
 #define SUPPORT_SSE         0x0008
 #define SUPPORT_SSE2        0x0010
+#define SUPPORT_AVX2        0x0020
+#define SUPPORT_AVX         0x0040
+#define SUPPORT_FMA         0x0080
+#define SUPPORT_AVX512      0x0100      ///< AVX-512 F & BW
+
+/// Instruction set tiers for limitExtensions, each includes the lower tiers.
+#define CPU_TIER_GENERIC    0
+#define CPU_TIER_SSE2       (SUPPORT_MMX | SUPPORT_SSE | SUPPORT_SSE2)
+#define CPU_TIER_AVX2       (CPU_TIER_SSE2 | SUPPORT_AVX | SUPPORT_FMA | SUPPORT_AVX2)
+#define CPU_TIER_AVX512     (CPU_TIER_AVX2 | SUPPORT_AVX512)
+
+/// Extensions the AVX2 routines need; the floating point ones use FMA as well.
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+#define SUPPORT_AVX2_ROUTINES   SUPPORT_AVX2
+#else
+#define SUPPORT_AVX2_ROUTINES   (SUPPORT_AVX2 | SUPPORT_FMA)
+#endif
 
 
 /// Checks which instruction set extensions are supported by the CPU.
 ///
+/// The CPU (cpuid) & OS (xgetbv) support is detected once per process, thread-safe.
+/// Instances created by the newInstance() factories pick their routines by this.
+///
 /// \return A bitmask of supported extensions, see SUPPORT_... defines.
 uint detectCPUextensions(void);
 
 /// Disables given set of instruction extensions. See SUPPORT_... defines.
 void disableExtensions(uint wDisableMask);
 
+/// Limits the instruction extensions to the given tier, see CPU_TIER_... defines.
+/// Defaults to environment variable VCSDKCORE_CPU_TIER = generic / sse2 / avx2 / avx512
+/// if set, otherwise no limit. Affects instances created after the call.
+void limitExtensions(uint tierMask);
+
 
 
 #endif /* VCSDKCoreCpu_detect_h */
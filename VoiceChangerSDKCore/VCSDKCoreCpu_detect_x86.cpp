@@ -2,26 +2,44 @@
 //  VoiceChangerCFramework
 //
 //  Created on 2020/12/15.
-//  
+//
 //
 
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
 #include "VCSDKCoreCpu_detect.h"
 #include "VCSDKCoreType.h"
 
 
 #if defined(SOUNDTOUCH_ALLOW_X86_OPTIMIZATIONS)
 
-   #if defined(__GNUC__) && defined(__i386__)
+   #if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
        // gcc
        #include "cpuid.h"
-   #elif defined(_M_IX86)
+       #define HAVE_CPUID  1
+   #elif defined(_M_IX86) || defined(_M_X64)
        // windows non-gcc
        #include <intrin.h>
+       #define HAVE_CPUID  1
    #endif
 
+   // cpuid leaf 1, edx
    #define bit_MMX     (1 << 23)
    #define bit_SSE     (1 << 25)
    #define bit_SSE2    (1 << 26)
+   // cpuid leaf 1, ecx
+   #define bit_FMA_ECX     (1 << 12)
+   #define bit_OSXSAVE_ECX (1 << 27)
+   #define bit_AVX_ECX     (1 << 28)
+   // cpuid leaf 7, ebx
+   #define bit_AVX2_EBX    (1 << 5)
+   #define bit_AVX512F_EBX (1 << 16)
+   #define bit_AVX512BW_EBX (1 << 30)
+
+   // xcr0: XMM & YMM state, and the AVX-512 opmask & ZMM state
+   #define XCR0_AVX        0x06
+   #define XCR0_AVX512     0xe6
 #endif
 
 
@@ -32,76 +50,146 @@
 //////////////////////////////////////////////////////////////////////////////
 
 // Flag variable indicating whick ISA extensions are disabled (for debugging)
-static uint _dwDisabledISA = 0x00;      // 0xffffffff; //<- use this to disable all extensions
+static std::atomic<uint> _dwDisabledISA(0x00);  // 0xffffffff; //<- use this to disable all extensions
+
+// Tier limit, see limitExtensions. Initialized from VCSDKCORE_CPU_TIER
+static std::atomic<uint> _dwTierLimit(0xffffffff);
+
 
 // Disables given set of instruction extensions. See SUPPORT_... defines.
 void disableExtensions(uint dwDisableMask)
 {
-    _dwDisabledISA = dwDisableMask;
+    _dwDisabledISA.store(dwDisableMask);
 }
 
 
+// Limits the instruction extensions to the given tier. See CPU_TIER_... defines.
+void limitExtensions(uint tierMask)
+{
+    _dwTierLimit.store(tierMask);
+}
 
-/// Checks which instruction set extensions are supported by the CPU.
-uint detectCPUextensions(void)
+
+#if defined(HAVE_CPUID)
+
+static void _cpuid(uint leaf, uint reg[4])
 {
-/// If building for a 64bit system (no Itanium) and the user wants optimizations.
-/// Return the OR of SUPPORT_{MMX,SSE,SSE2}. 11001 or 0x19.
-/// Keep the _dwDisabledISA test (2 more operations, could be eliminated).
-#if ((defined(__GNUC__) && defined(__x86_64__)) \
-    || defined(_M_X64))  \
-    && defined(SOUNDTOUCH_ALLOW_X86_OPTIMIZATIONS)
-    return 0x19 & ~_dwDisabledISA;
-
-/// If building for a 32bit system and the user wants optimizations.
-/// Keep the _dwDisabledISA test (2 more operations, could be eliminated).
-#elif ((defined(__GNUC__) && defined(__i386__)) \
-    || defined(_M_IX86))  \
-    && defined(SOUNDTOUCH_ALLOW_X86_OPTIMIZATIONS)
-
-    if (_dwDisabledISA == 0xffffffff) return 0;
- 
-    uint res = 0;
- 
 #if defined(__GNUC__)
-    // GCC version of cpuid. Requires GCC 4.3.0 or later for __cpuid intrinsic support.
-    uint eax, ebx, ecx, edx;  // unsigned int is the standard type. uint is defined by the compiler and not guaranteed to be portable.
-
-    // Check if no cpuid support.
-    if (!__get_cpuid (1, &eax, &ebx, &ecx, &edx)) return 0; // always disable extensions.
+    __cpuid_count(leaf, 0, reg[0], reg[1], reg[2], reg[3]);
+#else
+    __cpuidex((int *)reg, (int)leaf, 0);
+#endif
+}
 
-    if (edx & bit_MMX)  res = res | SUPPORT_MMX;
-    if (edx & bit_SSE)  res = res | SUPPORT_SSE;
-    if (edx & bit_SSE2) res = res | SUPPORT_SSE2;
 
+static unsigned long long _xgetbv0()
+{
+#if defined(__GNUC__)
+    uint eax, edx;
+    __asm__ ("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+    return ((unsigned long long)edx << 32) | eax;
 #else
-    // Window / VS version of cpuid. Notice that Visual Studio 2005 or later required
-    // for __cpuid intrinsic support.
-    int reg[4] = {-1};
+    return _xgetbv(0);
+#endif
+}
 
-    // Check if no cpuid support.
-    __cpuid(reg,0);
-    if ((unsigned int)reg[0] == 0) return 0; // always disable extensions.
 
-    __cpuid(reg,1);
-    if ((unsigned int)reg[3] & bit_MMX)  res = res | SUPPORT_MMX;
-    if ((unsigned int)reg[3] & bit_SSE)  res = res | SUPPORT_SSE;
-    if ((unsigned int)reg[3] & bit_SSE2) res = res | SUPPORT_SSE2;
+/// Queries the CPU with cpuid, and the OS register saving support with xgetbv.
+/// The wider vector extensions are reported only if the OS saves the registers.
+static uint _detectHardware()
+{
+    uint reg[4];
+    uint maxLeaf;
+    uint res = 0;
+    unsigned long long xcr0 = 0;
 
+#if defined(__GNUC__)
+    maxLeaf = __get_cpuid_max(0, NULL);
+#else
+    _cpuid(0, reg);
+    maxLeaf = reg[0];
 #endif
+    // no cpuid support.
+    if (maxLeaf < 1) return 0;
+
+    _cpuid(1, reg);
+    if (reg[3] & bit_MMX)  res |= SUPPORT_MMX;
+    if (reg[3] & bit_SSE)  res |= SUPPORT_SSE;
+    if (reg[3] & bit_SSE2) res |= SUPPORT_SSE2;
+
+    if (reg[2] & bit_OSXSAVE_ECX)
+    {
+        xcr0 = _xgetbv0();
+    }
+    if ((reg[2] & bit_AVX_ECX) && (xcr0 & XCR0_AVX) == XCR0_AVX)
+    {
+        res |= SUPPORT_AVX;
+        if (reg[2] & bit_FMA_ECX) res |= SUPPORT_FMA;
+    }
+
+    if ((res & SUPPORT_AVX) && maxLeaf >= 7)
+    {
+        _cpuid(7, reg);
+        if (reg[1] & bit_AVX2_EBX) res |= SUPPORT_AVX2;
+        if ((reg[1] & bit_AVX512F_EBX) && (reg[1] & bit_AVX512BW_EBX) && (xcr0 & XCR0_AVX512) == XCR0_AVX512)
+        {
+            res |= SUPPORT_AVX512;
+        }
+    }
+    return res;
+}
 
-    return res & ~_dwDisabledISA;
+#endif // HAVE_CPUID
 
-#else
 
-/// One of these is true:
-/// 1) We don't want optimizations.
-/// 2) Using an unsupported compiler.
-/// 3) Running on a non-x86 platform.
-    return 0;
+/// Parses VCSDKCORE_CPU_TIER = generic / sse2 / avx2 / avx512 into a tier mask.
+static uint _tierFromEnvironment()
+{
+    const char *tier = getenv("VCSDKCORE_CPU_TIER");
+
+    if (tier == NULL) return 0xffffffff;
+    if (strcmp(tier, "generic") == 0) return CPU_TIER_GENERIC;
+    if (strcmp(tier, "sse2") == 0) return CPU_TIER_SSE2;
+    if (strcmp(tier, "avx2") == 0) return CPU_TIER_AVX2;
+    if (strcmp(tier, "avx512") == 0) return CPU_TIER_AVX512;
+    return 0xffffffff;
+}
+
 
+/// Detects the extensions once per process. Function-local static
+/// initialization is thread-safe, so concurrent first calls are fine.
+static uint _hardwareExtensions()
+{
+    struct Detected
+    {
+        uint extensions;
+
+        Detected()
+        {
+#if defined(HAVE_CPUID)
+            extensions = _detectHardware();
+#else
+            /// One of these is true:
+            /// 1) We don't want optimizations.
+            /// 2) Using an unsupported compiler.
+            /// 3) Running on a non-x86 platform.
+            extensions = 0;
 #endif
+            // environment only sets the default, an earlier limitExtensions call wins
+            uint unlimited = 0xffffffff;
+            _dwTierLimit.compare_exchange_strong(unlimited, _tierFromEnvironment());
+        }
+    };
+    static const Detected detected;
+
+    return detected.extensions;
 }
 
 
+/// Checks which instruction set extensions are supported by the CPU.
+uint detectCPUextensions(void)
+{
+    uint res = _hardwareExtensions();
 
+    return res & _dwTierLimit.load() & ~_dwDisabledISA.load();
+}
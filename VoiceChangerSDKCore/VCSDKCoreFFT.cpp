@@ -0,0 +1,202 @@
+////  VCSDKCoreFFT.cpp
+//  VoiceChanger
+//
+//  Radix-2 FFT used for computing the TDStretch overlap cross-correlation at
+//  all seek offsets at once.
+//
+
+
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include "VCSDKCoreFFT.hpp"
+#include "VCSDKCoreAllocator.hpp"
+
+using namespace vcsdkcore;
+
+
+#define TWOPI    6.283185307179586477
+
+
+/*****************************************************************************
+ *
+ * Implementation of the class 'VCSDKCoreFFT'
+ *
+ *****************************************************************************/
+
+VCSDKCoreFFT::VCSDKCoreFFT()
+{
+    size = 0;
+    log2Size = 0;
+    capacity = 0;
+    log2Capacity = 0;
+    pCos = pSin = NULL;
+    pBitRev = NULL;
+    pRe = pIm = NULL;
+    pSpecRe = pSpecIm = NULL;
+}
+
+
+
+VCSDKCoreFFT::~VCSDKCoreFFT()
+{
+    freeBuffers();
+}
+
+
+
+void VCSDKCoreFFT::freeBuffers()
+{
+    VCSDKCoreAllocator::free(pCos);
+    VCSDKCoreAllocator::free(pSin);
+    VCSDKCoreAllocator::free(pBitRev);
+    VCSDKCoreAllocator::free(pRe);
+    VCSDKCoreAllocator::free(pIm);
+    VCSDKCoreAllocator::free(pSpecRe);
+    VCSDKCoreAllocator::free(pSpecIm);
+    pCos = pSin = NULL;
+    pBitRev = NULL;
+    pRe = pIm = NULL;
+    pSpecRe = pSpecIm = NULL;
+}
+
+
+
+// Sets the transform size to the smallest power of two of at least 'minLength'.
+void VCSDKCoreFFT::setSize(uint minLength)
+{
+    uint newSize = 2;
+    uint newLog2 = 1;
+    uint i;
+
+    while (newSize < minLength)
+    {
+        newSize <<= 1;
+        newLog2 ++;
+    }
+    size = newSize;
+    log2Size = newLog2;
+    if (newSize <= capacity) return;
+
+    // the tables & buffers only grow, smaller transforms use every n-th twiddle
+    // factor & the top bits of the bit-reversed indices
+    freeBuffers();
+    capacity = newSize;
+    log2Capacity = newLog2;
+
+    pCos = VCSDKCoreAllocator::allocArray<double>(capacity / 2);
+    pSin = VCSDKCoreAllocator::allocArray<double>(capacity / 2);
+    pBitRev = VCSDKCoreAllocator::allocArray<uint>(capacity);
+    pRe = VCSDKCoreAllocator::allocArray<double>(capacity);
+    pIm = VCSDKCoreAllocator::allocArray<double>(capacity);
+    pSpecRe = VCSDKCoreAllocator::allocArray<double>(capacity);
+    pSpecIm = VCSDKCoreAllocator::allocArray<double>(capacity);
+
+    // twiddle factors exp(-2*pi*i*k/capacity)
+    for (i = 0; i < capacity / 2; i ++)
+    {
+        pCos[i] = cos(TWOPI * i / capacity);
+        pSin[i] = -sin(TWOPI * i / capacity);
+    }
+
+    for (i = 0; i < capacity; i ++)
+    {
+        uint rev = 0;
+        for (uint b = 0; b < log2Capacity; b ++)
+        {
+            rev |= ((i >> b) & 1) << (log2Capacity - 1 - b);
+        }
+        pBitRev[i] = rev;
+    }
+}
+
+
+
+// In-place iterative decimation-in-time forward transform
+void VCSDKCoreFFT::transform(double *re, double *im) const
+{
+    uint i, j, half, step;
+    const uint revShift = log2Capacity - log2Size;
+
+    for (i = 0; i < size; i ++)
+    {
+        j = pBitRev[i] >> revShift;
+        if (j > i)
+        {
+            double t;
+            t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    for (half = 1, step = capacity / 2; half < size; half <<= 1, step >>= 1)
+    {
+        for (i = 0; i < size; i += 2 * half)
+        {
+            for (j = 0; j < half; j ++)
+            {
+                double wr = pCos[j * step];
+                double wi = pSin[j * step];
+                uint a = i + j;
+                uint b = a + half;
+                double tr = re[b] * wr - im[b] * wi;
+                double ti = re[b] * wi + im[b] * wr;
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+}
+
+
+
+const double *VCSDKCoreFFT::crossCorrelate(const SAMPLETYPE *signal, uint signalLength,
+                                           const SAMPLETYPE *kernel, uint kernelLength)
+{
+    uint i;
+
+    assert(signalLength <= size);
+    assert(kernelLength <= signalLength);
+
+    // z = signal + i * kernel, zero padded to the transform size
+    for (i = 0; i < signalLength; i ++)
+    {
+        pRe[i] = (double)signal[i];
+    }
+    for (i = 0; i < kernelLength; i ++)
+    {
+        pIm[i] = (double)kernel[i];
+    }
+    memset(pRe + signalLength, 0, (size - signalLength) * sizeof(double));
+    memset(pIm + kernelLength, 0, (size - kernelLength) * sizeof(double));
+
+    transform(pRe, pIm);
+
+    // Separate the spectra S & K of the two real inputs,
+    //   S[k] = (Z[k] + conj(Z[-k])) / 2,  K[k] = (Z[k] - conj(Z[-k])) / 2i
+    // and form the correlation spectrum S[k] * conj(K[k]), conjugated for the
+    // inverse transform that is done with the forward routine.
+    for (i = 0; i < size; i ++)
+    {
+        uint n = (size - i) & (size - 1);
+        double sr = 0.5 * (pRe[i] + pRe[n]);
+        double si = 0.5 * (pIm[i] - pIm[n]);
+        double kr = 0.5 * (pIm[i] + pIm[n]);
+        double ki = 0.5 * (pRe[n] - pRe[i]);
+
+        pSpecRe[i] = sr * kr + si * ki;
+        pSpecIm[i] = -(si * kr - sr * ki);
+    }
+
+    transform(pSpecRe, pSpecIm);
+
+    // the result is real, scale the inverse transform
+    double scale = 1.0 / (double)size;
+    for (i = 0; i <= signalLength - kernelLength; i ++)
+    {
+        pSpecRe[i] *= scale;
+    }
+    return pSpecRe;
+}
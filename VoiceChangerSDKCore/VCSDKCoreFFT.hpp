@@ -0,0 +1,75 @@
+////  VCSDKCoreFFT.hpp
+//  VoiceChanger
+//
+//  Radix-2 FFT used for computing the TDStretch overlap cross-correlation at
+//  all seek offsets at once.
+//
+
+
+#ifndef VCSDKCoreFFT_hpp
+#define VCSDKCoreFFT_hpp
+
+#include "VCSDKCoreType.h"
+
+
+namespace vcsdkcore {
+
+
+/// Cross-correlation of real sample sequences through a complex radix-2 FFT.
+///
+/// Both real inputs are transformed with one complex FFT (signal in the real part,
+/// kernel in the imaginary part) and the product spectrum is transformed back with
+/// a second one. Twiddle, bit-reversal & work buffers are allocated by setSize()
+/// only, and only for a size larger than any before, so that crossCorrelate()
+/// doesn't allocate & switching between sizes doesn't either.
+class VCSDKCoreFFT
+{
+private:
+    uint size;
+    uint log2Size;
+
+    /// Size the tables & buffers are allocated for, at least 'size'
+    uint capacity;
+    uint log2Capacity;
+
+    double *pCos;
+    double *pSin;
+    uint *pBitRev;
+
+    double *pRe;
+    double *pIm;
+    double *pSpecRe;
+    double *pSpecIm;
+
+    void freeBuffers();
+
+    /// In-place forward transform of 'size' complex values
+    void transform(double *re, double *im) const;
+
+public:
+    VCSDKCoreFFT();
+    ~VCSDKCoreFFT();
+
+    /// Sets the transform size to the smallest power of two of at least 'minLength'.
+    /// Buffers are reallocated only if the size grows past the largest one so far.
+    void setSize(uint minLength);
+
+    /// Returns the current transform size, zero if not set
+    uint getSize() const
+    {
+        return size;
+    }
+
+    /// Calculates result[lag] = sum(signal[lag + k] * kernel[k], k = 0 .. kernelLength - 1)
+    /// for lag = 0 .. signalLength - kernelLength. 'signalLength' must not exceed getSize().
+    ///
+    /// Returns pointer to the results, valid until the next call.
+    const double *crossCorrelate(const SAMPLETYPE *signal,
+                                 uint signalLength,
+                                 const SAMPLETYPE *kernel,
+                                 uint kernelLength);
+};
+
+}
+
+#endif /* VCSDKCoreFFT_hpp */
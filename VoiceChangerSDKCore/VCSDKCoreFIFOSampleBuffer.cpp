@@ -12,17 +12,132 @@
 
 
 #include "VCSDKCoreFIFOSampleBuffer.hpp"
+#include "VCSDKCoreAllocator.hpp"
+
+#ifdef VCSDKCORE_MIRRORED_FIFO
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include <atomic>
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC     0x0001U
+#endif
+#endif
 
 using namespace vcsdkcore;
 
 
+#ifdef VCSDKCORE_MIRRORED_FIFO
+
+// Greatest common divisor, for rounding the mirror size to whole pages & frames
+static uint _gcd(uint a, uint b)
+{
+    while (b)
+    {
+        uint t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+
+// Returns the mirror size in bytes for at least 'bytes' bytes: a multiple of both
+// the page size, as required by mmap, and the frame size, so that the frames
+// wrap around exactly at the end of the buffer. Returns zero on overflow.
+static uint _mirrorSize(uint bytes, uint frameBytes)
+{
+    const ulonglong page = (ulonglong)sysconf(_SC_PAGESIZE);
+    const ulonglong step = page / _gcd((uint)page, frameBytes) * frameBytes;
+    const ulonglong size = ((ulonglong)bytes + step - 1) / step * step;
+
+    // both halves must fit in 'uint' byte offsets
+    return (size * 2 > 0xffffffffULL) ? 0 : (uint)size;
+}
+
+
+// Number of mirrored buffers alive in the process, see VCSDKCORE_MIRRORED_FIFO_MAX
+static std::atomic<int> _mirrorCount(0);
+
+
+// Maps 'size' bytes of anonymous shared memory twice back-to-back, so that
+// byte 'size + i' is byte 'i'. Returns NULL if that isn't possible.
+static void *_mirrorMap(uint size)
+{
+#ifdef SYS_memfd_create
+    int fd;
+    char *base;
+    void *first, *second;
+
+    if (size == 0) return NULL;
+
+    fd = (int)syscall(SYS_memfd_create, "vcsdkcore-fifo", MFD_CLOEXEC);
+    if (fd < 0) return NULL;
+    if (ftruncate(fd, size) != 0)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    // reserve address space for both halves, then map the memory over them
+    base = (char *)mmap(NULL, (size_t)size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == (char *)MAP_FAILED)
+    {
+        close(fd);
+        return NULL;
+    }
+    first = mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    second = mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    // the mappings keep the memory alive
+    close(fd);
+
+    if (first != base || second != base + size)
+    {
+        munmap(base, (size_t)size * 2);
+        return NULL;
+    }
+    return base;
+#else
+    (void)size;
+    return NULL;
+#endif
+}
+
+
+// Allocates a mirrored buffer of 'size' bytes, see _mirrorMap. Returns NULL also
+// if VCSDKCORE_MIRRORED_FIFO_MAX mirrored buffers are alive already.
+static void *_mirrorAlloc(uint size)
+{
+    void *ptr = NULL;
+
+    if (_mirrorCount.fetch_add(1) < VCSDKCORE_MIRRORED_FIFO_MAX)
+    {
+        ptr = _mirrorMap(size);
+    }
+    if (ptr == NULL) _mirrorCount.fetch_sub(1);
+    return ptr;
+}
+
+
+static void _mirrorFree(void *ptr, uint size)
+{
+    munmap(ptr, (size_t)size * 2);
+    _mirrorCount.fetch_sub(1);
+}
+
+#endif // VCSDKCORE_MIRRORED_FIFO
+
+
+
 // Constructor
 VCSDKCoreFIFOSampleBuffer::VCSDKCoreFIFOSampleBuffer(int numChannels)
 {
     assert(numChannels > 0);
     sizeInBytes = 0; // reasonable initial value
+    bMirrored = FALSE;
     buffer = NULL;
-    bufferUnaligned = NULL;
     samplesInBuffer = 0;
     bufferPos = 0;
     channels = (uint)numChannels;
@@ -33,9 +148,23 @@ VCSDKCoreFIFOSampleBuffer::VCSDKCoreFIFOSampleBuffer(int numChannels)
 // destructor
 VCSDKCoreFIFOSampleBuffer::~VCSDKCoreFIFOSampleBuffer()
 {
-    delete[] bufferUnaligned;
-    bufferUnaligned = NULL;
+    release();
+}
+
+
+// Releases the buffer memory
+void VCSDKCoreFIFOSampleBuffer::release()
+{
+#ifdef VCSDKCORE_MIRRORED_FIFO
+    if (bMirrored)
+    {
+        _mirrorFree(buffer, sizeInBytes);
+        buffer = NULL;
+    }
+#endif
+    VCSDKCoreAllocator::free(buffer);
     buffer = NULL;
+    bMirrored = FALSE;
 }
 
 
@@ -45,6 +174,15 @@ void VCSDKCoreFIFOSampleBuffer::setChannels(int numChannels)
     uint usedBytes;
 
     assert(numChannels > 0);
+    if (bMirrored && (uint)numChannels != channels)
+    {
+        // the mirror size is a multiple of the old frame size only, and the
+        // data may wrap around, so move it to a buffer for the new frame size
+        reallocate(sizeInBytes / (numChannels * sizeof(SAMPLETYPE)), (uint)numChannels);
+        return;
+    }
+    // 'bufferPos' counts in frames, so the data must start at the buffer beginning
+    rewind();
     usedBytes = channels * samplesInBuffer;
     channels = (uint)numChannels;
     samplesInBuffer = usedBytes / channels;
@@ -53,10 +191,10 @@ void VCSDKCoreFIFOSampleBuffer::setChannels(int numChannels)
 
 // if output location pointer 'bufferPos' isn't zero, 'rewinds' the buffer and
 // zeroes this pointer by copying samples from the 'bufferPos' pointer
-// location on to the beginning of the buffer.
+// location on to the beginning of the buffer. A mirrored ring never needs this.
 void VCSDKCoreFIFOSampleBuffer::rewind()
 {
-    if (buffer && bufferPos)
+    if (buffer && bufferPos && !bMirrored)
     {
         memmove(buffer, ptrBegin(), sizeof(SAMPLETYPE) * channels * samplesInBuffer);
         bufferPos = 0;
@@ -73,6 +211,39 @@ void VCSDKCoreFIFOSampleBuffer::putSamples(const SAMPLETYPE *samples, uint nSamp
 }
 
 
+// Moves all samples from the 'other' buffer to this buffer. When this buffer is
+// empty, swaps the buffer memory & book-keeping instead of copying the samples.
+void VCSDKCoreFIFOSampleBuffer::moveSamples(VCSDKCoreFIFOSampleBuffer &other)
+{
+    SAMPLETYPE *tempBuffer;
+    uint tempSize, tempPos;
+    BOOL tempMirrored;
+
+    if (samplesInBuffer > 0 || channels != other.channels)
+    {
+        VCSDKCoreFIFOSamplePipe::moveSamples(other);
+        return;
+    }
+
+    tempBuffer = buffer;
+    tempSize = sizeInBytes;
+    tempMirrored = bMirrored;
+    tempPos = bufferPos;
+
+    buffer = other.buffer;
+    sizeInBytes = other.sizeInBytes;
+    bMirrored = other.bMirrored;
+    bufferPos = other.bufferPos;
+    samplesInBuffer = other.samplesInBuffer;
+
+    other.buffer = tempBuffer;
+    other.sizeInBytes = tempSize;
+    other.bMirrored = tempMirrored;
+    other.bufferPos = tempPos;
+    other.samplesInBuffer = 0;
+}
+
+
 // Increases the number of samples in the buffer without copying any actual
 // samples.
 //
@@ -103,8 +274,16 @@ void VCSDKCoreFIFOSampleBuffer::putSamples(uint nSamples)
 // 'putSamples(numSamples)' function.
 SAMPLETYPE *VCSDKCoreFIFOSampleBuffer::ptrEnd(uint slackCapacity)
 {
+    uint pos;
+
     ensureCapacity(samplesInBuffer + slackCapacity);
-    return buffer + samplesInBuffer * channels;
+    pos = bufferPos + samplesInBuffer;
+    if (bMirrored && pos >= getCapacity())
+    {
+        // wrapped around; the mirror keeps the free space contiguous
+        pos -= getCapacity();
+    }
+    return buffer + pos * channels;
 }
 
 
@@ -128,28 +307,9 @@ SAMPLETYPE *VCSDKCoreFIFOSampleBuffer::ptrBegin()
 // as well as to round the buffer size up to the virtual memory page size.
 void VCSDKCoreFIFOSampleBuffer::ensureCapacity(uint capacityRequirement)
 {
-    SAMPLETYPE *tempUnaligned, *temp;
-
     if (capacityRequirement > getCapacity())
     {
-        // enlarge the buffer in 4kbyte steps (round up to next 4k boundary)
-        sizeInBytes = (capacityRequirement * channels * sizeof(SAMPLETYPE) + 4095) & (uint)-4096;
-        assert(sizeInBytes % 2 == 0);
-        tempUnaligned = new SAMPLETYPE[sizeInBytes / sizeof(SAMPLETYPE) + 16 / sizeof(SAMPLETYPE)];
-        if (tempUnaligned == NULL)
-        {
-            ST_THROW_RT_ERROR("Couldn't allocate memory!\n");
-        }
-        // Align the buffer to begin at 16byte cache line boundary for optimal performance
-        temp = (SAMPLETYPE *)SOUNDTOUCH_ALIGN_POINTER_16(tempUnaligned);
-        if (samplesInBuffer)
-        {
-            memcpy(temp, ptrBegin(), samplesInBuffer * channels * sizeof(SAMPLETYPE));
-        }
-        delete[] bufferUnaligned;
-        buffer = temp;
-        bufferUnaligned = tempUnaligned;
-        bufferPos = 0;
+        reallocate(capacityRequirement, channels);
     }
     else
     {
@@ -159,6 +319,48 @@ void VCSDKCoreFIFOSampleBuffer::ensureCapacity(uint capacityRequirement)
 }
 
 
+// Allocates a new buffer with capacity for at least 'capacityRequirement' samples
+// of 'numChannels' channels, and moves the current data to its beginning. Prefers
+// a mirrored ring unless a custom allocator is set, and falls back to a linear
+// buffer that is grown in steps of 4 kilobytes.
+void VCSDKCoreFIFOSampleBuffer::reallocate(uint capacityRequirement, uint numChannels)
+{
+    SAMPLETYPE *temp = NULL;
+    BOOL tempMirrored = FALSE;
+    uint usedBytes = samplesInBuffer * channels * sizeof(SAMPLETYPE);
+    uint newSize = 0;
+
+#ifdef VCSDKCORE_MIRRORED_FIFO
+    if (!VCSDKCoreAllocator::isCustomAllocator())
+    {
+        newSize = _mirrorSize(capacityRequirement * numChannels * sizeof(SAMPLETYPE),
+                              numChannels * sizeof(SAMPLETYPE));
+        temp = (SAMPLETYPE *)_mirrorAlloc(newSize);
+        tempMirrored = (temp != NULL);
+    }
+#endif
+    if (temp == NULL)
+    {
+        // enlarge the buffer in 4kbyte steps (round up to next 4k boundary)
+        newSize = (capacityRequirement * numChannels * sizeof(SAMPLETYPE) + 4095) & (uint)-4096;
+        assert(newSize % 2 == 0);
+        temp = VCSDKCoreAllocator::allocArray<SAMPLETYPE>(newSize / sizeof(SAMPLETYPE));
+    }
+    if (usedBytes)
+    {
+        // contiguous also when wrapped around in a mirrored ring
+        memcpy(temp, ptrBegin(), usedBytes);
+    }
+    release();
+    buffer = temp;
+    bMirrored = tempMirrored;
+    sizeInBytes = newSize;
+    channels = numChannels;
+    samplesInBuffer = usedBytes / (numChannels * sizeof(SAMPLETYPE));
+    bufferPos = 0;
+}
+
+
 // Returns the current buffer capacity in terms of samples
 uint VCSDKCoreFIFOSampleBuffer::getCapacity() const
 {
@@ -205,6 +407,10 @@ uint VCSDKCoreFIFOSampleBuffer::receiveSamples(uint maxSamples)
 
     samplesInBuffer -= maxSamples;
     bufferPos += maxSamples;
+    if (bMirrored && bufferPos >= getCapacity())
+    {
+        bufferPos -= getCapacity();
+    }
 
     return maxSamples;
 }
@@ -237,10 +443,17 @@ uint VCSDKCoreFIFOSampleBuffer::adjustAmountOfSamples(uint numSamples)
 }
 
 
+// Grows the capacity to at least 'numSamples' samples. Never shrinks the buffer.
+void VCSDKCoreFIFOSampleBuffer::reserve(uint numSamples)
+{
+    if (numSamples > getCapacity())
+    {
+        reallocate(numSamples, channels);
+    }
+}
 
 
-
-
-
-
-
+BOOL VCSDKCoreFIFOSampleBuffer::isReserved(uint numSamples) const
+{
+    return (numSamples <= getCapacity()) ? TRUE : FALSE;
+}
@@ -21,16 +21,19 @@ namespace vcsdkcore {
 class VCSDKCoreFIFOSampleBuffer : public VCSDKCoreFIFOSamplePipe {
     
 private:
-    /// Sample buffer.
+    /// Sample buffer, aligned to VCSDKCORE_ALIGNMENT bytes. Allocated through
+    /// VCSDKCoreAllocator unless it's a mirrored ring.
     SAMPLETYPE *buffer;
 
-    // Raw unaligned buffer memory. 'buffer' is made aligned by pointing it to first
-    // 16-byte aligned location of this buffer
-    SAMPLETYPE *bufferUnaligned;
-
     /// Sample buffer size in bytes
     uint sizeInBytes;
 
+    /// Nonzero if 'buffer' is a mirrored ring, i.e. its 'sizeInBytes' bytes are mapped
+    /// again right after it. The data then wraps around at the end of the buffer
+    /// instead of being moved back to its beginning. See VCSDKCORE_MIRRORED_FIFO.
+    /// Not used when a custom VCSDKCoreAllocator is set.
+    BOOL bMirrored;
+
     /// How many samples are currently in buffer.
     uint samplesInBuffer;
 
@@ -49,6 +52,14 @@ private:
     /// Ensures that the buffer has capacity for at least this many samples.
     void ensureCapacity(uint capacityRequirement);
 
+    /// Allocates a new buffer for at least 'capacityRequirement' samples of
+    /// 'numChannels' channels, moves the current data to its beginning and
+    /// releases the old buffer.
+    void reallocate(uint capacityRequirement, uint numChannels);
+
+    /// Releases the buffer memory.
+    void release();
+
     /// Returns current capacity.
     uint getCapacity() const;
 
@@ -92,6 +103,13 @@ public:
                             uint numSamples                         ///< Number of samples to insert.
                             );
 
+    using VCSDKCoreFIFOSamplePipe::moveSamples;
+
+    /// Moves all samples from the 'other' buffer to this one. If this buffer is empty,
+    /// the buffers just swap their memory instead of copying the samples.
+    void moveSamples(VCSDKCoreFIFOSampleBuffer &other  ///< Other buffer where from the receive the data.
+                     );
+
     /// Adjusts the book-keeping to increase number of samples in the buffer without
     /// copying any actual samples.
     ///
@@ -139,6 +157,14 @@ public:
     /// allow trimming (downwards) amount of samples in pipeline.
     /// Returns adjusted amount of samples
     uint adjustAmountOfSamples(uint numSamples);
+
+    /// Grows the buffer capacity to at least 'numSamples' samples up front, so that
+    /// putting up to that many samples in the buffer won't allocate.
+    void reserve(uint numSamples);
+
+    /// Returns nonzero if the capacity is at least 'numSamples' samples, i.e.
+    /// 'reserve' wouldn't allocate.
+    BOOL isReserved(uint numSamples) const;
 };
 
 
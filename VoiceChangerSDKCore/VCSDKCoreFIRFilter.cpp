@@ -11,6 +11,7 @@
 #include <stdlib.h>
 #include "VCSDKCoreFIRFilter.hpp"
 #include "VCSDKCoreCpu_detect.h"
+#include "VCSDKCoreAllocator.hpp"
 
 
 
@@ -24,7 +25,6 @@ VCSDKCoreFIRFilter::VCSDKCoreFIRFilter() {
     filterCoeffs = NULL;
 }
 VCSDKCoreFIRFilter::~VCSDKCoreFIRFilter () {
-    delete [] filterCoeffs;
 }
 
 // Usual C-version of the filter routine for stereo sound
@@ -123,14 +123,75 @@ uint VCSDKCoreFIRFilter::evaluateFilterMono(SAMPLETYPE *dest, const SAMPLETYPE *
 }
 
 
+// Scales & saturates a sum of the filter routine for multiple channels as the mono
+// routine does
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+static inline SAMPLETYPE _filterResult(LONG_SAMPLETYPE sum, uint resultDivFactor)
+{
+    sum >>= resultDivFactor;
+    // saturate to 16 bit integer limits
+    sum = (sum < -32768) ? -32768 : (sum > 32767) ? 32767 : sum;
+    return (SAMPLETYPE)sum;
+}
+#else
+static inline SAMPLETYPE _filterResult(LONG_SAMPLETYPE sum, double dScaler)
+{
+    return (SAMPLETYPE)(sum * dScaler);
+}
+#endif // SOUNDTOUCH_INTEGER_SAMPLES
+
+
+// C-version of the filter routine for a channel count known at compile time, so that
+// the sums stay in registers & the channel loops can be unrolled and vectorized.
+// 'scale' is the 'resultDivFactor' or 'dScaler' of _filterResult.
+template <uint CHANNELS, class Scale>
+static uint _evaluateFilterChannels(SAMPLETYPE *dest, const SAMPLETYPE *src, uint numSamples,
+                                    const SAMPLETYPE *coeffs, uint length, Scale scale)
+{
+    uint i, j, c;
+    uint end = numSamples - length;
+
+    for (j = 0; j < end; j ++)
+    {
+        const SAMPLETYPE *ptr = src + j * CHANNELS;
+        LONG_SAMPLETYPE sum[CHANNELS];
+
+        for (c = 0; c < CHANNELS; c ++)
+        {
+            sum[c] = 0;
+        }
+        for (i = 0; i < length; i ++)
+        {
+            SAMPLETYPE coef = coeffs[i];
+            for (c = 0; c < CHANNELS; c ++)
+            {
+                sum[c] += ptr[c] * coef;
+            }
+            ptr += CHANNELS;
+        }
+        for (c = 0; c < CHANNELS; c ++)
+        {
+            dest[j * CHANNELS + c] = _filterResult(sum[c], scale);
+        }
+    }
+    return end;
+}
+
+
+// Channels are filtered in groups of up to FIR_MULTI_CHANNEL_GROUP, so that the
+// sums fit in a fixed size stack array
+#define FIR_MULTI_CHANNEL_GROUP     16
+
 uint VCSDKCoreFIRFilter::evaluateFilterMulti(SAMPLETYPE *dest, const SAMPLETYPE *src, uint numSamples, uint numChannels) const
 {
-    uint i, j, end, c;
-    LONG_SAMPLETYPE *sum=(LONG_SAMPLETYPE*)alloca(numChannels*sizeof(*sum));
-#ifdef SOUNDTOUCH_FLOAT_SAMPLES
+    uint i, j, end, c, first, group;
+    LONG_SAMPLETYPE sum[FIR_MULTI_CHANNEL_GROUP];
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+    uint scale = resultDivFactor;
+#else
     // when using floating point samples, use a scaler instead of a divider
     // because division is much slower operation than multiplying.
-    double dScaler = 1.0 / (double)resultDivider;
+    double scale = 1.0 / (double)resultDivider;
 #endif
 
     assert(length != 0);
@@ -138,63 +199,114 @@ uint VCSDKCoreFIRFilter::evaluateFilterMulti(SAMPLETYPE *dest, const SAMPLETYPE
     assert(dest != NULL);
     assert(filterCoeffs != NULL);
 
-    end = numChannels * (numSamples - length);
-
-    for (c = 0; c < numChannels; c ++)
+    // the common surround & ambisonic channel counts
+    switch (numChannels)
     {
-        sum[c] = 0;
+        case 4:
+            return _evaluateFilterChannels<4>(dest, src, numSamples, filterCoeffs, length, scale);
+        case 6:
+            return _evaluateFilterChannels<6>(dest, src, numSamples, filterCoeffs, length, scale);
+        default:
+            break;
     }
 
-    for (j = 0; j < end; j += numChannels)
-    {
-        const SAMPLETYPE *ptr;
+    end = numChannels * (numSamples - length);
 
-        ptr = src + j;
+    for (first = 0; first < numChannels; first += group)
+    {
+        group = numChannels - first;
+        if (group > FIR_MULTI_CHANNEL_GROUP) group = FIR_MULTI_CHANNEL_GROUP;
 
-        for (i = 0; i < length; i ++)
+        for (j = 0; j < end; j += numChannels)
         {
-            SAMPLETYPE coef=filterCoeffs[i];
-            for (c = 0; c < numChannels; c ++)
+            const SAMPLETYPE *ptr = src + j + first;
+
+            for (c = 0; c < group; c ++)
             {
-                sum[c] += ptr[0] * coef;
-                ptr ++;
+                sum[c] = 0;
+            }
+
+            for (i = 0; i < length; i ++)
+            {
+                SAMPLETYPE coef=filterCoeffs[i];
+                for (c = 0; c < group; c ++)
+                {
+                    sum[c] += ptr[c] * coef;
+                }
+                ptr += numChannels;
+            }
+
+            for (c = 0; c < group; c ++)
+            {
+                dest[j + first + c] = _filterResult(sum[c], scale);
             }
-        }
-        
-        for (c = 0; c < numChannels; c ++)
-        {
-#ifdef SOUNDTOUCH_INTEGER_SAMPLES
-            sum[c] >>= resultDivFactor;
-#else
-            sum[c] *= dScaler;
-#endif // SOUNDTOUCH_INTEGER_SAMPLES
-            *dest = (SAMPLETYPE)sum[c];
-            dest++;
-            sum[c] = 0;
         }
     }
     return numSamples - length;
 }
 
 
-// Set filter coeffiecients and length.
+// Copies & arranges the coefficients. Shared designs may outlive a custom allocator,
+// so they're allocated with the default one.
 //
 // Throws an exception if filter length isn't divisible by 8
-void VCSDKCoreFIRFilter::setCoefficients(const SAMPLETYPE *coeffs, uint newLength, uint uResultDivFactor)
+VCSDKCoreFIRCoeffs::VCSDKCoreFIRCoeffs(const SAMPLETYPE *newCoeffs, uint newLength, uint uResultDivFactor)
 {
     assert(newLength > 0);
     if (newLength % 8) ST_THROW_RT_ERROR("FIR filter length not divisible by 8");
 
-    lengthDiv8 = newLength / 8;
-    length = lengthDiv8 * 8;
-    assert(length == newLength);
-
+    length = newLength;
     resultDivFactor = uResultDivFactor;
     resultDivider = (SAMPLETYPE)::pow(2.0, (int)resultDivFactor);
 
-    delete[] filterCoeffs;
-    filterCoeffs = new SAMPLETYPE[length];
-    memcpy(filterCoeffs, coeffs, length * sizeof(SAMPLETYPE));
+    coeffs = (SAMPLETYPE *)VCSDKCoreAllocator::allocShared(length * sizeof(SAMPLETYPE));
+    memcpy(coeffs, newCoeffs, length * sizeof(SAMPLETYPE));
+
+#ifdef SOUNDTOUCH_ALLOW_MMX
+    coeffsMMX = (short *)VCSDKCoreAllocator::allocShared(2 * length * sizeof(short));
+    VCSDKCoreFIRFilterMMX::arrangeCoefficients(coeffsMMX, coeffs, length);
+#endif
+#ifdef SOUNDTOUCH_ALLOW_SSE
+    coeffsSSE = (float *)VCSDKCoreAllocator::allocShared(3 * length * sizeof(float));
+    VCSDKCoreFIRFilterSSE::arrangeCoefficients(coeffsSSE, coeffs, length, (float)resultDivider);
+#endif
+}
+
+
+VCSDKCoreFIRCoeffs::~VCSDKCoreFIRCoeffs()
+{
+    VCSDKCoreAllocator::free(coeffs);
+#ifdef SOUNDTOUCH_ALLOW_MMX
+    VCSDKCoreAllocator::free(coeffsMMX);
+#endif
+#ifdef SOUNDTOUCH_ALLOW_SSE
+    VCSDKCoreAllocator::free(coeffsSSE);
+#endif
+}
+
+
+// Set filter coeffiecients and length from a copy of the given coefficients
+//
+// Throws an exception if filter length isn't divisible by 8
+void VCSDKCoreFIRFilter::setCoefficients(const SAMPLETYPE *coeffs, uint newLength, uint uResultDivFactor)
+{
+    shareCoefficients(VCSDKCoreFIRCoeffsPtr(new VCSDKCoreFIRCoeffs(coeffs, newLength, uResultDivFactor)));
+}
+
+
+// Set filter coefficients and length from shared coefficients. Doesn't allocate.
+void VCSDKCoreFIRFilter::shareCoefficients(const VCSDKCoreFIRCoeffsPtr &coeffs)
+{
+    assert(coeffs);
+
+    pCoeffs = coeffs;
+    lengthDiv8 = coeffs->length / 8;
+    length = lengthDiv8 * 8;
+    assert(length == coeffs->length);
+
+    resultDivFactor = coeffs->resultDivFactor;
+    resultDivider = coeffs->resultDivider;
+    filterCoeffs = coeffs->coeffs;
 }
 
 
@@ -251,11 +363,23 @@ VCSDKCoreFIRFilter * VCSDKCoreFIRFilter::newInstance()
 
     uExtensions = detectCPUextensions();
 
-    // Check if MMX/SSE instruction set extensions supported by CPU
+    // Check if AVX2/SSE2/MMX/SSE instruction set extensions supported by CPU
+
+#ifdef SOUNDTOUCH_ALLOW_AVX2
+    if ((uExtensions & SUPPORT_AVX2_ROUTINES) == SUPPORT_AVX2_ROUTINES)
+    {
+        return ::new VCSDKCoreFIRFilterAVX2;
+    }
+    else
+#endif // SOUNDTOUCH_ALLOW_AVX2
 
 #ifdef SOUNDTOUCH_ALLOW_MMX
-    // MMX routines available only with integer sample types
-    if (uExtensions & SUPPORT_MMX)
+    // SSE2 & MMX routines available only with integer sample types
+    if ((uExtensions & (SUPPORT_MMX | SUPPORT_SSE2)) == (SUPPORT_MMX | SUPPORT_SSE2))
+    {
+        return ::new VCSDKCoreFIRFilterSSE2;
+    }
+    else if (uExtensions & SUPPORT_MMX)
     {
         return ::new VCSDKCoreFIRFilterMMX;
     }
@@ -266,7 +390,7 @@ VCSDKCoreFIRFilter * VCSDKCoreFIRFilter::newInstance()
     if (uExtensions & SUPPORT_SSE)
     {
         // SSE support
-        return ::new FIRFilterSSE;
+        return ::new VCSDKCoreFIRFilterSSE;
     }
     else
 #endif // SOUNDTOUCH_ALLOW_SSE
@@ -10,12 +10,44 @@
 #define VCSDKCoreFIRFilter_hpp
 
 #include <stddef.h>
+#include <memory>
 #include "VCSDKCoreType.h"
+#include "VCSDKCoreFilterCache.hpp"
 
 
 namespace vcsdkcore {
 
 
+/// FIR filter coefficients, together with their arrangements for the CPU
+/// specific filter routines of the build. Immutable once created, so that
+/// filter instances can share them, see VCSDKCoreFilterCache.
+class VCSDKCoreFIRCoeffs : public VCSDKCoreFilterDesign {
+public:
+    uint length;
+    uint resultDivFactor;
+    SAMPLETYPE resultDivider;
+
+    /// Coefficients as given, 'length' items
+    SAMPLETYPE *coeffs;
+
+#ifdef SOUNDTOUCH_ALLOW_MMX
+    /// Arranged for VCSDKCoreFIRFilterMMX, 2 * 'length' items
+    short *coeffsMMX;
+#endif
+#ifdef SOUNDTOUCH_ALLOW_SSE
+    /// Arranged for VCSDKCoreFIRFilterSSE, 3 * 'length' items
+    float *coeffsSSE;
+#endif
+
+    /// Copies & arranges 'newLength' coefficients. Throws an exception if the
+    /// length isn't divisible by 8.
+    VCSDKCoreFIRCoeffs(const SAMPLETYPE *coeffs, uint newLength, uint uResultDivFactor);
+    virtual ~VCSDKCoreFIRCoeffs();
+};
+
+typedef std::shared_ptr<const VCSDKCoreFIRCoeffs> VCSDKCoreFIRCoeffsPtr;
+
+
 class VCSDKCoreFIRFilter {
     
     
@@ -31,7 +63,10 @@ protected:
     
     SAMPLETYPE resultDivider;
     
-    SAMPLETYPE *filterCoeffs;
+    const SAMPLETYPE *filterCoeffs;
+
+    /// The coefficients in use, possibly shared with other instances
+    VCSDKCoreFIRCoeffsPtr pCoeffs;
     
     virtual uint evaluateFilterStereo(SAMPLETYPE *dest,const SAMPLETYPE *src,uint numSamples) const;
     virtual uint evaluateFilterMono(SAMPLETYPE *dest,const SAMPLETYPE *src,uint numSamples) const;
@@ -54,9 +89,14 @@ public:
     
     uint getLength() const;
     
-    virtual void setCoefficients(const SAMPLETYPE *coeffs,
-                                 uint newLength,
-                                 uint uResultDivFactor);
+    /// Sets the filter coefficients, a copy of 'newLength' items of 'coeffs'.
+    /// The result is divided by 2^uResultDivFactor.
+    void setCoefficients(const SAMPLETYPE *coeffs,
+                         uint newLength,
+                         uint uResultDivFactor);
+
+    /// Sets the filter coefficients to the shared 'coeffs' without copying them
+    virtual void shareCoefficients(const VCSDKCoreFIRCoeffsPtr &coeffs);
     
 };
 
@@ -66,15 +106,29 @@ public:
 
 class VCSDKCoreFIRFilterMMX: public VCSDKCoreFIRFilter {
 protected:
-    short *filterCoeffsUnalign;
-    short *filterCoeffsAlign;
+    const short *filterCoeffsAlign;
     
     virtual uint evaluateFilterStereo(short *dest, const short *src, uint numSamples) const;
 public:
     VCSDKCoreFIRFilterMMX();
     ~VCSDKCoreFIRFilterMMX();
     
-    virtual void setCoefficients(const short *coeffs, uint newLength, uint uResultDivFactor);
+    virtual void shareCoefficients(const VCSDKCoreFIRCoeffsPtr &coeffs);
+
+    /// Arranges 'length' coefficients for the MMX routine to 'dest', 2 * 'length' items
+    static void arrangeCoefficients(short *dest, const short *coeffs, uint length);
+};
+
+
+/// Class that implements SSE2 optimized routines for 16bit integer samples type.
+/// Several output samples are calculated per pass over the coefficients, so that
+/// each coefficient vector is loaded once for all of them. More than 2 channels
+/// are filtered 4 channels at a time. Gives the same results as the plain C++ routines.
+class VCSDKCoreFIRFilterSSE2 : public VCSDKCoreFIRFilterMMX {
+protected:
+    virtual uint evaluateFilterStereo(short *dest, const short *src, uint numSamples) const;
+    virtual uint evaluateFilterMono(short *dest, const short *src, uint numSamples) const;
+    virtual uint evaluateFilterMulti(short *dest, const short *src, uint numSamples, uint numChannels) const;
 };
 #endif  // SOUNDTOUCH_ALLOW_MMX
 
@@ -85,20 +139,46 @@ public:
 /// Class that implements SSE optimized functions exclusive for floating point samples type.
 class VCSDKCoreFIRFilterSSE : public VCSDKCoreFIRFilter {
 protected:
-    float *filterCoeffsUnalign;
-    float *filterCoeffsAlign;
+    const float *filterCoeffsAlign;
+    const float *filterCoeffsMonoAlign;
 
     virtual uint evaluateFilterStereo(float *dest, const float *src, uint numSamples) const;
+    virtual uint evaluateFilterMono(float *dest, const float *src, uint numSamples) const;
+    /// Filters more than 2 channels 4 channels at a time
+    virtual uint evaluateFilterMulti(float *dest, const float *src, uint numSamples, uint numChannels) const;
 public:
-    FIRFilterSSE();
-    ~FIRFilterSSE();
+    VCSDKCoreFIRFilterSSE();
+    ~VCSDKCoreFIRFilterSSE();
+
+    virtual void shareCoefficients(const VCSDKCoreFIRCoeffsPtr &coeffs);
 
-    virtual void setCoefficients(const float *coeffs, uint newLength, uint uResultDivFactor);
+    /// Arranges 'length' coefficients for the SSE routines to 'dest', 3 * 'length'
+    /// items: scaled by 1 / 'divider' & duplicated for stereo, then scaled for mono
+    static void arrangeCoefficients(float *dest, const float *coeffs, uint length, float divider);
 };
 
 #endif   // SOUNDTOUCH_ALLOW_SSE
 
 
+#ifdef SOUNDTOUCH_ALLOW_AVX2
+
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+/// Class that implements AVX2 optimized routines for 16bit integer samples type,
+/// as VCSDKCoreFIRFilterSSE2 but with twice as wide vectors.
+class VCSDKCoreFIRFilterAVX2 : public VCSDKCoreFIRFilterSSE2 {
+#else
+/// Class that implements AVX2 & FMA optimized routines for floating point samples
+/// type, as VCSDKCoreFIRFilterSSE but with twice as wide vectors.
+class VCSDKCoreFIRFilterAVX2 : public VCSDKCoreFIRFilterSSE {
+#endif
+protected:
+    virtual uint evaluateFilterStereo(SAMPLETYPE *dest, const SAMPLETYPE *src, uint numSamples) const;
+    virtual uint evaluateFilterMono(SAMPLETYPE *dest, const SAMPLETYPE *src, uint numSamples) const;
+};
+
+#endif  // SOUNDTOUCH_ALLOW_AVX2
+
+
 }
 
 
@@ -0,0 +1,135 @@
+////  VCSDKCoreFilterCache.cpp
+//  VoiceChanger
+//
+//  Process-wide cache of designed filter coefficients.
+//
+
+#include <list>
+#include <mutex>
+#include "VCSDKCoreFilterCache.hpp"
+
+using namespace vcsdkcore;
+
+
+/// One cached design & its key
+struct FilterCacheEntry
+{
+    VCSDKCoreFilterCache::KIND kind;
+    double cutoffFreq;
+    uint length;
+    uint sampleBytes;
+    VCSDKCoreFilterDesignPtr design;
+};
+
+
+/// The designs, most recently used first
+struct FilterCacheState
+{
+    std::mutex lock;
+    std::list<FilterCacheEntry> entries;
+    uint capacity;
+
+    FilterCacheState()
+    {
+        capacity = FILTER_CACHE_CAPACITY;
+    }
+};
+
+
+// Created on first use, so that instances constructed during the static
+// initialization can use the cache as well
+static FilterCacheState &_state()
+{
+    static FilterCacheState state;
+    return state;
+}
+
+
+// Moves the design matching the key to the front & returns it, or NULL if not
+// found. Call with the lock held.
+static VCSDKCoreFilterDesignPtr _find(FilterCacheState &state, VCSDKCoreFilterCache::KIND kind,
+                                      double cutoffFreq, uint length)
+{
+    std::list<FilterCacheEntry>::iterator it;
+
+    for (it = state.entries.begin(); it != state.entries.end(); ++ it)
+    {
+        if (it->kind == kind && it->cutoffFreq == cutoffFreq && it->length == length &&
+            it->sampleBytes == sizeof(SAMPLETYPE))
+        {
+            state.entries.splice(state.entries.begin(), state.entries, it);
+            return it->design;
+        }
+    }
+    return VCSDKCoreFilterDesignPtr();
+}
+
+
+// Drops the least recently used designs beyond the capacity. Call with the lock held.
+static void _trim(FilterCacheState &state)
+{
+    while (state.entries.size() > state.capacity)
+    {
+        state.entries.pop_back();
+    }
+}
+
+
+VCSDKCoreFilterDesignPtr VCSDKCoreFilterCache::get(KIND kind, double cutoffFreq, uint length, DesignFunc design)
+{
+    FilterCacheState &state = _state();
+    VCSDKCoreFilterDesignPtr result;
+
+    {
+        std::lock_guard<std::mutex> lock(state.lock);
+        result = _find(state, kind, cutoffFreq, length);
+        if (result) return result;
+    }
+
+    // design without holding the lock, the other threads may go on meanwhile
+    VCSDKCoreFilterDesignPtr created(design(cutoffFreq, length));
+
+    std::lock_guard<std::mutex> lock(state.lock);
+
+    // another thread may have added the same design in the meantime
+    result = _find(state, kind, cutoffFreq, length);
+    if (result) return result;
+
+    FilterCacheEntry entry;
+    entry.kind = kind;
+    entry.cutoffFreq = cutoffFreq;
+    entry.length = length;
+    entry.sampleBytes = sizeof(SAMPLETYPE);
+    entry.design = created;
+    state.entries.push_front(entry);
+    _trim(state);
+    return created;
+}
+
+
+void VCSDKCoreFilterCache::setCapacity(uint capacity)
+{
+    FilterCacheState &state = _state();
+    std::lock_guard<std::mutex> lock(state.lock);
+
+    state.capacity = capacity;
+    _trim(state);
+}
+
+
+uint VCSDKCoreFilterCache::getSize()
+{
+    FilterCacheState &state = _state();
+    std::lock_guard<std::mutex> lock(state.lock);
+
+    return (uint)state.entries.size();
+}
+
+
+void VCSDKCoreFilterCache::clear()
+{
+    FilterCacheState &state = _state();
+    std::lock_guard<std::mutex> lock(state.lock);
+
+    state.entries.clear();
+}
@@ -0,0 +1,67 @@
+////  VCSDKCoreFilterCache.hpp
+//  VoiceChanger
+//
+//  Process-wide cache of designed filter coefficients. Instances that need the
+//  same filter share one immutable design by reference, so that e.g. switching
+//  between presets neither recalculates nor allocates the coefficients again.
+//
+
+#ifndef VCSDKCoreFilterCache_hpp
+#define VCSDKCoreFilterCache_hpp
+
+#include <memory>
+#include "VCSDKCoreType.h"
+
+
+namespace vcsdkcore {
+
+
+/// Default maximum number of designs kept in the cache
+#define FILTER_CACHE_CAPACITY   64
+
+
+/// Base class of the designs kept in VCSDKCoreFilterCache. A design must not be
+/// modified once it's in the cache, so that any number of instances & threads
+/// may use it at the same time.
+class VCSDKCoreFilterDesign
+{
+public:
+    virtual ~VCSDKCoreFilterDesign() {}
+};
+
+typedef std::shared_ptr<const VCSDKCoreFilterDesign> VCSDKCoreFilterDesignPtr;
+
+
+class VCSDKCoreFilterCache
+{
+public:
+    /// Kinds of designs, part of the cache key
+    enum KIND {
+        AA_FILTER = 0,      ///< VCSDKCoreAAFilter coefficients
+        AA_RESAMPLER        ///< VCSDKCoreAAResampler kernel table
+    };
+
+    /// Function that designs a filter of 'length' taps with the cut-off frequency
+    /// 'cutoffFreq' (nyquist = 0.5). Returns a design allocated with 'new'.
+    typedef VCSDKCoreFilterDesign *(*DesignFunc)(double cutoffFreq, uint length);
+
+    /// Returns the design of 'kind' for 'cutoffFreq' & 'length' taps of the sample
+    /// type of the build. Calls 'design' to create it if it isn't in the cache yet.
+    /// Thread-safe; doesn't allocate if the design is found.
+    static VCSDKCoreFilterDesignPtr get(KIND kind, double cutoffFreq, uint length, DesignFunc design);
+
+    /// Sets the maximum number of designs kept (default FILTER_CACHE_CAPACITY).
+    /// The least recently used ones are dropped first; a dropped design stays
+    /// alive until the instances using it release it.
+    static void setCapacity(uint capacity);
+
+    /// Returns the number of designs in the cache
+    static uint getSize();
+
+    /// Drops all the designs from the cache
+    static void clear();
+};
+
+}
+
+#endif /* VCSDKCoreFilterCache_hpp */
@@ -32,6 +32,7 @@ VCSDKCoreInterpolateCubic::VCSDKCoreInterpolateCubic()
 
 void VCSDKCoreInterpolateCubic::resetRegisters()
 {
+    VCSDKCoreTransposerBase::resetRegisters();
     fract = 0;
 }
 
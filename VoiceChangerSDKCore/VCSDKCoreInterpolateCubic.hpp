@@ -33,6 +33,11 @@ protected:
 
 public:
     VCSDKCoreInterpolateCubic();
+
+    int getLatency() const
+    {
+        return 4;
+    }
     
 };
 
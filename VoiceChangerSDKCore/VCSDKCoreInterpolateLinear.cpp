@@ -33,6 +33,7 @@ InterpolateLinearInteger::InterpolateLinearInteger() : VCSDKCoreTransposerBase()
 
 void InterpolateLinearInteger::resetRegisters()
 {
+    VCSDKCoreTransposerBase::resetRegisters();
     iFract = 0;
 }
 
@@ -169,6 +170,7 @@ InterpolateLinearFloat::InterpolateLinearFloat() : VCSDKCoreTransposerBase()
 
 void InterpolateLinearFloat::resetRegisters()
 {
+    VCSDKCoreTransposerBase::resetRegisters();
     fract = 0;
 }
 
@@ -248,9 +250,11 @@ int InterpolateLinearFloat::transposeMulti(SAMPLETYPE *dest, const SAMPLETYPE *s
     i = 0;
     while (srcCount < srcSampleEnd)
     {
-        float temp, vol1;
-    
-        vol1 = (1.0f- fract);
+        double temp, vol1;
+        assert(fract < 1.0);
+
+        // same precision as the mono & stereo routines
+        vol1 = (1.0 - fract);
         for (int c = 0; c < numChannels; c ++)
         {
             temp = vol1 * src[c] + fract * src[c + numChannels];
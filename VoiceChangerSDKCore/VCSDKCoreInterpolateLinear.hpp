@@ -33,6 +33,11 @@ protected:
 public:
     InterpolateLinearInteger();
 
+    int getLatency() const
+    {
+        return 1;
+    }
+
     /// Sets new target rate. Normal rate = 1.0, smaller values represent slower
     /// rate, larger faster rates.
     virtual void setRate(float newRate);
@@ -57,6 +62,11 @@ protected:
 
 public:
     InterpolateLinearFloat();
+
+    int getLatency() const
+    {
+        return 1;
+    }
 };
 
 }
@@ -0,0 +1,285 @@
+////  VCSDKCoreInterpolatePolyphase.cpp
+//  VoiceChanger
+//
+//  Table-driven polyphase windowed-sinc interpolation.
+//
+
+#include <math.h>
+#include <mutex>
+#include "VCSDKCoreInterpolatePolyphase.hpp"
+#include "VCSDKCoreCpu_detect.h"
+#include "VCSDKCoreType.h"
+#include "VCSDKCoreAllocator.hpp"
+
+using namespace vcsdkcore;
+
+
+/// Kaiser window shape parameter: about 60 dB stopband for the 8-tap kernel
+#define POLYPHASE_KAISER_BETA       5.0
+
+#define POLYPHASE_MIN_PHASES        16
+#define POLYPHASE_MAX_PHASES        4096
+
+#define PI 3.1415926536
+
+
+int VCSDKCoreInterpolatePolyphase::defaultPhases = POLYPHASE_DEFAULT_PHASES;
+
+
+/// Kernel table of one phase count, kept in a list for the process lifetime
+struct PolyphaseKernel
+{
+    int phases;
+    float *table;
+    PolyphaseKernel *next;
+};
+
+static PolyphaseKernel *_kernels = NULL;
+static std::mutex _kernelLock;
+
+
+// Modified Bessel function of the first kind, order 0
+static double _besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+
+    for (int k = 1; k < 32; k ++)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+
+
+// Kaiser windowed sinc at 'x' source samples from the interpolation point. The
+// window spans the taps, +- POLYPHASE_TAPS / 2.
+static double _windowedSinc(double x)
+{
+    const double halfWidth = POLYPHASE_TAPS / 2;
+    double r = x / halfWidth;
+    double sinc = (fabs(x) < 1e-9) ? 1.0 : sin(PI * x) / (PI * x);
+
+    if (r <= -1.0 || r >= 1.0) return 0;
+    return sinc * _besselI0(POLYPHASE_KAISER_BETA * sqrt(1.0 - r * r)) / _besselI0(POLYPHASE_KAISER_BETA);
+}
+
+
+// Computes the kernel table for 'phases' phases. Tap k of phase p weights the
+// source sample at k - 3 from the output position p / phases past source sample 3,
+// as in InterpolateShannon. Each phase is normalized to unity gain at DC.
+static float *_designKernel(int phases)
+{
+    // one spare row so that the last differences can be taken
+    float *table = (float *)VCSDKCoreAllocator::allocShared((size_t)(phases + 1) * 2 * POLYPHASE_TAPS * sizeof(float));
+    int p, k;
+
+    for (p = 0; p <= phases; p ++)
+    {
+        double coeffs[POLYPHASE_TAPS];
+        double sum = 0;
+        const double f = (double)p / (double)phases;
+
+        for (k = 0; k < POLYPHASE_TAPS; k ++)
+        {
+            coeffs[k] = _windowedSinc((double)(k - 3) - f);
+            sum += coeffs[k];
+        }
+        for (k = 0; k < POLYPHASE_TAPS; k ++)
+        {
+            table[p * 2 * POLYPHASE_TAPS + k] = (float)(coeffs[k] / sum);
+        }
+    }
+
+    // differences to the next row
+    for (p = 0; p < phases; p ++)
+    {
+        float *row = table + p * 2 * POLYPHASE_TAPS;
+        for (k = 0; k < POLYPHASE_TAPS; k ++)
+        {
+            row[POLYPHASE_TAPS + k] = row[2 * POLYPHASE_TAPS + k] - row[k];
+        }
+    }
+    return table;
+}
+
+
+const float *VCSDKCoreInterpolatePolyphase::getKernel(int phases)
+{
+    std::lock_guard<std::mutex> lock(_kernelLock);
+    PolyphaseKernel *kernel;
+
+    for (kernel = _kernels; kernel; kernel = kernel->next)
+    {
+        if (kernel->phases == phases) return kernel->table;
+    }
+
+    kernel = new PolyphaseKernel;
+    kernel->phases = phases;
+    kernel->table = _designKernel(phases);
+    kernel->next = _kernels;
+    _kernels = kernel;
+    return kernel->table;
+}
+
+
+void VCSDKCoreInterpolatePolyphase::setDefaultPhases(int phases)
+{
+    if (phases < POLYPHASE_MIN_PHASES) phases = POLYPHASE_MIN_PHASES;
+    if (phases > POLYPHASE_MAX_PHASES) phases = POLYPHASE_MAX_PHASES;
+    defaultPhases = phases;
+}
+
+
+VCSDKCoreInterpolatePolyphase::VCSDKCoreInterpolatePolyphase()
+{
+    numPhases = defaultPhases;
+    pKernel = getKernel(numPhases);
+    fract = 0;
+}
+
+
+VCSDKCoreInterpolatePolyphase *VCSDKCoreInterpolatePolyphase::newInstance()
+{
+#ifdef SOUNDTOUCH_ALLOW_MMX
+    // SSE2 routines available only with integer sample types
+    if (detectCPUextensions() & SUPPORT_SSE2)
+    {
+        return new InterpolatePolyphaseSSE2;
+    }
+#endif // SOUNDTOUCH_ALLOW_MMX
+#ifdef SOUNDTOUCH_ALLOW_SSE
+    if (detectCPUextensions() & SUPPORT_SSE)
+    {
+        return new InterpolatePolyphaseSSE;
+    }
+#endif // SOUNDTOUCH_ALLOW_SSE
+    return new VCSDKCoreInterpolatePolyphase;
+}
+
+
+void VCSDKCoreInterpolatePolyphase::resetRegisters()
+{
+    VCSDKCoreTransposerBase::resetRegisters();
+    fract = 0;
+}
+
+
+// Converts an interpolated value to the sample type
+static inline SAMPLETYPE _toSample(float value)
+{
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+    // the kernel overshoots a bit at sharp transients, saturate
+    value += (value >= 0) ? 0.5f : -0.5f;
+    return (SAMPLETYPE)((value < -32768.0f) ? -32768.0f : (value > 32767.0f) ? 32767.0f : value);
+#else
+    return value;
+#endif
+}
+
+
+/// Transpose mono audio. Returns number of produced output samples, and
+/// updates "srcSamples" to amount of consumed source samples
+int VCSDKCoreInterpolatePolyphase::transposeMono(SAMPLETYPE *pdest,
+                    const SAMPLETYPE *psrc,
+                    int &srcSamples)
+{
+    int i = 0;
+    int srcSampleEnd = srcSamples - POLYPHASE_TAPS;
+    int srcCount = 0;
+
+    while (srcCount < srcSampleEnd)
+    {
+        float coeffs[POLYPHASE_TAPS];
+        float out = 0;
+
+        assert(fract < 1.0);
+        calcCoeffs(coeffs);
+        for (int k = 0; k < POLYPHASE_TAPS; k ++)
+        {
+            out += coeffs[k] * (float)psrc[k];
+        }
+        pdest[i] = _toSample(out);
+        i ++;
+
+        int whole = advance();
+        psrc += whole;
+        srcCount += whole;
+    }
+    srcSamples = srcCount;
+    return i;
+}
+
+
+/// Transpose stereo audio. Returns number of produced output samples, and
+/// updates "srcSamples" to amount of consumed source samples
+int VCSDKCoreInterpolatePolyphase::transposeStereo(SAMPLETYPE *pdest,
+                    const SAMPLETYPE *psrc,
+                    int &srcSamples)
+{
+    int i = 0;
+    int srcSampleEnd = srcSamples - POLYPHASE_TAPS;
+    int srcCount = 0;
+
+    while (srcCount < srcSampleEnd)
+    {
+        float coeffs[POLYPHASE_TAPS];
+        float out0 = 0, out1 = 0;
+
+        assert(fract < 1.0);
+        calcCoeffs(coeffs);
+        for (int k = 0; k < POLYPHASE_TAPS; k ++)
+        {
+            out0 += coeffs[k] * (float)psrc[2 * k];
+            out1 += coeffs[k] * (float)psrc[2 * k + 1];
+        }
+        pdest[2 * i] = _toSample(out0);
+        pdest[2 * i + 1] = _toSample(out1);
+        i ++;
+
+        int whole = advance();
+        psrc += 2 * whole;
+        srcCount += whole;
+    }
+    srcSamples = srcCount;
+    return i;
+}
+
+
+/// Transpose multi-channel audio. Returns number of produced output samples, and
+/// updates "srcSamples" to amount of consumed source samples
+int VCSDKCoreInterpolatePolyphase::transposeMulti(SAMPLETYPE *pdest,
+                    const SAMPLETYPE *psrc,
+                    int &srcSamples)
+{
+    int i = 0;
+    int srcSampleEnd = srcSamples - POLYPHASE_TAPS;
+    int srcCount = 0;
+
+    while (srcCount < srcSampleEnd)
+    {
+        float coeffs[POLYPHASE_TAPS];
+
+        assert(fract < 1.0);
+        calcCoeffs(coeffs);
+        for (int c = 0; c < numChannels; c ++)
+        {
+            float out = 0;
+            for (int k = 0; k < POLYPHASE_TAPS; k ++)
+            {
+                out += coeffs[k] * (float)psrc[k * numChannels + c];
+            }
+            *pdest = _toSample(out);
+            pdest ++;
+        }
+        i ++;
+
+        int whole = advance();
+        psrc += numChannels * whole;
+        srcCount += whole;
+    }
+    srcSamples = srcCount;
+    return i;
+}
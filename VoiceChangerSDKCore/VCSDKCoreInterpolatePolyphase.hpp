@@ -0,0 +1,138 @@
+////  VCSDKCoreInterpolatePolyphase.hpp
+//  VoiceChanger
+//
+//  Table-driven polyphase windowed-sinc interpolation: the same 8-tap
+//  band-limited interpolation as InterpolateShannon, but the Kaiser windowed
+//  sinc kernels are precomputed for a number of fractional phases instead of
+//  evaluating sin() for every tap of every output sample.
+//
+
+#ifndef VCSDKCoreInterpolatePolyphase_hpp
+#define VCSDKCoreInterpolatePolyphase_hpp
+
+
+#include "VCSDKCoreRateTransposer.hpp"
+#include "VCSDKCoreType.h"
+
+namespace vcsdkcore
+{
+
+/// Number of kernel taps, i.e. source samples per output sample
+#define POLYPHASE_TAPS              8
+
+/// Default number of fractional phases in the kernel table
+#define POLYPHASE_DEFAULT_PHASES    256
+
+
+class VCSDKCoreInterpolatePolyphase : public VCSDKCoreTransposerBase
+{
+protected:
+    /// Kernel table shared by all instances with the same number of phases.
+    /// Row 'p' holds the POLYPHASE_TAPS coefficients for fraction p / numPhases,
+    /// followed by their differences to the next row; the coefficients between
+    /// two rows are interpolated linearly.
+    const float *pKernel;
+    int numPhases;
+
+    float fract;
+
+    /// Number of phases for the instances created next
+    static int defaultPhases;
+
+    /// Returns the interpolated coefficients for the current 'fract' in 'coeffs'
+    inline void calcCoeffs(float *coeffs) const
+    {
+        const float pos = fract * (float)numPhases;
+        const int phase = (int)pos;
+        const float t = pos - (float)phase;
+        const float *row = pKernel + phase * 2 * POLYPHASE_TAPS;
+
+        for (int k = 0; k < POLYPHASE_TAPS; k ++)
+        {
+            coeffs[k] = row[k] + t * row[POLYPHASE_TAPS + k];
+        }
+    }
+
+    /// Advances the position by 'rate', returns the number of whole source samples
+    inline int advance()
+    {
+        fract += rate;
+        int whole = (int)fract;
+        fract -= whole;
+        return whole;
+    }
+
+    void resetRegisters();
+    virtual int transposeMono(SAMPLETYPE *dest,
+                        const SAMPLETYPE *src,
+                        int &srcSamples);
+    virtual int transposeStereo(SAMPLETYPE *dest,
+                        const SAMPLETYPE *src,
+                        int &srcSamples);
+    virtual int transposeMulti(SAMPLETYPE *dest,
+                        const SAMPLETYPE *src,
+                        int &srcSamples);
+
+public:
+    VCSDKCoreInterpolatePolyphase();
+
+    /// Use this function instead of "new" operator to create a new instance of this class.
+    /// Chooses an implementation optimized for the CPU if one is available.
+    static VCSDKCoreInterpolatePolyphase *newInstance();
+
+    /// Sets the number of fractional phases (16 .. 4096) of the kernel table for
+    /// the instances created after this call. More phases reduce the timing
+    /// quantization at the cost of a larger table.
+    static void setDefaultPhases(int phases);
+
+    /// Returns the kernel table for 'phases' fractional phases. The tables are
+    /// computed once & shared by all instances for the process lifetime.
+    static const float *getKernel(int phases);
+
+    int getLatency() const
+    {
+        return POLYPHASE_TAPS;
+    }
+};
+
+
+#ifdef SOUNDTOUCH_ALLOW_MMX
+/// Class that implements SSE2 optimized dot products for the 16bit integer sample
+/// type: the interpolated coefficients are rounded to 16 bits for the multiply-adds,
+/// so the results may differ by 1 LSB from the plain C++ routines.
+class InterpolatePolyphaseSSE2 : public VCSDKCoreInterpolatePolyphase
+{
+protected:
+    virtual int transposeMono(SAMPLETYPE *dest,
+                        const SAMPLETYPE *src,
+                        int &srcSamples);
+    virtual int transposeStereo(SAMPLETYPE *dest,
+                        const SAMPLETYPE *src,
+                        int &srcSamples);
+    virtual int transposeMulti(SAMPLETYPE *dest,
+                        const SAMPLETYPE *src,
+                        int &srcSamples);
+};
+#endif // SOUNDTOUCH_ALLOW_MMX
+
+
+#ifdef SOUNDTOUCH_ALLOW_SSE
+/// Class that implements SSE optimized dot products for the float sample type.
+class InterpolatePolyphaseSSE : public VCSDKCoreInterpolatePolyphase
+{
+protected:
+    virtual int transposeMono(SAMPLETYPE *dest,
+                        const SAMPLETYPE *src,
+                        int &srcSamples);
+    virtual int transposeStereo(SAMPLETYPE *dest,
+                        const SAMPLETYPE *src,
+                        int &srcSamples);
+    virtual int transposeMulti(SAMPLETYPE *dest,
+                        const SAMPLETYPE *src,
+                        int &srcSamples);
+};
+#endif // SOUNDTOUCH_ALLOW_SSE
+
+}
+
+#endif /* VCSDKCoreInterpolatePolyphase_hpp */
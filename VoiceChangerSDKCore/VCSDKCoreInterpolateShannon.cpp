@@ -35,6 +35,7 @@ InterpolateShannon::InterpolateShannon()
 
 void InterpolateShannon::resetRegisters()
 {
+    VCSDKCoreTransposerBase::resetRegisters();
     fract = 0;
 }
 
@@ -140,14 +141,55 @@ int InterpolateShannon::transposeStereo(SAMPLETYPE *pdest,
 }
 
 
-/// Transpose stereo audio. Returns number of produced output samples, and
+/// Transpose multi-channel audio. Returns number of produced output samples, and
 /// updates "srcSamples" to amount of consumed source samples
 int InterpolateShannon::transposeMulti(SAMPLETYPE *pdest,
                     const SAMPLETYPE *psrc,
                     int &srcSamples)
 {
-    // not implemented
-    assert(FALSE);
-    return 0;
-}
+    int i;
+    int srcSampleEnd = srcSamples - 8;
+    int srcCount = 0;
+
+    i = 0;
+    while (srcCount < srcSampleEnd)
+    {
+        double w[8];
+        assert(fract < 1.0);
+
+        // the weights are the same for all the channels
+        w[0] = sinc(-3.0 - fract) * _kaiser8[0];
+        w[1] = sinc(-2.0 - fract) * _kaiser8[1];
+        w[2] = sinc(-1.0 - fract) * _kaiser8[2];
+        w[3] = _kaiser8[3] * ((fract < 1e-5) ? 1.0 : sinc(- fract));   // sinc(0) = 1
+        w[4] = sinc( 1.0 - fract) * _kaiser8[4];
+        w[5] = sinc( 2.0 - fract) * _kaiser8[5];
+        w[6] = sinc( 3.0 - fract) * _kaiser8[6];
+        w[7] = sinc( 4.0 - fract) * _kaiser8[7];
+
+        for (int c = 0; c < numChannels; c ++)
+        {
+            const SAMPLETYPE *ptr = psrc + c;
+            double out = 0;
+
+            for (int k = 0; k < 8; k ++)
+            {
+                out += ptr[0] * w[k];
+                ptr += numChannels;
+            }
+            pdest[c] = (SAMPLETYPE)out;
+        }
+        pdest += numChannels;
+        i ++;
 
+        // update position fraction
+        fract += rate;
+        // update whole positions
+        int whole = (int)fract;
+        fract -= whole;
+        psrc += numChannels*whole;
+        srcCount += whole;
+    }
+    srcSamples = srcCount;
+    return i;
+}
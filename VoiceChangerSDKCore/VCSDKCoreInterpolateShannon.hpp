@@ -33,6 +33,11 @@ protected:
 
 public:
     InterpolateShannon();
+
+    int getLatency() const
+    {
+        return 8;
+    }
 };
 
 }
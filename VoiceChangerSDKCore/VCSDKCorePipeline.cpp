@@ -0,0 +1,320 @@
+////  VCSDKCorePipeline.cpp
+//  VoiceChanger
+//
+//  Pipelined multi-threaded execution of the VCSDKCore processing stages.
+//
+
+
+#include <string.h>
+#include <assert.h>
+
+#include "VCSDKCorePipeline.hpp"
+#include "VCSDKCoreAllocator.hpp"
+
+using namespace vcsdkcore;
+
+
+/// Frames moved between a queue & a stage at a time
+#define PIPELINE_BLOCK          2048
+
+/// Queue capacity in frames. Deep enough for several processing sequences of
+/// the tempo changer, so that the stages run decoupled.
+#define PIPELINE_QUEUE_FRAMES   16384
+
+
+/*****************************************************************************
+ *
+ * Implementation of the class 'VCSDKCoreSPSCQueue'
+ *
+ *****************************************************************************/
+
+VCSDKCoreSPSCQueue::VCSDKCoreSPSCQueue()
+{
+    buffer = NULL;
+    capacity = 0;
+    channels = 1;
+    head.store(0);
+    tail.store(0);
+}
+
+
+VCSDKCoreSPSCQueue::~VCSDKCoreSPSCQueue()
+{
+    VCSDKCoreAllocator::free(buffer);
+}
+
+
+void VCSDKCoreSPSCQueue::setFormat(uint numChannels, uint minFrames)
+{
+    uint size = 1;
+
+    while (size < minFrames) size <<= 1;
+
+    VCSDKCoreAllocator::free(buffer);
+    buffer = VCSDKCoreAllocator::allocArray<SAMPLETYPE>(size * numChannels);
+    capacity = size;
+    channels = numChannels;
+    head.store(0);
+    tail.store(0);
+}
+
+
+uint VCSDKCoreSPSCQueue::write(const SAMPLETYPE *samples, uint numFrames)
+{
+    const uint h = head.load(std::memory_order_relaxed);
+    const uint t = tail.load(std::memory_order_acquire);
+    uint space = capacity - (h - t);
+    uint pos, first;
+
+    if (numFrames > space) numFrames = space;
+    if (numFrames == 0) return 0;
+
+    // copy in at most two parts, up to the end of the buffer & from the start
+    pos = h & (capacity - 1);
+    first = capacity - pos;
+    if (first > numFrames) first = numFrames;
+    memcpy(buffer + pos * channels, samples, first * channels * sizeof(SAMPLETYPE));
+    memcpy(buffer, samples + first * channels, (numFrames - first) * channels * sizeof(SAMPLETYPE));
+
+    head.store(h + numFrames, std::memory_order_release);
+    return numFrames;
+}
+
+
+uint VCSDKCoreSPSCQueue::read(SAMPLETYPE *samples, uint maxFrames)
+{
+    const uint t = tail.load(std::memory_order_relaxed);
+    const uint h = head.load(std::memory_order_acquire);
+    uint avail = h - t;
+    uint pos, first;
+
+    if (maxFrames > avail) maxFrames = avail;
+    if (maxFrames == 0) return 0;
+
+    pos = t & (capacity - 1);
+    first = capacity - pos;
+    if (first > maxFrames) first = maxFrames;
+    memcpy(samples, buffer + pos * channels, first * channels * sizeof(SAMPLETYPE));
+    memcpy(samples + first * channels, buffer, (maxFrames - first) * channels * sizeof(SAMPLETYPE));
+
+    tail.store(t + maxFrames, std::memory_order_release);
+    return maxFrames;
+}
+
+
+uint VCSDKCoreSPSCQueue::numFrames() const
+{
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+}
+
+
+uint VCSDKCoreSPSCQueue::numFree() const
+{
+    return capacity - numFrames();
+}
+
+
+/*****************************************************************************
+ *
+ * Implementation of the class 'VCSDKCorePipeline'
+ *
+ *****************************************************************************/
+
+VCSDKCorePipeline::VCSDKCorePipeline(VCSDKCoreFIFOSamplePipe *first, VCSDKCoreFIFOSamplePipe *second, uint numChannels)
+    : outputBuffer((int)numChannels)
+{
+    firstStage = first;
+    secondStage = second;
+    channels = numChannels;
+
+    inputQueue.setFormat(channels, PIPELINE_QUEUE_FRAMES);
+    midQueue.setFormat(channels, PIPELINE_QUEUE_FRAMES);
+    outputQueue.setFormat(channels, PIPELINE_QUEUE_FRAMES);
+    firstBlock = VCSDKCoreAllocator::allocArray<SAMPLETYPE>(PIPELINE_BLOCK * channels);
+    secondBlock = VCSDKCoreAllocator::allocArray<SAMPLETYPE>(PIPELINE_BLOCK * channels);
+    collectBlock = VCSDKCoreAllocator::allocArray<SAMPLETYPE>(PIPELINE_BLOCK * channels);
+
+    inputPut.store(0);
+    inputDone.store(0);
+    midPut.store(0);
+    midDone.store(0);
+    bStop.store(false);
+
+    firstWorker = std::thread(&VCSDKCorePipeline::runFirst, this);
+    secondWorker = std::thread(&VCSDKCorePipeline::runSecond, this);
+}
+
+
+VCSDKCorePipeline::~VCSDKCorePipeline()
+{
+    bStop.store(true);
+    notify();
+    firstWorker.join();
+    secondWorker.join();
+
+    VCSDKCoreAllocator::free(firstBlock);
+    VCSDKCoreAllocator::free(secondBlock);
+    VCSDKCoreAllocator::free(collectBlock);
+}
+
+
+template <class Pred>
+void VCSDKCorePipeline::wait(Pred ready)
+{
+    std::unique_lock<std::mutex> lock(wakeLock);
+    wakeUp.wait(lock, ready);
+}
+
+
+void VCSDKCorePipeline::notify()
+{
+    std::lock_guard<std::mutex> lock(wakeLock);
+    wakeUp.notify_all();
+}
+
+
+// Forwards all output of 'stage' to 'queue'. The counter is updated before the
+// caller marks the input done, see 'sync'.
+void VCSDKCorePipeline::forward(VCSDKCoreFIFOSamplePipe *stage, VCSDKCoreSPSCQueue &queue,
+                                std::atomic<ulonglong> *pCounter)
+{
+    uint num;
+
+    while (stage->numSamples() > 0 && !bStop.load())
+    {
+        num = queue.write(stage->ptrBegin(), stage->numSamples());
+        if (num == 0)
+        {
+            // queue full, wait for the next stage to catch up
+            wait([&]() { return queue.numFree() > 0 || bStop.load(); });
+            continue;
+        }
+        stage->receiveSamples(num);
+        if (pCounter) pCounter->fetch_add(num, std::memory_order_release);
+        notify();
+    }
+}
+
+
+// First worker: input queue -> first stage -> middle queue
+void VCSDKCorePipeline::runFirst()
+{
+    uint num;
+
+    while (!bStop.load())
+    {
+        num = inputQueue.read(firstBlock, PIPELINE_BLOCK);
+        if (num == 0)
+        {
+            wait([this]() { return inputQueue.numFrames() > 0 || bStop.load(); });
+            continue;
+        }
+        // the caller may wait for space in the queue
+        notify();
+        firstStage->putSamples(firstBlock, num);
+        forward(firstStage, midQueue, &midPut);
+        inputDone.fetch_add(num, std::memory_order_release);
+        notify();
+    }
+}
+
+
+// Second worker: middle queue -> second stage -> output queue
+void VCSDKCorePipeline::runSecond()
+{
+    uint num;
+
+    while (!bStop.load())
+    {
+        num = midQueue.read(secondBlock, PIPELINE_BLOCK);
+        if (num == 0)
+        {
+            wait([this]() { return midQueue.numFrames() > 0 || bStop.load(); });
+            continue;
+        }
+        // the first worker may wait for space in the queue
+        notify();
+        secondStage->putSamples(secondBlock, num);
+        forward(secondStage, outputQueue, NULL);
+        midDone.fetch_add(num, std::memory_order_release);
+        notify();
+    }
+}
+
+
+void VCSDKCorePipeline::setStages(VCSDKCoreFIFOSamplePipe *first, VCSDKCoreFIFOSamplePipe *second)
+{
+    firstStage = first;
+    secondStage = second;
+}
+
+
+// Queues the input. While the input queue is full, collects the output so that
+// the workers don't stall on a full output queue.
+void VCSDKCorePipeline::putSamples(const SAMPLETYPE *samples, uint numSamples)
+{
+    uint num;
+
+    while (numSamples > 0)
+    {
+        num = inputQueue.write(samples, numSamples);
+        if (num == 0)
+        {
+            collectOutput();
+            wait([this]() { return inputQueue.numFree() > 0 || outputQueue.numFrames() > 0; });
+            continue;
+        }
+        inputPut.fetch_add(num, std::memory_order_relaxed);
+        notify();
+        samples += num * channels;
+        numSamples -= num;
+    }
+}
+
+
+// Waits until both stages have processed & forwarded all the queued input.
+// Each worker updates the counter of the next queue before marking its own input
+// done, so once 'inputDone' has caught up, 'midPut' is final.
+void VCSDKCorePipeline::sync()
+{
+    const ulonglong put = inputPut.load(std::memory_order_relaxed);
+    auto done = [&]() {
+        return inputDone.load(std::memory_order_acquire) == put &&
+               midDone.load(std::memory_order_acquire) == midPut.load(std::memory_order_acquire);
+    };
+
+    while (!done())
+    {
+        // the second worker may wait for space in the output queue
+        collectOutput();
+        wait([&]() { return done() || outputQueue.numFrames() > 0; });
+    }
+    collectOutput();
+}
+
+
+VCSDKCoreFIFOSampleBuffer *VCSDKCorePipeline::collectOutput()
+{
+    uint num;
+    bool collected = false;
+
+    while ((num = outputQueue.read(collectBlock, PIPELINE_BLOCK)) > 0)
+    {
+        outputBuffer.putSamples(collectBlock, num);
+        collected = true;
+    }
+    if (collected) notify();
+    return &outputBuffer;
+}
+
+
+uint VCSDKCorePipeline::numQueuedInput() const
+{
+    return (uint)(inputPut.load(std::memory_order_relaxed) - inputDone.load(std::memory_order_acquire));
+}
+
+
+void VCSDKCorePipeline::clear()
+{
+    outputBuffer.clear();
+}
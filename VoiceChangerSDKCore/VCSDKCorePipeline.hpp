@@ -0,0 +1,149 @@
+////  VCSDKCorePipeline.hpp
+//  VoiceChanger
+//
+//  Runs the two processing stages of VCSDKCore (rate transposer & tempo
+//  changer) on worker threads of their own, connected with bounded lock-free
+//  single-producer/single-consumer sample queues.
+//
+
+
+#ifndef VCSDKCorePipeline_hpp
+#define VCSDKCorePipeline_hpp
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "VCSDKCoreFIFOSampleBuffer.hpp"
+
+
+namespace vcsdkcore {
+
+
+/// Bounded lock-free sample queue for exactly one producer thread and one
+/// consumer thread. Samples are written & read in whole frames of 'channels'.
+class VCSDKCoreSPSCQueue
+{
+private:
+    SAMPLETYPE *buffer;
+    uint capacity;          ///< in frames, power of two
+    uint channels;
+
+    /// Frame counters, wrap around; the producer only writes 'head' and the
+    /// consumer only writes 'tail'
+    std::atomic<uint> head;
+    std::atomic<uint> tail;
+
+public:
+    VCSDKCoreSPSCQueue();
+    ~VCSDKCoreSPSCQueue();
+
+    /// Sets the format & capacity, at least 'minFrames' frames. Clears the queue,
+    /// so neither thread may access the queue meanwhile.
+    void setFormat(uint numChannels, uint minFrames);
+
+    /// Producer: writes up to 'numFrames' frames, returns the number written
+    uint write(const SAMPLETYPE *samples, uint numFrames);
+
+    /// Consumer: reads up to 'maxFrames' frames, returns the number read
+    uint read(SAMPLETYPE *samples, uint maxFrames);
+
+    /// Number of frames in the queue, exact for the consumer thread
+    uint numFrames() const;
+
+    /// Number of frames that fit in the queue, exact for the producer thread
+    uint numFree() const;
+};
+
+
+/// Pipelined execution of two FIFO processing stages.
+///
+/// The caller thread writes input with 'putSamples' and reads the output from
+/// 'collectOutput'. A worker thread feeds the input queue to the first stage and
+/// forwards its output to a middle queue, and another worker feeds that to the
+/// second stage and forwards the output to an output queue. 'collectOutput' moves
+/// the output queue contents to a FIFO buffer of the caller thread, so the
+/// output side never blocks the workers for long, like the output of the
+/// synchronous pipeline that just grows.
+///
+/// The stages must not be accessed by other threads than the workers unless the
+/// pipeline has been 'sync'ed, i.e. all the queued samples processed. The number
+/// of channels is fixed, a new pipeline is needed for changing it.
+class VCSDKCorePipeline
+{
+private:
+    VCSDKCoreFIFOSamplePipe *firstStage;
+    VCSDKCoreFIFOSamplePipe *secondStage;
+
+    VCSDKCoreSPSCQueue inputQueue;
+    VCSDKCoreSPSCQueue midQueue;
+    VCSDKCoreSPSCQueue outputQueue;
+
+    /// Output collected by the caller thread
+    VCSDKCoreFIFOSampleBuffer outputBuffer;
+
+    uint channels;
+
+    /// Per-worker transfer buffers, 'PIPELINE_BLOCK' frames
+    SAMPLETYPE *firstBlock;
+    SAMPLETYPE *secondBlock;
+    SAMPLETYPE *collectBlock;
+
+    /// Progress counters in frames. 'inputDone' counts the input frames the first
+    /// worker has processed and forwarded, 'midDone' the same for the second.
+    std::atomic<ulonglong> inputPut;
+    std::atomic<ulonglong> inputDone;
+    std::atomic<ulonglong> midPut;
+    std::atomic<ulonglong> midDone;
+
+    std::atomic<bool> bStop;
+
+    /// Waking up waiting threads only, the sample data doesn't need the lock. The
+    /// waiters check their condition under the lock & 'notify' takes it, so a
+    /// change between the check & the wait can't go unnoticed.
+    std::mutex wakeLock;
+    std::condition_variable wakeUp;
+
+    std::thread firstWorker;
+    std::thread secondWorker;
+
+    /// Blocks until 'ready()' returns true
+    template <class Pred> void wait(Pred ready);
+
+    /// Wakes up the waiting threads after a queue, a progress counter or 'bStop'
+    /// has changed
+    void notify();
+
+    /// Forwards all output of 'stage' to 'queue', waiting for space if necessary
+    void forward(VCSDKCoreFIFOSamplePipe *stage, VCSDKCoreSPSCQueue &queue, std::atomic<ulonglong> *pCounter);
+
+    void runFirst();
+    void runSecond();
+
+public:
+    VCSDKCorePipeline(VCSDKCoreFIFOSamplePipe *first, VCSDKCoreFIFOSamplePipe *second, uint numChannels);
+    ~VCSDKCorePipeline();
+
+    /// Sets the stages, e.g. when their order changes. Call only when sync'ed.
+    void setStages(VCSDKCoreFIFOSamplePipe *first, VCSDKCoreFIFOSamplePipe *second);
+
+    /// Queues input for the first stage. Blocks while the input queue is full.
+    void putSamples(const SAMPLETYPE *samples, uint numSamples);
+
+    /// Waits until the stages have processed all the queued input
+    void sync();
+
+    /// Moves the finished output to the caller side output buffer and returns it
+    VCSDKCoreFIFOSampleBuffer *collectOutput();
+
+    /// Number of input frames queued but not yet processed by the first stage
+    uint numQueuedInput() const;
+
+    /// Clears the output buffer. Call only when sync'ed, the queues are empty then.
+    void clear();
+};
+
+}
+
+#endif /* VCSDKCorePipeline_hpp */
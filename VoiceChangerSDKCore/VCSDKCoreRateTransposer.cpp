@@ -14,6 +14,7 @@
 #include "VCSDKCoreInterpolateLinear.hpp"
 #include "VCSDKCoreInterpolateCubic.hpp"
 #include "VCSDKCoreInterpolateShannon.hpp"
+#include "VCSDKCoreInterpolatePolyphase.hpp"
 #include "VCSDKCoreAAFilter.hpp"
 
 using namespace vcsdkcore;
@@ -27,10 +28,16 @@ VCSDKCoreTransposerBase::ALGORITHM VCSDKCoreTransposerBase::algorithm = VCSDKCor
 VCSDKCoreRateTransposer::VCSDKCoreRateTransposer() : VCSDKCoreFIFOProcessor(&outputBuffer)
 {
     bUseAAFilter = TRUE;
+    bFusedAAFilter = FALSE;
 
     // Instantiates the anti-alias filter
     pAAFilter = new VCSDKCoreAAFilter(64);
     pTransposer = VCSDKCoreTransposerBase::newInstance();
+    pResampler = VCSDKCoreAAResampler::newInstance();
+
+#ifdef VCSDKCORE_ENABLE_STATS
+    stats.reset();
+#endif
 }
 
 
@@ -39,6 +46,7 @@ VCSDKCoreRateTransposer::~VCSDKCoreRateTransposer()
 {
     delete pAAFilter;
     delete pTransposer;
+    delete pResampler;
 }
 
 
@@ -57,6 +65,39 @@ BOOL VCSDKCoreRateTransposer::isAAFilterEnabled() const
 }
 
 
+/// Enables/disables the fused anti-alias filter for rates above 1.0
+void VCSDKCoreRateTransposer::enableFusedAAFilter(BOOL newMode)
+{
+    bFusedAAFilter = newMode;
+    updateResampler();
+}
+
+
+/// Returns nonzero if the fused anti-alias filter is enabled.
+BOOL VCSDKCoreRateTransposer::isFusedAAFilterEnabled() const
+{
+    return bFusedAAFilter;
+}
+
+
+// Returns nonzero if the samples go through the resampler at the current rate
+BOOL VCSDKCoreRateTransposer::isFused() const
+{
+    return bUseAAFilter && bFusedAAFilter && (pTransposer->rate > 1.0f);
+}
+
+
+// Designs the resampler kernels if they're used & not up to date. The anti-alias
+// filter length may have changed through 'getAAFilter' since the latest call.
+void VCSDKCoreRateTransposer::updateResampler()
+{
+    if (isFused() && !pResampler->isDesigned(pTransposer->rate, pAAFilter->getLength()))
+    {
+        pResampler->setParameters(pTransposer->rate, pAAFilter->getLength());
+    }
+}
+
+
 VCSDKCoreAAFilter *VCSDKCoreRateTransposer::getAAFilter()
 {
     return pAAFilter;
@@ -82,6 +123,7 @@ void VCSDKCoreRateTransposer::setRate(float newRate)
         fCutoff = 0.5f * newRate;
     }
     pAAFilter->setCutoffFreq(fCutoff);
+    updateResampler();
 }
 
 
@@ -89,28 +131,48 @@ void VCSDKCoreRateTransposer::setRate(float newRate)
 // the input of the object.
 void VCSDKCoreRateTransposer::putSamples(const SAMPLETYPE *samples, uint nSamples)
 {
-    processSamples(samples, nSamples);
+    if (nSamples == 0) return;
+
+    // Store samples to input buffer
+    inputBuffer.putSamples(samples, nSamples);
+    processSamples(outputBuffer);
 }
 
 
-// Transposes sample rate by applying anti-alias filter to prevent folding.
-// Returns amount of samples returned in the "dest" buffer.
-// The maximum amount of samples that can be returned at a time is set by
-// the 'set_returnBuffer_size' function.
-void VCSDKCoreRateTransposer::processSamples(const SAMPLETYPE *src, uint nSamples)
+// Adds 'nSamples' pcs of samples into the input of the object, and writes the
+// result directly to the end of 'dest' instead of 'outputBuffer'. Saves copying
+// the result from 'outputBuffer' to the next stage.
+void VCSDKCoreRateTransposer::putSamples(const SAMPLETYPE *samples, uint nSamples, VCSDKCoreFIFOSampleBuffer &dest)
 {
-    uint count;
-
+    // earlier output goes first to keep the order
+    if (outputBuffer.isEmpty() == 0) dest.moveSamples(outputBuffer);
     if (nSamples == 0) return;
 
-    // Store samples to input buffer
-    inputBuffer.putSamples(src, nSamples);
+    inputBuffer.putSamples(samples, nSamples);
+    processSamples(dest);
+}
+
+
+// Processes the samples that the previous stage has written directly to the
+// input buffer
+void VCSDKCoreRateTransposer::processInput()
+{
+    if (inputBuffer.isEmpty()) return;
+    processSamples(outputBuffer);
+}
+
+
+// Transposes sample rate by applying anti-alias filter to prevent folding.
+// Appends the result to the "dest" buffer.
+void VCSDKCoreRateTransposer::processSamples(VCSDKCoreFIFOSampleBuffer &dest)
+{
+    VCSDKCORE_STATS_HIGH_WATER(stats.transposerInputHighWater, inputBuffer.numSamples());
 
     // If anti-alias filter is turned off, simply transpose without applying
     // the filter
     if (bUseAAFilter == FALSE)
     {
-        count = pTransposer->transpose(outputBuffer, inputBuffer);
+        transpose(dest, inputBuffer);
         return;
     }
 
@@ -123,23 +185,87 @@ void VCSDKCoreRateTransposer::processSamples(const SAMPLETYPE *src, uint nSample
         // the samples and then apply the anti-alias filter to remove aliasing.
 
         // Transpose the samples, store the result to end of "midBuffer"
-        pTransposer->transpose(midBuffer, inputBuffer);
+        transpose(midBuffer, inputBuffer);
 
         // Apply the anti-alias filter for transposed samples in midBuffer
-        pAAFilter->evaluate(outputBuffer, midBuffer);
+        filter(dest, midBuffer);
     }
     else
     {
         // If the parameter 'Rate' value is larger than 1, first apply the
         // anti-alias filter to remove high frequencies (prevent them from folding
         // over the lover frequencies), then transpose.
+        if (isFused())
+        {
+            // Both at once, evaluating the filter only at the output positions
+            updateResampler();
+            resample(dest, inputBuffer);
+            return;
+        }
 
         // Apply the anti-alias filter for samples in inputBuffer
-        pAAFilter->evaluate(midBuffer, inputBuffer);
+        filter(midBuffer, inputBuffer);
 
         // Transpose the AA-filtered samples in "midBuffer"
-        pTransposer->transpose(outputBuffer, midBuffer);
+        transpose(dest, midBuffer);
+    }
+}
+
+
+// Applies the anti-alias filter from 'src' to 'dest'
+void VCSDKCoreRateTransposer::filter(VCSDKCoreFIFOSampleBuffer &dest, VCSDKCoreFIFOSampleBuffer &src)
+{
+    uint count;
+
+    VCSDKCORE_STATS_TIMER(stats, STATS_AA_FILTER, 0);
+    count = pAAFilter->evaluate(dest, src);
+    VCSDKCORE_STATS_ADD_SAMPLES(stats, STATS_AA_FILTER, count);
+    updateHighWater(dest);
+}
+
+
+// Interpolates the samples from 'src' to 'dest' at the current rate
+void VCSDKCoreRateTransposer::transpose(VCSDKCoreFIFOSampleBuffer &dest, VCSDKCoreFIFOSampleBuffer &src)
+{
+    int count;
+
+    VCSDKCORE_STATS_TIMER(stats, STATS_TRANSPOSE, 0);
+    count = pTransposer->transpose(dest, src);
+    VCSDKCORE_STATS_ADD_SAMPLES(stats, STATS_TRANSPOSE, count);
+    updateHighWater(dest);
+}
+
+
+// Filters & interpolates the samples from 'src' to 'dest' in one pass. Counted
+// as anti-alias filter work in the stats.
+void VCSDKCoreRateTransposer::resample(VCSDKCoreFIFOSampleBuffer &dest, VCSDKCoreFIFOSampleBuffer &src)
+{
+    uint count;
+
+    VCSDKCORE_STATS_TIMER(stats, STATS_AA_FILTER, 0);
+    count = pResampler->evaluate(dest, src);
+    VCSDKCORE_STATS_ADD_SAMPLES(stats, STATS_AA_FILTER, count);
+    updateHighWater(dest);
+}
+
+
+// Raises the high-water mark of 'dest' after a stage wrote to it. 'dest' is either
+// 'midBuffer', or the output: 'outputBuffer' or the next stage's input buffer
+// written directly, see putSamples(samples, nSamples, dest).
+void VCSDKCoreRateTransposer::updateHighWater(const VCSDKCoreFIFOSampleBuffer &dest)
+{
+#ifdef VCSDKCORE_ENABLE_STATS
+    if (&dest == &midBuffer)
+    {
+        VCSDKCORE_STATS_HIGH_WATER(stats.transposerMidHighWater, dest.numSamples());
     }
+    else
+    {
+        VCSDKCORE_STATS_HIGH_WATER(stats.transposerOutputHighWater, dest.numSamples());
+    }
+#else
+    (void)dest;
+#endif
 }
 
 
@@ -150,6 +276,7 @@ void VCSDKCoreRateTransposer::setChannels(int nChannels)
 
     if (pTransposer->numChannels == nChannels) return;
     pTransposer->setChannels(nChannels);
+    pResampler->setChannels(nChannels);
 
     inputBuffer.setChannels(nChannels);
     midBuffer.setChannels(nChannels);
@@ -163,6 +290,18 @@ void VCSDKCoreRateTransposer::clear()
     outputBuffer.clear();
     midBuffer.clear();
     inputBuffer.clear();
+    pTransposer->resetRegisters();
+    pResampler->resetRegisters();
+}
+
+
+// Clears the input & intermediate buffers, leaving the output buffer intact
+void VCSDKCoreRateTransposer::clearInput()
+{
+    midBuffer.clear();
+    inputBuffer.clear();
+    pTransposer->resetRegisters();
+    pResampler->resetRegisters();
 }
 
 
@@ -177,6 +316,75 @@ int VCSDKCoreRateTransposer::isEmpty() const
 }
 
 
+// Returns the worst-case number of input samples held back inside the
+// anti-alias filter & interpolator between two batches
+int VCSDKCoreRateTransposer::getLatency() const
+{
+    int latency = pTransposer->getLatency();
+
+    if (isFused())
+    {
+        // the resampler holds back the filter length only
+        return (int)pAAFilter->getLength();
+    }
+    if (bUseAAFilter)
+    {
+        int aaLength = (int)pAAFilter->getLength();
+        if (pTransposer->rate < 1.0f)
+        {
+            // anti-alias filter runs after transposing, i.e. at the output rate
+            latency += (int)(aaLength * pTransposer->rate + 0.999f);
+        }
+        else
+        {
+            latency += aaLength;
+        }
+    }
+    return latency;
+}
+
+
+// Calculates the buffer sizes for input batches of up to 'maxBlockSize' samples.
+// The input buffer holds at most the latency plus a batch, and the interpolator
+// demands room for that at the output rate plus a few samples.
+void VCSDKCoreRateTransposer::calcPrepareSizes(uint maxBlockSize, uint *pNumIn, uint *pNumOut) const
+{
+    uint numIn = (uint)getLatency() + maxBlockSize + 8;
+    float minRate = (pTransposer->rate < 1.0f) ? pTransposer->rate : 1.0f;
+
+    *pNumIn = numIn;
+    *pNumOut = (uint)((float)numIn / minRate) + 8 + pAAFilter->getLength();
+}
+
+
+// Sizes the buffers for input batches of up to 'maxBlockSize' samples
+uint VCSDKCoreRateTransposer::prepare(uint maxBlockSize)
+{
+    uint numIn, numOut;
+
+    updateResampler();
+    calcPrepareSizes(maxBlockSize, &numIn, &numOut);
+    inputBuffer.reserve(numIn);
+    midBuffer.reserve(numOut);
+    outputBuffer.reserve(outputBuffer.numSamples() + numOut);
+    return numOut;
+}
+
+
+// Checks the buffer sizes against those 'prepare' would reserve
+BOOL VCSDKCoreRateTransposer::isPrepared(uint maxBlockSize, uint *pNumOut) const
+{
+    uint numIn, numOut;
+
+    calcPrepareSizes(maxBlockSize, &numIn, &numOut);
+    *pNumOut = numOut;
+    if (isFused() && !pResampler->isDesigned(pTransposer->rate, pAAFilter->getLength())) return FALSE;
+    return inputBuffer.isReserved(numIn) &&
+           midBuffer.isReserved(numOut) &&
+           outputBuffer.isReserved(outputBuffer.numSamples() + numOut);
+}
+
+
 //////////////////////////////////////////////////////////////////////////////
 //
 // TransposerBase - Base class for interpolation
@@ -193,7 +401,16 @@ void VCSDKCoreTransposerBase::setAlgorithm(VCSDKCoreTransposerBase::ALGORITHM a)
 // Returns the number of samples returned in the "dest" buffer
 int VCSDKCoreTransposerBase::transpose(VCSDKCoreFIFOSampleBuffer &dest, VCSDKCoreFIFOSampleBuffer &src)
 {
-    int numSrcSamples = src.numSamples();
+    if (numSkip > 0)
+    {
+        int skip = ((int)src.numSamples() < numSkip) ? (int)src.numSamples() : numSkip;
+        src.receiveSamples(skip);
+        numSkip -= skip;
+        if (numSkip > 0) return 0;
+    }
+
+    int numAvailable = src.numSamples();
+    int numSrcSamples = numAvailable;
     int sizeDemand = (int)((float)numSrcSamples / rate) + 8;
     int numOutput;
     SAMPLETYPE *psrc = src.ptrBegin();
@@ -215,6 +432,12 @@ int VCSDKCoreTransposerBase::transpose(VCSDKCoreFIFOSampleBuffer &dest, VCSDKCor
         numOutput = transposeMulti(pdest, psrc, numSrcSamples);
     }
     dest.putSamples(numOutput);
+    if (numSrcSamples > numAvailable)
+    {
+        // the position of the next output sample is already in the next batch
+        numSkip = numSrcSamples - numAvailable;
+        numSrcSamples = numAvailable;
+    }
     src.receiveSamples(numSrcSamples);
     return numOutput;
 }
@@ -223,6 +446,7 @@ int VCSDKCoreTransposerBase::transpose(VCSDKCoreFIFOSampleBuffer &dest, VCSDKCor
 VCSDKCoreTransposerBase::VCSDKCoreTransposerBase()
 {
     numChannels = 0;
+    numSkip = 0;
     rate = 1.0f;
 }
 
@@ -239,6 +463,12 @@ void VCSDKCoreTransposerBase::setChannels(int channels)
 }
 
 
+void VCSDKCoreTransposerBase::resetRegisters()
+{
+    numSkip = 0;
+}
+
+
 void VCSDKCoreTransposerBase::setRate(float newRate)
 {
     rate = newRate;
@@ -249,7 +479,12 @@ void VCSDKCoreTransposerBase::setRate(float newRate)
 VCSDKCoreTransposerBase *VCSDKCoreTransposerBase::newInstance()
 {
 #ifdef SOUNDTOUCH_INTEGER_SAMPLES
-    // Notice: For integer arithmetics support only linear algorithm (due to simplest calculus)
+    // Notice: For integer arithmetics support only linear algorithm (due to simplest calculus),
+    // and the polyphase one that works on float coefficients anyway
+    if (algorithm == POLYPHASE)
+    {
+        return VCSDKCoreInterpolatePolyphase::newInstance();
+    }
     return ::new InterpolateLinearInteger;
 #else
     switch (algorithm)
@@ -258,11 +493,14 @@ VCSDKCoreTransposerBase *VCSDKCoreTransposerBase::newInstance()
             return new InterpolateLinearFloat;
 
         case CUBIC:
-            return new InterpolateCubic;
+            return new VCSDKCoreInterpolateCubic;
 
         case SHANNON:
             return new InterpolateShannon;
 
+        case POLYPHASE:
+            return VCSDKCoreInterpolatePolyphase::newInstance();
+
         default:
             assert(false);
             return NULL;
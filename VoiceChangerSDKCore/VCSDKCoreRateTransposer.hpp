@@ -12,8 +12,10 @@
 
 #include <stddef.h>
 #include "VCSDKCoreAAFilter.hpp"
+#include "VCSDKCoreAAResampler.hpp"
 #include "VCSDKCoreFIFOSamplePipe.h"
 #include "VCSDKCoreFIFOSampleBuffer.hpp"
+#include "VCSDKCoreStats.h"
 
 #include "VCSDKCoreType.h"
 
@@ -28,12 +30,11 @@ public:
         enum ALGORITHM {
         LINEAR = 0,
         CUBIC,
-        SHANNON
+        SHANNON,
+        POLYPHASE       ///< table-driven Shannon-class interpolation, see VCSDKCoreInterpolatePolyphase
     };
 
 protected:
-    virtual void resetRegisters() = 0;
-
     virtual int transposeMono(SAMPLETYPE *dest,
                         const SAMPLETYPE *src,
                         int &srcSamples)  = 0;
@@ -46,6 +47,11 @@ protected:
 
     static ALGORITHM algorithm;
 
+    /// Source samples that the last batch stepped past the end of its input at
+    /// rates above 2, skipped at the start of the next batch so that the
+    /// interpolation position doesn't depend on the batch boundaries
+    int numSkip;
+
 public:
     float rate;
     int numChannels;
@@ -53,6 +59,14 @@ public:
     VCSDKCoreTransposerBase();
     virtual ~VCSDKCoreTransposerBase();
 
+    /// Resets the interpolation state so that the next sample starts a new stream.
+    /// Overrides reset their own registers & call this one.
+    virtual void resetRegisters();
+
+    /// Returns the number of source samples the interpolator holds back between
+    /// two batches
+    virtual int getLatency() const = 0;
+
     virtual int transpose(VCSDKCoreFIFOSampleBuffer &dest, VCSDKCoreFIFOSampleBuffer &src);
     virtual void setRate(float newRate);
     virtual void setChannels(int channels);
@@ -74,6 +88,10 @@ protected:
     VCSDKCoreAAFilter *pAAFilter;
     VCSDKCoreTransposerBase *pTransposer;
 
+    /// Anti-alias filter & transposer in one pass for rates above 1.0, used
+    /// instead of the two when 'bFusedAAFilter' is set
+    VCSDKCoreAAResampler *pResampler;
+
     /// Buffer for collecting samples to feed the anti-alias filter between
     /// two batches
     VCSDKCoreFIFOSampleBuffer inputBuffer;
@@ -85,14 +103,39 @@ protected:
     VCSDKCoreFIFOSampleBuffer outputBuffer;
 
     BOOL bUseAAFilter;
+    BOOL bFusedAAFilter;
+
+#ifdef VCSDKCORE_ENABLE_STATS
+    VCSDKCoreStats stats;
+#endif
+
+
+    /// Transposes sample rate of the samples in the input buffer by applying
+    /// anti-alias filter to prevent folding, and appends the result to 'dest',
+    /// which is either the own output buffer or the input buffer of the next stage.
+    void processSamples(VCSDKCoreFIFOSampleBuffer &dest);
+
+    /// Applies the anti-alias filter from 'src' to 'dest'
+    void filter(VCSDKCoreFIFOSampleBuffer &dest, VCSDKCoreFIFOSampleBuffer &src);
+
+    /// Interpolates the samples from 'src' to 'dest' at the current rate
+    void transpose(VCSDKCoreFIFOSampleBuffer &dest, VCSDKCoreFIFOSampleBuffer &src);
 
+    /// Filters & interpolates the samples from 'src' to 'dest' in one pass
+    void resample(VCSDKCoreFIFOSampleBuffer &dest, VCSDKCoreFIFOSampleBuffer &src);
 
-    /// Transposes sample rate by applying anti-alias filter to prevent folding.
-    /// Returns amount of samples returned in the "dest" buffer.
-    /// The maximum amount of samples that can be returned at a time is set by
-    /// the 'set_returnBuffer_size' function.
-    void processSamples(const SAMPLETYPE *src,
-                        uint numSamples);
+    /// Raises the mid or output buffer high-water mark, whichever 'dest' is
+    void updateHighWater(const VCSDKCoreFIFOSampleBuffer &dest);
+
+    /// Returns nonzero if the samples go through 'pResampler' at the current rate
+    BOOL isFused() const;
+
+    /// Designs the resampler kernels for the current rate & filter length if
+    /// they're used & not up to date
+    void updateResampler();
+
+    /// Calculates the buffer sizes 'prepare' reserves for 'maxBlockSize' input samples
+    void calcPrepareSizes(uint maxBlockSize, uint *pNumIn, uint *pNumOut) const;
 
 public:
     VCSDKCoreRateTransposer();
@@ -108,7 +151,11 @@ public:
 //    static RateTransposer *newInstance();
 
     /// Returns the output buffer object
-    VCSDKCoreFIFOSamplePipe *getOutput() { return &outputBuffer; };
+    VCSDKCoreFIFOSampleBuffer *getOutput() { return &outputBuffer; };
+
+    /// Returns the input buffer object. Samples written directly to it are
+    /// processed by 'processInput'.
+    VCSDKCoreFIFOSampleBuffer *getInput() { return &inputBuffer; };
 
     /// Returns the store buffer object
 //    FIFOSamplePipe *getStore() { return &storeBuffer; };
@@ -122,6 +169,14 @@ public:
     /// Returns nonzero if anti-alias filter is enabled.
     BOOL isAAFilterEnabled() const;
 
+    /// Enables/disables evaluating the anti-alias filter only at the output
+    /// positions when the rate is above 1.0, instead of filtering all the input
+    /// samples & interpolating between them. Zero to disable, nonzero to enable.
+    void enableFusedAAFilter(BOOL newMode);
+
+    /// Returns nonzero if the fused anti-alias filter is enabled.
+    BOOL isFusedAAFilterEnabled() const;
+
     /// Sets new target rate. Normal rate = 1.0, smaller values represent slower
     /// rate, larger faster rates.
     virtual void setRate(float newRate);
@@ -133,11 +188,50 @@ public:
     /// the input of the object.
     void putSamples(const SAMPLETYPE *samples, uint numSamples);
 
+    /// Adds 'numSamples' pcs of samples into the input of the object like above, but
+    /// writes the result directly to the end of 'dest', e.g. the input buffer of the
+    /// next stage, instead of the output buffer.
+    void putSamples(const SAMPLETYPE *samples, uint numSamples, VCSDKCoreFIFOSampleBuffer &dest);
+
+    /// Processes the samples written directly to the input buffer, see 'getInput'.
+    void processInput();
+
     /// Clears all the samples in the object
     void clear();
 
+    /// Clears the input & intermediate buffers, leaving the output buffer intact
+    void clearInput();
+
     /// Returns nonzero if there aren't any samples available for outputting.
     int isEmpty() const;
+
+    /// Returns the worst-case number of input samples held back inside the
+    /// anti-alias filter & interpolator between two batches
+    int getLatency() const;
+
+    /// Sizes the buffers up front for input batches of up to 'maxBlockSize' samples
+    /// at the current rate, so that processing them doesn't allocate. Returns the
+    /// maximum number of samples one such batch outputs.
+    uint prepare(uint maxBlockSize);
+
+    /// Returns nonzero if the buffers have room for processing an input batch of
+    /// 'maxBlockSize' samples without allocating, as after 'prepare'. Stores the
+    /// maximum number of samples the batch outputs to 'pNumOut'.
+    BOOL isPrepared(uint maxBlockSize, uint *pNumOut) const;
+
+#ifdef VCSDKCORE_ENABLE_STATS
+    /// Returns the anti-alias filter & interpolator timing and the FIFO
+    /// high-water marks of this stage
+    const VCSDKCoreStats &getStats() const
+    {
+        return stats;
+    }
+
+    void resetStats()
+    {
+        stats.reset();
+    }
+#endif
 };
 
 }
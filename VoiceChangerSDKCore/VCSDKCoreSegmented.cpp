@@ -0,0 +1,323 @@
+////  VCSDKCoreSegmented.cpp
+//  VoiceChanger
+//
+//  Segment-parallel offline processing: a whole sound is split into segments
+//  that overlap by a pre-roll, each segment is processed by its own VCSDKCore
+//  on a worker thread, and the segments are joined with a crossfade at a
+//  correlation-aligned position.
+//
+
+
+#include <string.h>
+#include <math.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "VCSDKCore.h"
+#include "VCSDKCoreTDStretch.hpp"
+#include "VCSDKCoreAllocator.hpp"
+
+using namespace vcsdkcore;
+
+
+/// Crossfade length at the segment seams
+#define SEGMENT_CROSSFADE_MS    10
+
+/// The seam crossfade position is searched within +- this range, which covers
+/// the pitch period of voice down to 100 Hz
+#define SEGMENT_SEEK_MS         10
+
+/// Extra pre-roll/post-roll on top of the pipeline latency, lets the tempo
+/// changer settle to the same sequence grid before the seam
+#define SEGMENT_SETTLE_MS       100
+
+/// Input is fed to the segment workers in blocks of this many samples
+#define SEGMENT_INPUT_BLOCK     65536
+
+
+/// One segment: its input range including the pre-roll & post-roll, and the
+/// processed output of that range. The last segment has no post-roll, it gets
+/// 'numSilence' samples of silence after its input instead, so that it has output
+/// past the end of the sound to be read at a positive seam offset too.
+struct SegmentJob
+{
+    VCSDKCore *core;
+    const SAMPLETYPE *input;
+    ulonglong numInput;
+    ulonglong numSilence;
+    SAMPLETYPE *output;
+    ulonglong numOutput;
+};
+
+
+// Processes one segment as a stream of its own
+static void processSegment(SegmentJob &job, uint channels)
+{
+    const SAMPLETYPE *input = job.input;
+    ulonglong remaining = job.numInput;
+    ulonglong received = 0;
+    uint num;
+
+    job.core->clear();
+    while (remaining > 0)
+    {
+        uint block = (remaining > SEGMENT_INPUT_BLOCK) ? SEGMENT_INPUT_BLOCK : (uint)remaining;
+        job.core->putSamples(input, block);
+        input += (ulonglong)block * channels;
+        remaining -= block;
+    }
+    if (job.numSilence > 0)
+    {
+        std::vector<SAMPLETYPE> silence((size_t)(job.numSilence * channels), 0);
+        job.core->putSamples(&silence[0], (uint)job.numSilence);
+    }
+    job.core->flush();
+
+    // flush yields exactly 'numOutput' samples
+    while (received < job.numOutput)
+    {
+        ulonglong space = job.numOutput - received;
+        num = job.core->receiveSamples(job.output + received * channels,
+                                       (space > SEGMENT_INPUT_BLOCK) ? SEGMENT_INPUT_BLOCK : (uint)space);
+        if (num == 0) break;
+        received += num;
+    }
+    if (received < job.numOutput)
+    {
+        memset(job.output + received * channels, 0, (size_t)((job.numOutput - received) * channels) * sizeof(SAMPLETYPE));
+    }
+}
+
+
+// Returns sample 'ch' of frame 'pos' of a segment output, zero outside the segment
+static inline double segmentSample(const SegmentJob &job, long long pos, uint ch, uint channels)
+{
+    if (pos < 0 || pos >= (long long)job.numOutput) return 0;
+    return (double)job.output[pos * channels + ch];
+}
+
+
+// Finds the offset within +- 'seekLength' where 'next' continues 'prev' best at
+// the seam, by normalized cross-correlation over the crossfade length.
+static int seekSeamOffset(const SegmentJob &prev, long long prevPos, const SegmentJob &next, long long nextPos,
+                          int crossfade, int seekLength, uint channels)
+{
+    double bestCorr = 0;
+    int bestOffs = 0;
+
+    for (int offs = -seekLength; offs <= seekLength; offs ++)
+    {
+        double corr = 0;
+        double norm = 0;
+
+        for (int i = 0; i < crossfade; i ++)
+        {
+            for (uint ch = 0; ch < channels; ch ++)
+            {
+                double value = segmentSample(next, nextPos + offs + i, ch, channels);
+                corr += segmentSample(prev, prevPos + i, ch, channels) * value;
+                norm += value * value;
+            }
+        }
+        corr /= sqrt((norm < 1e-9) ? 1.0 : norm);
+
+        if (offs == -seekLength || corr > bestCorr)
+        {
+            bestCorr = corr;
+            bestOffs = offs;
+        }
+    }
+    return bestOffs;
+}
+
+
+static inline SAMPLETYPE roundSample(double value)
+{
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+    return (SAMPLETYPE)floor(value + 0.5);
+#else
+    return (SAMPLETYPE)value;
+#endif
+}
+
+
+// Processes the whole sound in parallel segments, see the header
+ulonglong VCSDKCore::processSegmented(const SAMPLETYPE *input, ulonglong numSamples,
+                                      SAMPLETYPE *output, uint numThreads)
+{
+    int sampleRate;
+    ulonglong numOutput, padding, minSegment;
+    uint numSegments, i, ch;
+
+    if (bSrateSet == FALSE)
+    {
+        ST_THROW_RT_ERROR("SoundTouch : Sample rate not defined");
+    }
+    else if (channels == 0)
+    {
+        ST_THROW_RT_ERROR("SoundTouch : Number of channels not defined");
+    }
+
+    pTDStretch->getParameters(&sampleRate, NULL, NULL, NULL);
+    const double outPerIn = (double)getOutputSampleCount(1000000000ULL) / 1e9;
+    const int crossfade = sampleRate * SEGMENT_CROSSFADE_MS / 1000;
+    const int seekLength = sampleRate * SEGMENT_SEEK_MS / 1000;
+
+    numOutput = getOutputSampleCount(numSamples);
+
+    // pre-roll & post-roll in input samples: the pipeline latency plus the seam
+    // search & crossfade, so that both segments are well settled at the seam
+    padding = (ulonglong)((getLatencySamples() + crossfade + 2 * seekLength) / outPerIn)
+              + sampleRate * SEGMENT_SETTLE_MS / 1000;
+    minSegment = 4 * padding;
+
+    numSegments = (numThreads > 0) ? numThreads : 1;
+    if (numSamples / minSegment < numSegments)
+    {
+        numSegments = (uint)(numSamples / minSegment);
+    }
+
+    if (numSegments <= 1)
+    {
+        // too short to gain from splitting, process as one stream. The output is
+        // received only at the end, so not in the real-time safe mode.
+        ulonglong remaining = numSamples;
+        ulonglong received = 0;
+        uint num;
+        const BOOL realtimeSafe = bRealtimeSafe;
+
+        bRealtimeSafe = FALSE;
+        clear();
+        while (remaining > 0)
+        {
+            uint block = (remaining > SEGMENT_INPUT_BLOCK) ? SEGMENT_INPUT_BLOCK : (uint)remaining;
+            putSamples(input, block);
+            input += (ulonglong)block * channels;
+            remaining -= block;
+        }
+        flush();
+        while (received < numOutput &&
+               (num = receiveSamples(output + received * channels, SEGMENT_INPUT_BLOCK)) > 0)
+        {
+            received += num;
+        }
+        bRealtimeSafe = realtimeSafe;
+        return received;
+    }
+
+    // segment k covers input [bound[k], bound[k + 1]) and output [seam[k], seam[k + 1]),
+    // and is processed with 'padding' more input on both sides
+    std::vector<ulonglong> bound(numSegments + 1);
+    std::vector<ulonglong> seam(numSegments + 1);
+    std::vector<ulonglong> origin(numSegments);
+    std::vector<SegmentJob> jobs(numSegments);
+    std::vector<VCSDKCore *> cores(numSegments);
+
+    for (i = 0; i <= numSegments; i ++)
+    {
+        bound[i] = numSamples * i / numSegments;
+        seam[i] = getOutputSampleCount(bound[i]);
+    }
+    for (i = 0; i < numSegments; i ++)
+    {
+        ulonglong start = (bound[i] > padding) ? bound[i] - padding : 0;
+        ulonglong end = (bound[i + 1] + padding < numSamples) ? bound[i + 1] + padding : numSamples;
+
+        cores[i] = new VCSDKCore();
+        cores[i]->copySettings(*this);
+
+        jobs[i].core = cores[i];
+        jobs[i].input = input + start * channels;
+        jobs[i].numInput = end - start;
+        // the stitch reads up to 'seekLength' samples past the end at the last seam offset
+        jobs[i].numSilence = (end == numSamples) ? (ulonglong)(seekLength / outPerIn) + 2 : 0;
+        jobs[i].numOutput = getOutputSampleCount(end - start + jobs[i].numSilence);
+        jobs[i].output = VCSDKCoreAllocator::allocArray<SAMPLETYPE>((size_t)(jobs[i].numOutput * channels));
+        origin[i] = getOutputSampleCount(start);
+    }
+
+    // worker pool: the calling thread works too, and keeps working through the
+    // queue if threads can't be created
+    {
+        std::atomic<uint> nextJob(0);
+        std::vector<std::thread> workers;
+        const uint nch = channels;
+
+        auto work = [&jobs, &nextJob, numSegments, nch]()
+        {
+            uint job;
+            while ((job = nextJob.fetch_add(1)) < numSegments)
+            {
+                processSegment(jobs[job], nch);
+            }
+        };
+
+        for (i = 1; i < numSegments; i ++)
+        {
+            try
+            {
+                workers.push_back(std::thread(work));
+            }
+            catch (...)
+            {
+                break;
+            }
+        }
+        work();
+        for (i = 0; i < workers.size(); i ++)
+        {
+            workers[i].join();
+        }
+    }
+
+    // stitch: segment k is read at offset 'offs' from its nominal position,
+    // found by correlating it against segment k - 1 at the seam
+    long long offs = 0;
+    for (i = 0; i < numSegments; i ++)
+    {
+        const SegmentJob &job = jobs[i];
+        ulonglong pos = seam[i];
+
+        if (i > 0)
+        {
+            const SegmentJob &prev = jobs[i - 1];
+            long long prevPos = (long long)(seam[i] - origin[i - 1]) + offs;
+            long long nextPos = (long long)(seam[i] - origin[i]);
+
+            offs = seekSeamOffset(prev, prevPos, job, nextPos, crossfade, seekLength, channels);
+
+            for (int j = 0; j < crossfade && pos < seam[i + 1]; j ++, pos ++)
+            {
+                double w = (double)(j + 1) / (double)(crossfade + 1);
+                for (ch = 0; ch < channels; ch ++)
+                {
+                    double a = segmentSample(prev, prevPos + j, ch, channels);
+                    double b = segmentSample(job, nextPos + offs + j, ch, channels);
+                    output[pos * channels + ch] = roundSample(a + (b - a) * w);
+                }
+            }
+        }
+        for (; pos < seam[i + 1]; pos ++)
+        {
+            long long local = (long long)(pos - origin[i]) + offs;
+            if (local >= 0 && local < (long long)job.numOutput)
+            {
+                memcpy(output + pos * channels, job.output + local * channels, channels * sizeof(SAMPLETYPE));
+            }
+            else
+            {
+                memset(output + pos * channels, 0, channels * sizeof(SAMPLETYPE));
+            }
+        }
+    }
+
+    for (i = 0; i < numSegments; i ++)
+    {
+        VCSDKCoreAllocator::free(jobs[i].output);
+        delete cores[i];
+    }
+    clear();
+
+    return numOutput;
+}
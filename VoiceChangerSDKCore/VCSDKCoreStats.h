@@ -0,0 +1,111 @@
+////  VCSDKCoreStats.h
+//  VoiceChanger
+//
+//  Per-stage processing statistics.
+//
+//  Compiled in only when VCSDKCORE_ENABLE_STATS is defined (see VCSDKCoreType.h),
+//  otherwise the instrumentation macros expand to nothing and the processing
+//  classes carry no extra members.
+//
+
+
+#ifndef VCSDKCoreStats_h
+#define VCSDKCoreStats_h
+
+#include <string.h>
+#include "VCSDKCoreType.h"
+
+#ifdef VCSDKCORE_ENABLE_STATS
+#include <chrono>
+#endif
+
+
+namespace vcsdkcore {
+
+
+/// Instrumented processing stages
+enum STATS_STAGE
+{
+    STATS_SEEK = 0,         ///< TDStretch::seekBestOverlapPosition, samples = scanned offsets
+    STATS_OVERLAP,          ///< TDStretch overlap-add, samples = overlapped samples
+    STATS_AA_FILTER,        ///< AAFilter::evaluate, samples = filtered output samples
+    STATS_TRANSPOSE,        ///< TransposerBase::transpose, samples = interpolated output samples
+    STATS_NUM_STAGES
+};
+
+
+/// Accumulated counters of one processing stage
+struct VCSDKCoreStageStats
+{
+    ulonglong calls;
+    ulonglong nanoseconds;
+    ulonglong samples;
+};
+
+
+/// Processing statistics, see VCSDKCore::getStats(). FIFO high-water marks are
+/// the largest numbers of samples seen in the stage buffers.
+struct VCSDKCoreStats
+{
+    VCSDKCoreStageStats stage[STATS_NUM_STAGES];
+
+    uint tdInputHighWater;
+    uint tdOutputHighWater;
+    uint transposerInputHighWater;
+    uint transposerMidHighWater;
+    uint transposerOutputHighWater;
+
+    void reset()
+    {
+        memset(this, 0, sizeof(VCSDKCoreStats));
+    }
+};
+
+
+#ifdef VCSDKCORE_ENABLE_STATS
+
+/// Measures the lifetime of the object and adds it to the given stage counters
+class VCSDKCoreStatsTimer
+{
+private:
+    VCSDKCoreStageStats &stats;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    VCSDKCoreStatsTimer(VCSDKCoreStageStats &stageStats, uint numSamples) : stats(stageStats)
+    {
+        stats.calls ++;
+        stats.samples += numSamples;
+        start = std::chrono::steady_clock::now();
+    }
+
+    ~VCSDKCoreStatsTimer()
+    {
+        stats.nanoseconds += (ulonglong)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                 std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+/// Times the rest of the enclosing scope as stage 'stageId' of 'statsObj'
+#define VCSDKCORE_STATS_TIMER(statsObj, stageId, numSamples) \
+    VCSDKCoreStatsTimer _statsTimer((statsObj).stage[stageId], (uint)(numSamples))
+
+/// Adds output samples counted after the work to stage 'stageId' of 'statsObj'
+#define VCSDKCORE_STATS_ADD_SAMPLES(statsObj, stageId, numSamples) \
+    (statsObj).stage[stageId].samples += (uint)(numSamples)
+
+/// Raises high-water mark 'mark' to 'value' if exceeded
+#define VCSDKCORE_STATS_HIGH_WATER(mark, value) \
+    { uint _hw = (uint)(value); if (_hw > (mark)) (mark) = _hw; }
+
+#else
+
+#define VCSDKCORE_STATS_TIMER(statsObj, stageId, numSamples)
+#define VCSDKCORE_STATS_ADD_SAMPLES(statsObj, stageId, numSamples)  (void)(numSamples)
+#define VCSDKCORE_STATS_HIGH_WATER(mark, value)
+
+#endif // VCSDKCORE_ENABLE_STATS
+
+}
+
+#endif /* VCSDKCoreStats_h */
@@ -12,10 +12,12 @@
 #include <assert.h>
 #include <math.h>
 #include <float.h>
+#include <chrono>
 
 #include "VCSDKCoreType.h"
 #include "VCSDKCoreCpu_detect.h"
 #include "VCSDKCoreTDStretch.hpp"
+#include "VCSDKCoreAllocator.hpp"
 
 using namespace vcsdkcore;
 
@@ -52,10 +54,16 @@ static const short _scanOffsets[5][24]={
 VCSDKCoreTDStretch::VCSDKCoreTDStretch() : VCSDKCoreFIFOProcessor(&outputBuffer)
 {
     bQuickSeek = FALSE;
+    bFFTSeek = FALSE;
+    bFFTSeekFaster = FALSE;
+    fftSeekCost = 0;
+    bHierarchicalSeek = FALSE;
+    seekDecimation = 1;
+    pSeekDecimated = NULL;
+    seekDecimatedSize = 0;
     channels = 2;
 
     pMidBuffer = NULL;
-    pMidBufferUnaligned = NULL;
     overlapLength = 0;
 
     bAutoSeqSetting = TRUE;
@@ -68,6 +76,10 @@ VCSDKCoreTDStretch::VCSDKCoreTDStretch() : VCSDKCoreFIFOProcessor(&outputBuffer)
     setParameters(44100, DEFAULT_SEQUENCE_MS, DEFAULT_SEEKWINDOW_MS, DEFAULT_OVERLAP_MS);
     setTempo(1.0f);
 
+#ifdef VCSDKCORE_ENABLE_STATS
+    stats.reset();
+#endif
+
     clear();
 }
 
@@ -75,7 +87,8 @@ VCSDKCoreTDStretch::VCSDKCoreTDStretch() : VCSDKCoreFIFOProcessor(&outputBuffer)
 
 VCSDKCoreTDStretch::~VCSDKCoreTDStretch()
 {
-    delete[] pMidBufferUnaligned;
+    VCSDKCoreAllocator::free(pMidBuffer);
+    VCSDKCoreAllocator::free(pSeekDecimated);
 }
 
 
@@ -184,6 +197,7 @@ void VCSDKCoreTDStretch::clearInput()
 {
     inputBuffer.clear();
     clearMidBuffer();
+    skipFract = 0;
 }
 
 
@@ -211,13 +225,62 @@ BOOL VCSDKCoreTDStretch::isQuickSeekEnabled() const
 }
 
 
+// Enables/disables the FFT position seeking algorithm. Zero to disable, nonzero
+// to enable
+void VCSDKCoreTDStretch::enableFFTSeek(BOOL enable)
+{
+    bFFTSeek = enable;
+    prepareFFTSeek();
+}
+
+
+// Returns nonzero if the FFT seeking algorithm is enabled.
+BOOL VCSDKCoreTDStretch::isFFTSeekEnabled() const
+{
+    return bFFTSeek;
+}
+
+
+// Returns nonzero if seekBestOverlapPosition goes to the FFT seek, see there
+BOOL VCSDKCoreTDStretch::isFFTSeekInUse() const
+{
+    return (!bQuickSeek && !bHierarchicalSeek && bFFTSeek && bFFTSeekFaster) ? TRUE : FALSE;
+}
+
+
+// Enables/disables the coarse-to-fine position seeking algorithm. Zero to disable,
+// nonzero to enable
+void VCSDKCoreTDStretch::enableHierarchicalSeek(BOOL enable)
+{
+    bHierarchicalSeek = enable;
+    prepareHierarchicalSeek();
+}
+
+
+// Returns nonzero if the coarse-to-fine seeking algorithm is enabled.
+BOOL VCSDKCoreTDStretch::isHierarchicalSeekEnabled() const
+{
+    return bHierarchicalSeek;
+}
+
+
 // Seeks for the optimal overlap-mixing position.
 int VCSDKCoreTDStretch::seekBestOverlapPosition(const SAMPLETYPE *refPos)
 {
+    VCSDKCORE_STATS_TIMER(stats, STATS_SEEK, seekLength);
+
     if (bQuickSeek)
     {
         return seekBestOverlapPositionQuick(refPos);
     }
+    else if (bHierarchicalSeek)
+    {
+        return seekBestOverlapPositionHierarchical(refPos);
+    }
+    else if (bFFTSeek && bFFTSeekFaster)
+    {
+        return seekBestOverlapPositionFFT(refPos);
+    }
     else
     {
         return seekBestOverlapPositionFull(refPos);
@@ -353,6 +416,294 @@ int VCSDKCoreTDStretch::seekBestOverlapPositionQuick(const SAMPLETYPE *refPos)
 
 
 
+// Seeks for the optimal overlap-mixing position like seekBestOverlapPositionFull,
+// but the cross-correlation of 'pMidBuffer' against every offset of the seek
+// window is calculated in one pass with FFT, the normalizer is updated
+// incrementally the same way as calcCrossCorrAccumulate does.
+int VCSDKCoreTDStretch::seekBestOverlapPositionFFT(const SAMPLETYPE *refPos)
+{
+    int bestOffs;
+    double bestCorr, corr;
+    double norm;
+    int i, c;
+    const int ovlSamples = channels * overlapLength;
+    const double *pCorr;
+
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+    // the integer routines scale the products down by 'overlapDividerBits'
+    const double scale = 1.0 / (double)(1 << overlapDividerBits);
+#else
+    const double scale = 1.0;
+#endif
+
+    // buffers are normally sized already by prepareFFTSeek
+    fft.setSize((uint)(channels * (seekLength - 1) + ovlSamples));
+
+    pCorr = fft.crossCorrelate(refPos, (uint)(channels * (seekLength - 1) + ovlSamples),
+                               pMidBuffer, (uint)ovlSamples);
+
+    norm = 0;
+    for (i = 0; i < ovlSamples; i ++)
+    {
+        norm += (double)refPos[i] * (double)refPos[i];
+    }
+
+    bestCorr = 0;
+    bestOffs = 0;
+    for (i = 0; i < seekLength; i ++)
+    {
+        const SAMPLETYPE *mixingPos = refPos + channels * i;
+        if (i > 0)
+        {
+            // slide the normalizer window by one sample
+            for (c = 1; c <= channels; c ++)
+            {
+                norm -= (double)mixingPos[-c] * (double)mixingPos[-c];
+                norm += (double)mixingPos[ovlSamples - c] * (double)mixingPos[ovlSamples - c];
+            }
+        }
+
+        double scaledNorm = norm * scale;
+        corr = pCorr[channels * i] * scale / sqrt((scaledNorm < 1e-9) ? 1.0 : scaledNorm);
+
+        if (i > 0)
+        {
+            // heuristic rule to slightly favour values close to mid of the range,
+            // same as in seekBestOverlapPositionFull
+            double tmp = (double)(2 * i - seekLength) / (double)seekLength;
+            corr = ((corr + 0.1) * (1.0 - 0.25 * tmp * tmp));
+        }
+
+        if (i == 0 || corr > bestCorr)
+        {
+            bestCorr = corr;
+            bestOffs = i;
+        }
+    }
+
+    return bestOffs;
+}
+
+
+/// Decides whether the FFT seek is cheaper than the full seek for the current seek
+/// & overlap lengths, and if so, sizes the FFT buffers so that
+/// seekBestOverlapPositionFFT doesn't need to allocate
+void VCSDKCoreTDStretch::prepareFFTSeek()
+{
+    bFFTSeekFaster = FALSE;
+    if (bFFTSeek && overlapLength > 0 && seekLength > 0)
+    {
+        const uint length = (uint)(channels * (seekLength - 1 + overlapLength));
+        uint size = 2;
+        int log2Size = 1;
+
+        while (size < length)
+        {
+            size <<= 1;
+            log2Size ++;
+        }
+
+        // measured once, at the first parameters, the cost ratio holds for others
+        if (fftSeekCost <= 0)
+        {
+            fftSeekCost = measureFFTSeekCost();
+        }
+
+        // the full seek takes seek x overlap products per channel, the FFT seek
+        // two transforms of 'size' points
+        if ((double)channels * seekLength * overlapLength > fftSeekCost * size * log2Size)
+        {
+            bFFTSeekFaster = TRUE;
+            fft.setSize(length);
+        }
+    }
+}
+
+
+/// Number of times measureFFTSeekCost runs each seek, the fastest run counts so
+/// that a cold cache or a preemption doesn't decide
+#define FFT_SEEK_TIMING_RUNS    4
+
+// Times both seeks on a scratch signal of the current seek range, see the header
+double VCSDKCoreTDStretch::measureFFTSeekCost()
+{
+    const int length = channels * (seekLength - 1 + overlapLength);
+    SAMPLETYPE *pScratch = VCSDKCoreAllocator::allocArray<SAMPLETYPE>(length);
+    double fullNs = 0, fftNs = 0;
+    uint seed = 22222;
+    int log2Size = 0;
+    int i;
+
+    for (i = 0; i < length; i ++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        pScratch[i] = (SAMPLETYPE)((int)(seed >> 20) - 2048);
+    }
+    fft.setSize((uint)length);
+    for (i = fft.getSize(); i > 1; i >>= 1)
+    {
+        log2Size ++;
+    }
+
+    for (i = 0; i < FFT_SEEK_TIMING_RUNS; i ++)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        seekBestOverlapPositionFull(pScratch);
+        std::chrono::steady_clock::time_point mid = std::chrono::steady_clock::now();
+        seekBestOverlapPositionFFT(pScratch);
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+        double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(mid - start).count();
+        if (i == 0 || ns < fullNs) fullNs = ns;
+        ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - mid).count();
+        if (i == 0 || ns < fftNs) fftNs = ns;
+    }
+    VCSDKCoreAllocator::free(pScratch);
+
+    // below the timer resolution, count one tick
+    if (fullNs < 1) fullNs = 1;
+    if (fftNs < 1) fftNs = 1;
+
+    return (fftNs / ((double)fft.getSize() * log2Size)) /
+           (fullNs / ((double)channels * seekLength * overlapLength));
+}
+
+
+// Sums 'factor' consecutive frames of all channels into one value
+static void _decimate(float *dest, const SAMPLETYPE *src, int numOut, int factor, int channels)
+{
+    const int step = factor * channels;
+
+    for (int i = 0; i < numOut; i ++)
+    {
+        float sum = 0;
+        for (int j = 0; j < step; j ++)
+        {
+            sum += (float)src[j];
+        }
+        dest[i] = sum;
+        src += step;
+    }
+}
+
+
+// Seeks for the optimal overlap-mixing position in two steps. First scans the
+// whole seek window with decimated mono mixdowns of 'refPos' & 'pMidBuffer',
+// then rescans the neighbourhood of the best coarse position at full rate.
+//
+// The decimation factor follows the sample rate so that the coarse scan runs at
+// about 8 kHz, which still resolves the pitch periods of voice. Box-filtering is
+// sufficient anti-aliasing as only the location of the correlation peak matters.
+int VCSDKCoreTDStretch::seekBestOverlapPositionHierarchical(const SAMPLETYPE *refPos)
+{
+    const int factor = seekDecimation;
+    const int ovlDec = overlapLength / factor;
+    const int seekDec = (seekLength - 1) / factor + 1;
+    int bestOffs, coarseOffs, start, end;
+    double bestCorr, corr, norm;
+    float *pMidDec, *pRefDec;
+    int i, k;
+
+    // nothing to gain at low sample rates or with very short overlaps
+    if (factor < 2 || ovlDec < 8)
+    {
+        return seekBestOverlapPositionFull(refPos);
+    }
+
+    // prepareHierarchicalSeek has normally sized the buffers already when the seek
+    // was enabled, the tempo set or 'prepare' called; this allocates only if not
+    prepareHierarchicalSeek();
+    pMidDec = pSeekDecimated;
+    pRefDec = pSeekDecimated + ovlDec;
+
+    _decimate(pMidDec, pMidBuffer, ovlDec, factor, channels);
+    _decimate(pRefDec, refPos, seekDec - 1 + ovlDec, factor, channels);
+
+    // coarse scan, with the rolling normalizer as in calcCrossCorrAccumulate
+    norm = 0;
+    for (i = 0; i < ovlDec; i ++)
+    {
+        norm += (double)pRefDec[i] * pRefDec[i];
+    }
+    bestCorr = 0;
+    coarseOffs = 0;
+    for (k = 0; k < seekDec; k ++)
+    {
+        const float *pRef = pRefDec + k;
+        float sum = 0;
+
+        if (k > 0)
+        {
+            norm += (double)pRef[ovlDec - 1] * pRef[ovlDec - 1] - (double)pRef[-1] * pRef[-1];
+        }
+        for (i = 0; i < ovlDec; i ++)
+        {
+            sum += pRef[i] * pMidDec[i];
+        }
+        corr = (double)sum / sqrt((norm < 1e-9) ? 1.0 : norm);
+
+        // heuristic rule to slightly favour values close to mid of the range,
+        // same as in seekBestOverlapPositionFull
+        double tmp = (double)(2 * k * factor - seekLength) / (double)seekLength;
+        corr = ((corr + 0.1) * (1.0 - 0.25 * tmp * tmp));
+
+        if (k == 0 || corr > bestCorr)
+        {
+            bestCorr = corr;
+            coarseOffs = k * factor;
+        }
+    }
+
+    // refine at full rate within one coarse step around the coarse optimum
+    start = coarseOffs - factor + 1;
+    end = coarseOffs + factor - 1;
+    if (start < 0) start = 0;
+    if (end > seekLength - 1) end = seekLength - 1;
+
+    bestCorr = 0;
+    bestOffs = start;
+    for (i = start; i <= end; i ++)
+    {
+        corr = calcCrossCorr(refPos + channels * i, pMidBuffer, norm);
+        if (i > 0)
+        {
+            double tmp = (double)(2 * i - seekLength) / (double)seekLength;
+            corr = ((corr + 0.1) * (1.0 - 0.25 * tmp * tmp));
+        }
+        if (i == start || corr > bestCorr)
+        {
+            bestCorr = corr;
+            bestOffs = i;
+        }
+    }
+    // clear cross correlation routine state if necessary (is so e.g. in MMX routines).
+    clearCrossCorrState();
+
+    return bestOffs;
+}
+
+
+/// Chooses the decimation factor for the current sample rate and sizes the
+/// decimated signal buffer so that seekBestOverlapPositionHierarchical doesn't
+/// need to allocate
+void VCSDKCoreTDStretch::prepareHierarchicalSeek()
+{
+    if (!bHierarchicalSeek || overlapLength <= 0 || seekLength <= 0) return;
+
+    seekDecimation = sampleRate / 8000;
+    if (seekDecimation < 1) seekDecimation = 1;
+
+    // decimated mid buffer + decimated seek range
+    int size = overlapLength / seekDecimation + (seekLength - 1) / seekDecimation + overlapLength / seekDecimation;
+    if (size > seekDecimatedSize)
+    {
+        VCSDKCoreAllocator::free(pSeekDecimated);
+        pSeekDecimated = VCSDKCoreAllocator::allocArray<float>(size);
+        seekDecimatedSize = size;
+    }
+}
+
+
 /// clear cross correlation routine state if necessary
 void VCSDKCoreTDStretch::clearCrossCorrState()
 {
@@ -428,6 +779,9 @@ void VCSDKCoreTDStretch::setTempo(float newTempo)
     // process another batch of samples
     //sampleReq = max(intskip + overlapLength, seekWindowLength) + seekLength / 2;
     sampleReq = max(intskip + overlapLength, seekWindowLength) + seekLength;
+
+    prepareFFTSeek();
+    prepareHierarchicalSeek();
 }
 
 
@@ -443,6 +797,9 @@ void VCSDKCoreTDStretch::setChannels(int numChannels)
     inputBuffer.setChannels(channels);
     outputBuffer.setChannels(channels);
 
+    // the FFT seek cost differs with the channels, measure again
+    fftSeekCost = 0;
+
     // re-init overlap/buffer
     overlapLength=0;
     setParameters(sampleRate);
@@ -483,8 +840,8 @@ void TDStretch::processNominalTempo()
 
 
 // Processes as many processing frames of the samples 'inputBuffer', store
-// the result into 'outputBuffer'
-void VCSDKCoreTDStretch::processSamples()
+// the result into 'dest'
+void VCSDKCoreTDStretch::processSamples(VCSDKCoreFIFOSampleBuffer &dest)
 {
     int ovlSkip, offset;
     int temp;
@@ -511,8 +868,11 @@ void VCSDKCoreTDStretch::processSamples()
         // samples in 'midBuffer' using sliding overlapping
         // ... first partially overlap with the end of the previous sequence
         // (that's in 'midBuffer')
-        overlap(outputBuffer.ptrEnd((uint)overlapLength), inputBuffer.ptrBegin(), (uint)offset);
-        outputBuffer.putSamples((uint)overlapLength);
+        {
+            VCSDKCORE_STATS_TIMER(stats, STATS_OVERLAP, overlapLength);
+            overlap(dest.ptrEnd((uint)overlapLength), inputBuffer.ptrBegin(), (uint)offset);
+        }
+        dest.putSamples((uint)overlapLength);
 
         // ... then copy sequence samples from 'inputBuffer' to output:
 
@@ -525,7 +885,7 @@ void VCSDKCoreTDStretch::processSamples()
             continue;    // just in case, shouldn't really happen
         }
 
-        outputBuffer.putSamples(inputBuffer.ptrBegin() + channels * (offset + overlapLength), (uint)temp);
+        dest.putSamples(inputBuffer.ptrBegin() + channels * (offset + overlapLength), (uint)temp);
 
         // Copies the end of the current sequence from 'inputBuffer' to
         // 'midBuffer' for being mixed with the beginning of the next
@@ -551,11 +911,78 @@ void VCSDKCoreTDStretch::putSamples(const SAMPLETYPE *samples, uint nSamples)
 {
     // Add the samples into the input buffer
     inputBuffer.putSamples(samples, nSamples);
+    VCSDKCORE_STATS_HIGH_WATER(stats.tdInputHighWater, inputBuffer.numSamples());
     // Process the samples in input buffer
-    processSamples();
+    processSamples(outputBuffer);
+    VCSDKCORE_STATS_HIGH_WATER(stats.tdOutputHighWater, outputBuffer.numSamples());
+}
+
+
+// Adds 'numsamples' pcs of samples into the input of the object, and writes the
+// result directly to the end of 'dest' instead of 'outputBuffer'. Saves copying
+// the result from 'outputBuffer' to the next stage.
+void VCSDKCoreTDStretch::putSamples(const SAMPLETYPE *samples, uint nSamples, VCSDKCoreFIFOSampleBuffer &dest)
+{
+    // earlier output goes first to keep the order
+    if (outputBuffer.isEmpty() == 0) dest.moveSamples(outputBuffer);
+
+    inputBuffer.putSamples(samples, nSamples);
+    VCSDKCORE_STATS_HIGH_WATER(stats.tdInputHighWater, inputBuffer.numSamples());
+    processSamples(dest);
+    // 'dest' takes the place of 'outputBuffer'
+    VCSDKCORE_STATS_HIGH_WATER(stats.tdOutputHighWater, dest.numSamples());
 }
 
 
+// Processes the samples that the previous stage has written directly to the
+// input buffer
+void VCSDKCoreTDStretch::processInput()
+{
+    VCSDKCORE_STATS_HIGH_WATER(stats.tdInputHighWater, inputBuffer.numSamples());
+    processSamples(outputBuffer);
+    VCSDKCORE_STATS_HIGH_WATER(stats.tdOutputHighWater, outputBuffer.numSamples());
+}
+
+
+
+// Calculates the buffer sizes for input batches of up to 'maxBlockSize' samples.
+// Less than 'sampleReq' samples stay in the input buffer between batches, and each
+// processing sequence consumes at least 'intskip' of them & outputs a sequence.
+void VCSDKCoreTDStretch::calcPrepareSizes(uint maxBlockSize, uint *pNumIn, uint *pNumOut) const
+{
+    uint numIn = (uint)sampleReq + maxBlockSize;
+    uint skip = (uint)max((int)nominalSkip, 1);
+
+    *pNumIn = numIn;
+    *pNumOut = (numIn / skip + 1) * (uint)seekWindowLength;
+}
+
+
+// Sizes the buffers for input batches of up to 'maxBlockSize' samples
+uint VCSDKCoreTDStretch::prepare(uint maxBlockSize)
+{
+    uint numIn, numOut;
+
+    calcPrepareSizes(maxBlockSize, &numIn, &numOut);
+    inputBuffer.reserve(numIn);
+    outputBuffer.reserve(outputBuffer.numSamples() + numOut);
+    prepareHierarchicalSeek();
+    return numOut;
+}
+
+
+// Checks the buffer sizes against those 'prepare' would reserve. The seek buffers
+// are sized whenever the parameters change, so they needn't be checked.
+BOOL VCSDKCoreTDStretch::isPrepared(uint maxBlockSize, uint *pNumOut) const
+{
+    uint numIn, numOut;
+
+    calcPrepareSizes(maxBlockSize, &numIn, &numOut);
+    *pNumOut = numOut;
+    return inputBuffer.isReserved(numIn) &&
+           outputBuffer.isReserved(outputBuffer.numSamples() + numOut);
+}
+
 
 /// Set new overlap length parameter & reallocate RefMidBuffer if necessary.
 void VCSDKCoreTDStretch::acceptNewOverlapLength(int newOverlapLength)
@@ -568,11 +995,10 @@ void VCSDKCoreTDStretch::acceptNewOverlapLength(int newOverlapLength)
 
     if (overlapLength > prevOvl)
     {
-        delete[] pMidBufferUnaligned;
+        VCSDKCoreAllocator::free(pMidBuffer);
 
-        pMidBufferUnaligned = new SAMPLETYPE[overlapLength * channels + 16 / sizeof(SAMPLETYPE)];
-        // ensure that 'pMidBuffer' is aligned to 16 byte boundary for efficiency
-        pMidBuffer = (SAMPLETYPE *)SOUNDTOUCH_ALIGN_POINTER_16(pMidBufferUnaligned);
+        // the allocator aligns 'pMidBuffer' to VCSDKCORE_ALIGNMENT boundary for efficiency
+        pMidBuffer = VCSDKCoreAllocator::allocArray<SAMPLETYPE>(overlapLength * channels);
 
         clearMidBuffer();
     }
@@ -595,7 +1021,15 @@ VCSDKCoreTDStretch * VCSDKCoreTDStretch::newInstance()
 
     uExtensions = detectCPUextensions();
 
-    // Check if MMX/SSE instruction set extensions supported by CPU
+    // Check if AVX2/MMX/SSE instruction set extensions supported by CPU
+
+#ifdef SOUNDTOUCH_ALLOW_AVX2
+    if ((uExtensions & SUPPORT_AVX2_ROUTINES) == SUPPORT_AVX2_ROUTINES)
+    {
+        return ::new TDStretchAVX2;
+    }
+    else
+#endif // SOUNDTOUCH_ALLOW_AVX2
 
 #ifdef SOUNDTOUCH_ALLOW_MMX
     // MMX routines available only with integer sample types
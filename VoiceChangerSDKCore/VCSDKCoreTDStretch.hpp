@@ -14,6 +14,8 @@
 #include "VCSDKCoreType.h"
 #include "VCSDKCoreRateTransposer.hpp"
 #include "VCSDKCoreFIFOSamplePipe.h"
+#include "VCSDKCoreStats.h"
+#include "VCSDKCoreFFT.hpp"
 
 
 namespace vcsdkcore {
@@ -82,7 +84,6 @@ protected:
     float tempo;
 
     SAMPLETYPE *pMidBuffer;
-    SAMPLETYPE *pMidBufferUnaligned;
     int overlapLength;
     int seekLength;
     int seekWindowLength;
@@ -93,6 +94,15 @@ protected:
     VCSDKCoreFIFOSampleBuffer outputBuffer;
     VCSDKCoreFIFOSampleBuffer inputBuffer;
     BOOL bQuickSeek;
+    BOOL bFFTSeek;
+    BOOL bFFTSeekFaster;
+    /// Measured cost ratio of measureFFTSeekCost, zero until measured
+    double fftSeekCost;
+    VCSDKCoreFFT fft;
+    BOOL bHierarchicalSeek;
+    int seekDecimation;
+    float *pSeekDecimated;
+    int seekDecimatedSize;
 
     int sampleRate;
     int sequenceMs;
@@ -101,6 +111,10 @@ protected:
     BOOL bAutoSeqSetting;
     BOOL bAutoSeekSetting;
 
+#ifdef VCSDKCORE_ENABLE_STATS
+    VCSDKCoreStats stats;
+#endif
+
     void acceptNewOverlapLength(int newOverlapLength);
 
     virtual void clearCrossCorrState();
@@ -111,6 +125,13 @@ protected:
 
     virtual int seekBestOverlapPositionFull(const SAMPLETYPE *refPos);
     virtual int seekBestOverlapPositionQuick(const SAMPLETYPE *refPos);
+    int seekBestOverlapPositionFFT(const SAMPLETYPE *refPos);
+
+    /// Times the full & the FFT seek at the current seek & overlap lengths and
+    /// returns the cost of one of the N log2 N steps of the FFT seek relative to one
+    /// product of the full seek, see prepareFFTSeek
+    double measureFFTSeekCost();
+    int seekBestOverlapPositionHierarchical(const SAMPLETYPE *refPos);
     int seekBestOverlapPosition(const SAMPLETYPE *refPos);
 
     virtual void overlapStereo(SAMPLETYPE *output, const SAMPLETYPE *input) const;
@@ -121,12 +142,14 @@ protected:
     void overlap(SAMPLETYPE *output, const SAMPLETYPE *input, uint ovlPos) const;
 
     void calcSeqParameters();
-
-    /// Changes the tempo of the given sound samples.
-    /// Returns amount of samples returned in the "output" buffer.
-    /// The maximum amount of samples that can be returned at a time is set by
-    /// the 'set_returnBuffer_size' function.
-    void processSamples();
+    void prepareFFTSeek();
+    void prepareHierarchicalSeek();
+    void calcPrepareSizes(uint maxBlockSize, uint *pNumIn, uint *pNumOut) const;
+
+    /// Changes the tempo of the samples in the input buffer and appends the result
+    /// to 'dest', which is either the own output buffer or the input buffer of the
+    /// next stage.
+    void processSamples(VCSDKCoreFIFOSampleBuffer &dest);
     
 public:
     VCSDKCoreTDStretch();
@@ -142,10 +165,11 @@ public:
     static VCSDKCoreTDStretch *newInstance();
     
     /// Returns the output buffer object
-    VCSDKCoreFIFOSamplePipe *getOutput() { return &outputBuffer; };
+    VCSDKCoreFIFOSampleBuffer *getOutput() { return &outputBuffer; };
 
-    /// Returns the input buffer object
-    VCSDKCoreFIFOSamplePipe *getInput() { return &inputBuffer; };
+    /// Returns the input buffer object. Samples written directly to it are
+    /// processed by 'processInput'.
+    VCSDKCoreFIFOSampleBuffer *getInput() { return &inputBuffer; };
 
     /// Sets new target tempo. Normal tempo = 'SCALE', smaller values represent slower
     /// tempo, larger faster tempo.
@@ -167,6 +191,31 @@ public:
     /// Returns nonzero if the quick seeking algorithm is enabled.
     BOOL isQuickSeekEnabled() const;
 
+    /// Enables/disables computing the full overlap position search with FFT
+    /// cross-correlation. Gives the same search as the default full seek, and is
+    /// used only where it's the cheaper one: enabling it times both seeks once on
+    /// this instance, and the FFT seek is used for the seek & overlap lengths where
+    /// that measurement predicts it faster. Quick & coarse-to-fine seek, if enabled,
+    /// have precedence. Zero to disable, nonzero to enable
+    void enableFFTSeek(BOOL enable);
+
+    /// Returns nonzero if the FFT seeking algorithm is enabled.
+    BOOL isFFTSeekEnabled() const;
+
+    /// Returns nonzero if the overlap position is actually searched with FFT, i.e.
+    /// the FFT seek is enabled, no other seek has precedence, and it's the faster
+    /// one for the current parameters.
+    BOOL isFFTSeekInUse() const;
+
+    /// Enables/disables the coarse-to-fine position seeking algorithm: the seek
+    /// window is first scanned on decimated (~8 kHz) signals, then the best coarse
+    /// position is refined at full rate. Quick seek, if enabled, has precedence.
+    /// Zero to disable, nonzero to enable
+    void enableHierarchicalSeek(BOOL enable);
+
+    /// Returns nonzero if the coarse-to-fine seeking algorithm is enabled.
+    BOOL isHierarchicalSeekEnabled() const;
+
     /// Sets routine control parameters. These control are certain time constants
     /// defining how the sound is stretched to the desired duration.
     //
@@ -194,6 +243,14 @@ public:
                                                     ///< contains both channels if stereo
             );
 
+    /// Adds 'numsamples' pcs of samples into the input of the object like above, but
+    /// writes the result directly to the end of 'dest', e.g. the input buffer of the
+    /// next stage, instead of the output buffer.
+    void putSamples(const SAMPLETYPE *samples, uint numSamples, VCSDKCoreFIFOSampleBuffer &dest);
+
+    /// Processes the samples written directly to the input buffer, see 'getInput'.
+    void processInput();
+
     /// return nominal input sample requirement for triggering a processing batch
     int getInputSampleReq() const
     {
@@ -205,6 +262,36 @@ public:
     {
         return seekWindowLength - overlapLength;
     }
+
+    /// return the maximum amount of input samples held back between processing
+    /// batches
+    int getLatency() const
+    {
+        return sampleReq;
+    }
+
+    /// Sizes the buffers up front for input batches of up to 'maxBlockSize' samples
+    /// with the current parameters, so that processing them doesn't allocate.
+    /// Returns the maximum number of samples one such batch outputs.
+    uint prepare(uint maxBlockSize);
+
+    /// Returns nonzero if the buffers have room for processing an input batch of
+    /// 'maxBlockSize' samples without allocating, as after 'prepare'. Stores the
+    /// maximum number of samples the batch outputs to 'pNumOut'.
+    BOOL isPrepared(uint maxBlockSize, uint *pNumOut) const;
+
+#ifdef VCSDKCORE_ENABLE_STATS
+    /// Returns the seek & overlap timing and the FIFO high-water marks of this stage
+    const VCSDKCoreStats &getStats() const
+    {
+        return stats;
+    }
+
+    void resetStats()
+    {
+        stats.reset();
+    }
+#endif
 };
 
 
@@ -224,13 +311,29 @@ public:
 #endif /// SOUNDTOUCH_ALLOW_MMX
 
 
+#ifdef SOUNDTOUCH_ALLOW_AVX2
+    /// Class that implements AVX2 optimized routines for both sample types, with
+    /// FMA for floating point samples.
+    class TDStretchAVX2 : public VCSDKCoreTDStretch
+    {
+    protected:
+        double calcCrossCorr(const SAMPLETYPE *mixingPos, const SAMPLETYPE *compare, double &norm) const;
+        double calcCrossCorrAccumulate(const SAMPLETYPE *mixingPos, const SAMPLETYPE *compare, double &norm) const;
+        virtual void overlapMono(SAMPLETYPE *output, const SAMPLETYPE *input) const;
+        virtual void overlapStereo(SAMPLETYPE *output, const SAMPLETYPE *input) const;
+    };
+#endif /// SOUNDTOUCH_ALLOW_AVX2
+
+
 #ifdef SOUNDTOUCH_ALLOW_SSE
     /// Class that implements SSE optimized routines for floating point samples type.
-    class TDStretchSSE : public TDStretch
+    class TDStretchSSE : public VCSDKCoreTDStretch
     {
     protected:
         double calcCrossCorr(const float *mixingPos, const float *compare, double &norm) const;
         double calcCrossCorrAccumulate(const float *mixingPos, const float *compare, double &norm) const;
+        virtual void overlapMono(float *output, const float *input) const;
+        virtual void overlapStereo(float *output, const float *input) const;
     };
 
 #endif /// SOUNDTOUCH_ALLOW_SSE
@@ -11,6 +11,7 @@
 
 typedef unsigned int    uint;
 typedef unsigned long   ulong;
+typedef unsigned long long ulonglong;
 
 // Patch for MinGW: on Win64 long is 32-bit
 #ifdef _WIN64
@@ -27,7 +28,7 @@ typedef ulong ulongptr;
 #if (defined(__GNUC__) && !defined(ANDROID))
 // In GCC, include soundtouch_config.h made by config scritps.
 // Skip this in Android compilation that uses GCC but without configure scripts.
-#include "VCSDKCore_config.h"
+#include "vcsdkcore_config.h"
 
 #endif
 
@@ -134,6 +135,10 @@ namespace vcsdkcore
 #ifdef SOUNDTOUCH_ALLOW_X86_OPTIMIZATIONS
     // Allow MMX optimizations
 #define SOUNDTOUCH_ALLOW_MMX   1
+#if defined(__GNUC__) || (defined(_MSC_VER) && _MSC_VER >= 1700)
+    // Allow AVX2 optimizations, compiled per function so no build flags needed
+#define SOUNDTOUCH_ALLOW_AVX2  1
+#endif
 #endif
     
 #else
@@ -146,6 +151,10 @@ namespace vcsdkcore
 #ifdef SOUNDTOUCH_ALLOW_X86_OPTIMIZATIONS
     // Allow SSE optimizations
 #define SOUNDTOUCH_ALLOW_SSE       1
+#if defined(__GNUC__) || (defined(_MSC_VER) && _MSC_VER >= 1700)
+    // Allow AVX2 & FMA optimizations, compiled per function so no build flags needed
+#define SOUNDTOUCH_ALLOW_AVX2      1
+#endif
 #endif
     
 #endif  // SOUNDTOUCH_INTEGER_SAMPLES
@@ -170,6 +179,32 @@ namespace vcsdkcore
 // quality compromise.
 //#define SOUNDTOUCH_PREVENT_CLICK_AT_RATE_CROSSOVER   1
 
+// When this #define is active, the FIFO sample buffers are rings whose memory is
+// mapped twice back-to-back in virtual memory, so that the buffered samples stay
+// contiguous across the wrap-around without moving them. Uses memfd_create & mmap,
+// hence Linux only; the buffers fall back to the plain linear buffer if mapping
+// fails. Define VCSDKCORE_DISABLE_MIRRORED_FIFO to always use the linear buffer.
+//
+// Each mirrored buffer takes two memory mappings of the process, and a VCSDKCore
+// instance holds 5 buffers, i.e. 10 mappings (more with SETTING_PIPELINED_STAGES).
+// Linux limits the mappings per process (vm.max_map_count, default 65530), so at
+// most VCSDKCORE_MIRRORED_FIFO_MAX buffers are mirrored at a time; the ones beyond
+// that use the linear buffer. The default 8192 buffers take 16384 mappings, enough
+// for about 1600 concurrent instances. Define it when building the library to
+// change the limit.
+#if defined(__linux__) && !defined(ANDROID) && !defined(__ANDROID__) && !defined(VCSDKCORE_DISABLE_MIRRORED_FIFO)
+#define VCSDKCORE_MIRRORED_FIFO    1
+#ifndef VCSDKCORE_MIRRORED_FIFO_MAX
+#define VCSDKCORE_MIRRORED_FIFO_MAX    8192
+#endif
+#endif
+
+// When this #define is active, the processing stages accumulate per-stage timing,
+// sample counters and FIFO high-water marks readable with VCSDKCore::getStats().
+// Requires C++11 (std::chrono). Default is off, in which case the instrumentation
+// compiles to nothing.
+//#define VCSDKCORE_ENABLE_STATS   1
+
 
 
 
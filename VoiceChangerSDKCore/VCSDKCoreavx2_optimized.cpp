@@ -0,0 +1,677 @@
+////  VCSDKCoreavx2_optimized.cpp
+//  VoiceChanger
+//
+//  AVX2 optimized routines. For the 16bit integer sample type the routines give
+//  bit-exact same results as the plain C++ versions in VCSDKCoreTDStretch.cpp &
+//  VCSDKCoreFIRFilter.cpp; for the floating point sample type they use FMA and
+//  differ from the C++ & SSE versions only by rounding.
+//
+
+
+#include "VCSDKCoreType.h"
+
+
+#ifdef SOUNDTOUCH_ALLOW_AVX2
+
+using namespace vcsdkcore;
+
+#include "VCSDKCoreTDStretch.hpp"
+#include "VCSDKCoreFIRFilter.hpp"
+#include <immintrin.h>
+#include <assert.h>
+#include <math.h>
+
+
+// The rest of the library is built without AVX2 code generation, so enable it
+// per function. The routines get called only if the CPU supports AVX2 (& FMA
+// for the floating point ones).
+#if defined(__GNUC__) && !defined(__AVX2__)
+    #define AVX2_TARGET __attribute__((target("avx2")))
+#else
+    #define AVX2_TARGET
+#endif
+
+#if defined(__GNUC__) && !(defined(__AVX2__) && defined(__FMA__))
+    #define AVX2_FMA_TARGET __attribute__((target("avx2,fma")))
+#else
+    #define AVX2_FMA_TARGET
+#endif
+
+
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// implementation of AVX2 optimized functions of class 'TDStretchAVX2'
+//
+//////////////////////////////////////////////////////////////////////////////
+
+
+// Sums the 32bit lanes of 'v' into 64bit lanes of 'accu'
+AVX2_TARGET static inline __m256i _widenAdd(__m256i accu, __m256i v)
+{
+    accu = _mm256_add_epi64(accu, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+    return _mm256_add_epi64(accu, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+}
+
+
+// Returns sum of the 64bit lanes of 'v'
+AVX2_TARGET static inline long long _horizontalSum(__m256i v)
+{
+    long long sum[2];
+
+    _mm_storeu_si128((__m128i *)sum, _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+    return sum[0] + sum[1];
+}
+
+
+// Calculates cross correlation of two buffers
+AVX2_TARGET double TDStretchAVX2::calcCrossCorr(const short *pV1, const short *pV2, double &dnorm) const
+{
+    const __m128i shifter = _mm_cvtsi32_si128(overlapDividerBits);
+    __m256i corrSum, normSum;
+    int i, c;
+
+    corrSum = normSum = _mm256_setzero_si256();
+
+    // channels * overlapLength is a multiple of 16 because overlapLength is a
+    // power of 2 of at least 16. Sum one 'overlapLength' long block in 32bit
+    // lanes at a time: that much can't overflow even with full-scale samples,
+    // so the result is exactly the same as with the 'long' sums of the C++ routine.
+    for (c = 0; c < channels; c ++)
+    {
+        __m256i accu = _mm256_setzero_si256();
+        __m256i normaccu = _mm256_setzero_si256();
+
+        for (i = 0; i < overlapLength; i += 16)
+        {
+            __m256i v1 = _mm256_loadu_si256((const __m256i *)pV1);
+            __m256i v2 = _mm256_loadu_si256((const __m256i *)pV2);
+
+            // _mm256_madd_epi16 : 16*16bit multiply-add, resulting 8*32bit = [a0*b0+a1*b1 ; ...]
+            // the pairwise sums are shifted same way as in the C++ routine
+            accu = _mm256_add_epi32(accu, _mm256_sra_epi32(_mm256_madd_epi16(v1, v2), shifter));
+            normaccu = _mm256_add_epi32(normaccu, _mm256_sra_epi32(_mm256_madd_epi16(v1, v1), shifter));
+
+            pV1 += 16;
+            pV2 += 16;
+        }
+        corrSum = _widenAdd(corrSum, accu);
+        normSum = _widenAdd(normSum, normaccu);
+    }
+
+    // Normalize result by dividing by sqrt(norm) - this step is easiest
+    // done using floating point operation
+    dnorm = (double)_horizontalSum(normSum);
+    return (double)_horizontalSum(corrSum) / sqrt((dnorm < 1e-9) ? 1.0 : dnorm);
+}
+
+
+/// Update cross-correlation by accumulating "norm" coefficient by previously calculated value
+AVX2_TARGET double TDStretchAVX2::calcCrossCorrAccumulate(const short *pV1, const short *pV2, double &dnorm) const
+{
+    const __m128i shifter = _mm_cvtsi32_si128(overlapDividerBits);
+    const int length = channels * overlapLength;
+    __m256i corrSum;
+    long lnorm;
+    int i, c;
+
+    // cancel first normalizer tap from previous round
+    lnorm = 0;
+    for (i = 1; i <= channels; i ++)
+    {
+        lnorm -= (pV1[-i] * pV1[-i]) >> overlapDividerBits;
+    }
+
+    corrSum = _mm256_setzero_si256();
+    for (c = 0; c < length; c += overlapLength)
+    {
+        __m256i accu = _mm256_setzero_si256();
+
+        for (i = 0; i < overlapLength; i += 16)
+        {
+            __m256i v1 = _mm256_loadu_si256((const __m256i *)(pV1 + c + i));
+            __m256i v2 = _mm256_loadu_si256((const __m256i *)(pV2 + c + i));
+
+            accu = _mm256_add_epi32(accu, _mm256_sra_epi32(_mm256_madd_epi16(v1, v2), shifter));
+        }
+        corrSum = _widenAdd(corrSum, accu);
+    }
+
+    // update normalizer with last samples of this round
+    for (i = 1; i <= channels; i ++)
+    {
+        lnorm += (pV1[length - i] * pV1[length - i]) >> overlapDividerBits;
+    }
+    dnorm += (double)lnorm;
+
+    // Normalize result by dividing by sqrt(norm) - this step is easiest
+    // done using floating point operation
+    return (double)_horizontalSum(corrSum) / sqrt((dnorm < 1e-9) ? 1.0 : dnorm);
+}
+
+
+// Overlaps 'overlapLength' frames of 'channels' (1 or 2) interleaved channels.
+// Both the mono and stereo routines are the same but for the mixer values.
+AVX2_TARGET static inline void _overlapAVX2(short *output, const short *input, const short *midBuffer,
+                                            int overlapLength, int channels, int overlapDividerBits)
+{
+    __m256i mixLo, mixHi, adder, rounding;
+    const __m128i shifter = _mm_cvtsi32_si128(overlapDividerBits + 1);
+    short lo[16], hi[16];
+    int i;
+
+    // _mm256_unpacklo/hi_epi16 pair the samples within the 128bit halves, so
+    // mixLo has the mixer values of samples 0-3 & 8-11 and mixHi those of
+    // samples 4-7 & 12-15, as (midBuffer, input) weight pairs.
+    for (i = 0; i < 4; i ++)
+    {
+        int fLo1 = i / channels;
+        int fHi1 = (i + 4) / channels;
+        int fLo2 = (i + 8) / channels;
+        int fHi2 = (i + 12) / channels;
+
+        lo[2 * i]     = (short)(overlapLength - fLo1);
+        lo[2 * i + 1] = (short)fLo1;
+        lo[2 * i + 8] = (short)(overlapLength - fLo2);
+        lo[2 * i + 9] = (short)fLo2;
+        hi[2 * i]     = (short)(overlapLength - fHi1);
+        hi[2 * i + 1] = (short)fHi1;
+        hi[2 * i + 8] = (short)(overlapLength - fHi2);
+        hi[2 * i + 9] = (short)fHi2;
+    }
+    mixLo = _mm256_loadu_si256((const __m256i *)lo);
+    mixHi = _mm256_loadu_si256((const __m256i *)hi);
+
+    // one round advances 16 / channels frames
+    adder = _mm256_set1_epi32(((16 / channels) << 16) | (0xffff & -(16 / channels)));
+
+    // The C++ routine divides by 'overlapLength' which rounds towards zero;
+    // add 'overlapLength - 1' to negative values before the arithmetic shift
+    // to get the same result.
+    rounding = _mm256_set1_epi32(overlapLength - 1);
+
+    for (i = 0; i < channels * overlapLength; i += 16)
+    {
+        __m256i vMid = _mm256_loadu_si256((const __m256i *)(midBuffer + i));
+        __m256i vIn = _mm256_loadu_si256((const __m256i *)(input + i));
+        __m256i temp1, temp2;
+
+        temp1 = _mm256_madd_epi16(_mm256_unpacklo_epi16(vMid, vIn), mixLo);
+        temp2 = _mm256_madd_epi16(_mm256_unpackhi_epi16(vMid, vIn), mixHi);
+        temp1 = _mm256_add_epi32(temp1, _mm256_and_si256(_mm256_srai_epi32(temp1, 31), rounding));
+        temp2 = _mm256_add_epi32(temp2, _mm256_and_si256(_mm256_srai_epi32(temp2, 31), rounding));
+        temp1 = _mm256_sra_epi32(temp1, shifter);
+        temp2 = _mm256_sra_epi32(temp2, shifter);
+
+        // results are within 16bit range, so the saturation doesn't change them
+        _mm256_storeu_si256((__m256i *)(output + i), _mm256_packs_epi32(temp1, temp2));
+
+        mixLo = _mm256_add_epi16(mixLo, adder);
+        mixHi = _mm256_add_epi16(mixHi, adder);
+    }
+}
+
+
+// AVX2-optimized version of the function overlapMono
+AVX2_TARGET void TDStretchAVX2::overlapMono(short *output, const short *input) const
+{
+    _overlapAVX2(output, input, pMidBuffer, overlapLength, 1, overlapDividerBits);
+}
+
+
+// AVX2-optimized version of the function overlapStereo
+AVX2_TARGET void TDStretchAVX2::overlapStereo(short *output, const short *input) const
+{
+    _overlapAVX2(output, input, pMidBuffer, overlapLength, 2, overlapDividerBits);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// implementation of AVX2 optimized functions of class 'VCSDKCoreFIRFilterAVX2'
+//
+//////////////////////////////////////////////////////////////////////////////
+
+
+// Adds the upper 128bit half of 'v' to the lower one
+AVX2_TARGET static inline __m128i _foldHalves(__m256i v)
+{
+    return _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+}
+
+
+// Sums the 32bit lanes of each of 'a0'...'a3' into the respective lane of the result
+AVX2_TARGET static inline __m128i _sumLanes4(__m256i a0, __m256i a1, __m256i a2, __m256i a3)
+{
+    __m128i b0 = _foldHalves(a0), b1 = _foldHalves(a1), b2 = _foldHalves(a2), b3 = _foldHalves(a3);
+    __m128i s01 = _mm_add_epi32(_mm_unpacklo_epi32(b0, b1), _mm_unpackhi_epi32(b0, b1));
+    __m128i s23 = _mm_add_epi32(_mm_unpacklo_epi32(b2, b3), _mm_unpackhi_epi32(b2, b3));
+
+    return _mm_add_epi32(_mm_unpacklo_epi64(s01, s23), _mm_unpackhi_epi64(s01, s23));
+}
+
+
+// Accumulates taps i..i+15 of the mono sample at 'pSrc'
+AVX2_TARGET static inline __m256i _monoTaps(__m256i sum, const short *pSrc, __m256i coeffs)
+{
+    return _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_loadu_si256((const __m256i *)pSrc), coeffs));
+}
+
+
+// As above for the last 8 taps only, in the lower half
+AVX2_TARGET static inline __m256i _monoTaps8(__m256i sum, const short *pSrc, __m256i coeffs)
+{
+    const __m256i v = _mm256_inserti128_si256(_mm256_setzero_si256(), _mm_loadu_si128((const __m128i *)pSrc), 0);
+
+    return _mm256_add_epi32(sum, _mm256_madd_epi16(v, coeffs));
+}
+
+
+// Accumulates taps i..i+7 of the stereo sample at 'pSrc'. The coefficients are
+// interleaved with zeros, 'left' weighting only the left channel & 'right' the right.
+AVX2_TARGET static inline void _stereoTaps(const short *pSrc, __m256i left, __m256i right, __m256i &suml, __m256i &sumr)
+{
+    const __m256i v = _mm256_loadu_si256((const __m256i *)pSrc);
+
+    suml = _mm256_add_epi32(suml, _mm256_madd_epi16(v, left));
+    sumr = _mm256_add_epi32(sumr, _mm256_madd_epi16(v, right));
+}
+
+
+// AVX2-optimized version of the filter routine for mono sound. Eight output samples
+// are calculated per pass over the coefficients, 16 taps at a time.
+AVX2_TARGET uint VCSDKCoreFIRFilterAVX2::evaluateFilterMono(short *dest, const short *src, uint numSamples) const
+{
+    const __m128i shifter = _mm_cvtsi32_si128((int)resultDivFactor);
+    const uint end = numSamples - length;
+    const uint length16 = length & ~15u;
+    uint i, j;
+
+    assert(length != 0);
+    assert(((ulongptr)filterCoeffs) % 32 == 0);
+
+    for (j = 0; j + 8 <= end; j += 8)
+    {
+        const short *pSrc = src + j;
+        __m256i sum0, sum1, sum2, sum3, sum4, sum5, sum6, sum7;
+        __m128i result0, result1;
+
+        sum0 = sum1 = sum2 = sum3 = sum4 = sum5 = sum6 = sum7 = _mm256_setzero_si256();
+        for (i = 0; i < length16; i += 16)
+        {
+            const __m256i coeffs = _mm256_load_si256((const __m256i *)(filterCoeffs + i));
+
+            sum0 = _monoTaps(sum0, pSrc + i + 0, coeffs);
+            sum1 = _monoTaps(sum1, pSrc + i + 1, coeffs);
+            sum2 = _monoTaps(sum2, pSrc + i + 2, coeffs);
+            sum3 = _monoTaps(sum3, pSrc + i + 3, coeffs);
+            sum4 = _monoTaps(sum4, pSrc + i + 4, coeffs);
+            sum5 = _monoTaps(sum5, pSrc + i + 5, coeffs);
+            sum6 = _monoTaps(sum6, pSrc + i + 6, coeffs);
+            sum7 = _monoTaps(sum7, pSrc + i + 7, coeffs);
+        }
+        if (length16 < length)
+        {
+            // the last 8 taps in the lower halves, as the source mustn't be read beyond them
+            const __m256i coeffs = _mm256_inserti128_si256(_mm256_setzero_si256(),
+                                       _mm_load_si128((const __m128i *)(filterCoeffs + length16)), 0);
+
+            sum0 = _monoTaps8(sum0, pSrc + length16 + 0, coeffs);
+            sum1 = _monoTaps8(sum1, pSrc + length16 + 1, coeffs);
+            sum2 = _monoTaps8(sum2, pSrc + length16 + 2, coeffs);
+            sum3 = _monoTaps8(sum3, pSrc + length16 + 3, coeffs);
+            sum4 = _monoTaps8(sum4, pSrc + length16 + 4, coeffs);
+            sum5 = _monoTaps8(sum5, pSrc + length16 + 5, coeffs);
+            sum6 = _monoTaps8(sum6, pSrc + length16 + 6, coeffs);
+            sum7 = _monoTaps8(sum7, pSrc + length16 + 7, coeffs);
+        }
+
+        // sum >>= resultDivFactor & saturate to 16 bits
+        result0 = _mm_sra_epi32(_sumLanes4(sum0, sum1, sum2, sum3), shifter);
+        result1 = _mm_sra_epi32(_sumLanes4(sum4, sum5, sum6, sum7), shifter);
+        _mm_storeu_si128((__m128i *)(dest + j), _mm_packs_epi32(result0, result1));
+    }
+
+    // the last few samples with the SSE2 routine
+    if (j < end)
+    {
+        VCSDKCoreFIRFilterSSE2::evaluateFilterMono(dest + j, src + j, numSamples - j);
+    }
+    return end;
+}
+
+
+// AVX2-optimized version of the filter routine for stereo sound. Four stereo output
+// samples are calculated per pass over the coefficients, 8 taps at a time.
+AVX2_TARGET uint VCSDKCoreFIRFilterAVX2::evaluateFilterStereo(short *dest, const short *src, uint numSamples) const
+{
+    const __m128i shifter = _mm_cvtsi32_si128((int)resultDivFactor);
+    const uint end = numSamples - length;
+    uint i, j;
+
+    assert(length != 0);
+    assert(((ulongptr)filterCoeffs) % 16 == 0);
+
+    for (j = 0; j + 4 <= end; j += 4)
+    {
+        const short *pSrc = src + 2 * j;
+        __m256i suml0, sumr0, suml1, sumr1, suml2, sumr2, suml3, sumr3;
+        __m128i result0, result1;
+
+        suml0 = sumr0 = suml1 = sumr1 = suml2 = sumr2 = suml3 = sumr3 = _mm256_setzero_si256();
+        for (i = 0; i < length; i += 8)
+        {
+            // c0 0 c1 0 ... c7 0 & 0 c0 0 c1 ... 0 c7
+            const __m256i left = _mm256_cvtepu16_epi32(_mm_load_si128((const __m128i *)(filterCoeffs + i)));
+            const __m256i right = _mm256_slli_epi32(left, 16);
+
+            _stereoTaps(pSrc + 2 * i + 0, left, right, suml0, sumr0);
+            _stereoTaps(pSrc + 2 * i + 2, left, right, suml1, sumr1);
+            _stereoTaps(pSrc + 2 * i + 4, left, right, suml2, sumr2);
+            _stereoTaps(pSrc + 2 * i + 6, left, right, suml3, sumr3);
+        }
+
+        // sum >>= resultDivFactor & saturate to 16 bits, l0 r0 l1 r1 l2 r2 l3 r3
+        result0 = _mm_sra_epi32(_sumLanes4(suml0, sumr0, suml1, sumr1), shifter);
+        result1 = _mm_sra_epi32(_sumLanes4(suml2, sumr2, suml3, sumr3), shifter);
+        _mm_storeu_si128((__m128i *)(dest + 2 * j), _mm_packs_epi32(result0, result1));
+    }
+
+    // the last few samples with the plain C++ routine
+    if (j < end)
+    {
+        VCSDKCoreFIRFilter::evaluateFilterStereo(dest + 2 * j, src + 2 * j, numSamples - j);
+    }
+    return end;
+}
+
+
+#else   // floating point samples
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// implementation of AVX2 & FMA optimized functions of class 'TDStretchAVX2'
+//
+//////////////////////////////////////////////////////////////////////////////
+
+
+// Returns sum of the eight floats of 'v'
+AVX2_FMA_TARGET static inline float _horizontalSum(__m256 v)
+{
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(s);
+}
+
+
+// Calculates cross correlation of two buffers
+AVX2_FMA_TARGET double TDStretchAVX2::calcCrossCorr(const float *pV1, const float *pV2, double &norm) const
+{
+    const int length = channels * overlapLength;
+    __m256 vSum1, vSum2, vNorm1, vNorm2;
+    int i;
+
+    // ensure overlapLength is divisible by 8
+    assert((overlapLength % 8) == 0);
+
+    // Two sets of accumulators to shorten the dependency chains, the last 8
+    // samples of an odd number of vectors into the first
+    vSum1 = vSum2 = vNorm1 = vNorm2 = _mm256_setzero_ps();
+    for (i = 0; i + 16 <= length; i += 16)
+    {
+        const __m256 v1 = _mm256_loadu_ps(pV1 + i);
+        const __m256 v2 = _mm256_loadu_ps(pV1 + i + 8);
+
+        vSum1  = _mm256_fmadd_ps(v1, _mm256_loadu_ps(pV2 + i), vSum1);
+        vNorm1 = _mm256_fmadd_ps(v1, v1, vNorm1);
+        vSum2  = _mm256_fmadd_ps(v2, _mm256_loadu_ps(pV2 + i + 8), vSum2);
+        vNorm2 = _mm256_fmadd_ps(v2, v2, vNorm2);
+    }
+    if (i < length)
+    {
+        const __m256 v1 = _mm256_loadu_ps(pV1 + i);
+
+        vSum1  = _mm256_fmadd_ps(v1, _mm256_loadu_ps(pV2 + i), vSum1);
+        vNorm1 = _mm256_fmadd_ps(v1, v1, vNorm1);
+    }
+
+    norm = (double)_horizontalSum(_mm256_add_ps(vNorm1, vNorm2));
+    return (double)_horizontalSum(_mm256_add_ps(vSum1, vSum2)) / sqrt(norm < 1e-9 ? 1.0 : norm);
+}
+
+
+/// Update cross-correlation by accumulating "norm" coefficient by previously calculated value
+AVX2_FMA_TARGET double TDStretchAVX2::calcCrossCorrAccumulate(const float *pV1, const float *pV2, double &norm) const
+{
+    const int length = channels * overlapLength;
+    __m256 vSum1, vSum2;
+    int i;
+
+    // cancel first normalizer tap from previous round
+    for (i = 1; i <= channels; i ++)
+    {
+        norm -= pV1[-i] * pV1[-i];
+    }
+
+    vSum1 = vSum2 = _mm256_setzero_ps();
+    for (i = 0; i + 16 <= length; i += 16)
+    {
+        vSum1 = _mm256_fmadd_ps(_mm256_loadu_ps(pV1 + i), _mm256_loadu_ps(pV2 + i), vSum1);
+        vSum2 = _mm256_fmadd_ps(_mm256_loadu_ps(pV1 + i + 8), _mm256_loadu_ps(pV2 + i + 8), vSum2);
+    }
+    if (i < length)
+    {
+        vSum1 = _mm256_fmadd_ps(_mm256_loadu_ps(pV1 + i), _mm256_loadu_ps(pV2 + i), vSum1);
+    }
+
+    // update normalizer with last samples of this round
+    for (i = 1; i <= channels; i ++)
+    {
+        norm += pV1[length - i] * pV1[length - i];
+    }
+
+    return (double)_horizontalSum(_mm256_add_ps(vSum1, vSum2)) / sqrt(norm < 1e-9 ? 1.0 : norm);
+}
+
+
+// Overlaps 'length' interleaved samples, the mixing weight of the input advancing
+// by 'vStep' per 8 samples from 'vPos'
+AVX2_FMA_TARGET static inline void _overlapAVX2(float *pOutput, const float *pInput, const float *pMidBuffer,
+                                                int length, int overlapLength, __m256 vPos, __m256 vStep)
+{
+    const __m256 vScale = _mm256_set1_ps(1.0f / (float)overlapLength);
+    int i;
+
+    for (i = 0; i < length; i += 8)
+    {
+        const __m256 vMid = _mm256_loadu_ps(pMidBuffer + i);
+
+        // output = mid + (input - mid) * f1
+        _mm256_storeu_ps(pOutput + i, _mm256_fmadd_ps(_mm256_sub_ps(_mm256_loadu_ps(pInput + i), vMid),
+                                                      _mm256_mul_ps(vPos, vScale), vMid));
+        vPos = _mm256_add_ps(vPos, vStep);
+    }
+}
+
+
+// AVX2-optimized version of the function overlapMono
+AVX2_FMA_TARGET void TDStretchAVX2::overlapMono(float *pOutput, const float *pInput) const
+{
+    // mixing weight of input sample 'i' is i / overlapLength, that of the
+    // mid buffer 1 - i / overlapLength
+    _overlapAVX2(pOutput, pInput, pMidBuffer, overlapLength, overlapLength,
+                 _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f), _mm256_set1_ps(8.0f));
+}
+
+
+// AVX2-optimized version of the function overlapStereo
+AVX2_FMA_TARGET void TDStretchAVX2::overlapStereo(float *pOutput, const float *pInput) const
+{
+    // four stereo samples per round, both channels with the same weight
+    _overlapAVX2(pOutput, pInput, pMidBuffer, 2 * overlapLength, overlapLength,
+                 _mm256_setr_ps(0.0f, 0.0f, 1.0f, 1.0f, 2.0f, 2.0f, 3.0f, 3.0f), _mm256_set1_ps(4.0f));
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// implementation of AVX2 & FMA optimized functions of class 'VCSDKCoreFIRFilterAVX2'
+//
+//////////////////////////////////////////////////////////////////////////////
+
+
+// Adds the eight lanes of each of 'a0'...'a7' together into the respective
+// lane of the result
+AVX2_FMA_TARGET static inline __m256 _sumLanes8(__m256 a0, __m256 a1, __m256 a2, __m256 a3,
+                                                __m256 a4, __m256 a5, __m256 a6, __m256 a7)
+{
+    // lanes 0-3 of 'lo' hold the partial sums of a0...a3 from their lower halves,
+    // lanes 4-7 those from the upper halves; same for a4...a7 in 'hi'
+    const __m256 lo = _mm256_hadd_ps(_mm256_hadd_ps(a0, a1), _mm256_hadd_ps(a2, a3));
+    const __m256 hi = _mm256_hadd_ps(_mm256_hadd_ps(a4, a5), _mm256_hadd_ps(a6, a7));
+
+    return _mm256_add_ps(_mm256_permute2f128_ps(lo, hi, 0x20), _mm256_permute2f128_ps(lo, hi, 0x31));
+}
+
+
+// Adds the eight lanes of 'a' together in the same order as _sumLanes8
+AVX2_FMA_TARGET static inline float _sumLanes(__m256 a)
+{
+    a = _mm256_hadd_ps(a, a);
+    a = _mm256_hadd_ps(a, a);
+    return _mm_cvtss_f32(_mm_add_ss(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1)));
+}
+
+
+// Adds the four left & right partial sums of each of the stereo samples 's0'...'s3'
+// together, stores the resulting four stereo samples to 'dest'
+AVX2_FMA_TARGET static inline void _storeStereo(float *dest, __m256 s0, __m256 s1, __m256 s2, __m256 s3)
+{
+    // l0 r0 l1 r1 of the lower & upper halves, as _storeStereo of the SSE routines
+    const __m256 s01 = _mm256_add_ps(_mm256_shuffle_ps(s0, s1, _MM_SHUFFLE(1,0,3,2)),
+                                     _mm256_shuffle_ps(s0, s1, _MM_SHUFFLE(3,2,1,0)));
+    const __m256 s23 = _mm256_add_ps(_mm256_shuffle_ps(s2, s3, _MM_SHUFFLE(1,0,3,2)),
+                                     _mm256_shuffle_ps(s2, s3, _MM_SHUFFLE(3,2,1,0)));
+
+    _mm256_storeu_ps(dest, _mm256_add_ps(_mm256_permute2f128_ps(s01, s23, 0x20),
+                                         _mm256_permute2f128_ps(s01, s23, 0x31)));
+}
+
+
+// AVX2-optimized version of the filter routine for mono sound. Eight output samples
+// are calculated per pass over the coefficients, 8 taps at a time; each of them is
+// summed up in the same order as when calculating one at a time, so the results
+// don't depend on how the input is split to batches.
+AVX2_FMA_TARGET uint VCSDKCoreFIRFilterAVX2::evaluateFilterMono(float *dest, const float *source, uint numSamples) const
+{
+    const uint end = numSamples - length;
+    uint i, j;
+
+    assert(source != NULL);
+    assert(dest != NULL);
+    assert((length % 8) == 0);
+    assert(filterCoeffsMonoAlign != NULL);
+    assert(((ulongptr)filterCoeffsMonoAlign) % 32 == 0);
+
+    for (j = 0; j + 8 <= end; j += 8)
+    {
+        const float *pSrc = source + j;
+        __m256 sum0, sum1, sum2, sum3, sum4, sum5, sum6, sum7;
+
+        sum0 = sum1 = sum2 = sum3 = sum4 = sum5 = sum6 = sum7 = _mm256_setzero_ps();
+        for (i = 0; i < length; i += 8)
+        {
+            const __m256 fil = _mm256_load_ps(filterCoeffsMonoAlign + i);
+
+            sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(pSrc + i + 0), fil, sum0);
+            sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(pSrc + i + 1), fil, sum1);
+            sum2 = _mm256_fmadd_ps(_mm256_loadu_ps(pSrc + i + 2), fil, sum2);
+            sum3 = _mm256_fmadd_ps(_mm256_loadu_ps(pSrc + i + 3), fil, sum3);
+            sum4 = _mm256_fmadd_ps(_mm256_loadu_ps(pSrc + i + 4), fil, sum4);
+            sum5 = _mm256_fmadd_ps(_mm256_loadu_ps(pSrc + i + 5), fil, sum5);
+            sum6 = _mm256_fmadd_ps(_mm256_loadu_ps(pSrc + i + 6), fil, sum6);
+            sum7 = _mm256_fmadd_ps(_mm256_loadu_ps(pSrc + i + 7), fil, sum7);
+        }
+        _mm256_storeu_ps(dest + j, _sumLanes8(sum0, sum1, sum2, sum3, sum4, sum5, sum6, sum7));
+    }
+
+    // the last few samples one at a time
+    for (; j < end; j ++)
+    {
+        const float *pSrc = source + j;
+        __m256 sum = _mm256_setzero_ps();
+
+        for (i = 0; i < length; i += 8)
+        {
+            sum = _mm256_fmadd_ps(_mm256_loadu_ps(pSrc + i), _mm256_load_ps(filterCoeffsMonoAlign + i), sum);
+        }
+        dest[j] = _sumLanes(sum);
+    }
+    return end;
+}
+
+
+// AVX2-optimized version of the filter routine for stereo sound. Four stereo output
+// samples are calculated per pass over the coefficients, 4 taps at a time; each of
+// them is summed up in the same order as when calculating two at a time.
+AVX2_FMA_TARGET uint VCSDKCoreFIRFilterAVX2::evaluateFilterStereo(float *dest, const float *source, uint numSamples) const
+{
+    int count = (int)((numSamples - length) & (uint)-2);
+    int j;
+
+    if (count < 2) return 0;
+
+    assert(source != NULL);
+    assert(dest != NULL);
+    assert((length % 8) == 0);
+    assert(filterCoeffsAlign != NULL);
+    assert(((ulongptr)filterCoeffsAlign) % 32 == 0);
+
+    for (j = 0; j + 4 <= count; j += 4)
+    {
+        const float *pSrc = source + 2 * j;
+        __m256 sum0, sum1, sum2, sum3;
+        uint i;
+
+        // the coefficients are duplicated for the left & right channels
+        sum0 = sum1 = sum2 = sum3 = _mm256_setzero_ps();
+        for (i = 0; i < 2 * length; i += 8)
+        {
+            const __m256 fil = _mm256_load_ps(filterCoeffsAlign + i);
+
+            sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(pSrc + i + 0), fil, sum0);
+            sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(pSrc + i + 2), fil, sum1);
+            sum2 = _mm256_fmadd_ps(_mm256_loadu_ps(pSrc + i + 4), fil, sum2);
+            sum3 = _mm256_fmadd_ps(_mm256_loadu_ps(pSrc + i + 6), fil, sum3);
+        }
+        _storeStereo(dest + 2 * j, sum0, sum1, sum2, sum3);
+    }
+
+    // the last two stereo samples, if any, added together as in _storeStereo
+    if (j < count)
+    {
+        const float *pSrc = source + 2 * j;
+        __m256 sum0, sum1, sum01;
+        uint i;
+
+        sum0 = sum1 = _mm256_setzero_ps();
+        for (i = 0; i < 2 * length; i += 8)
+        {
+            const __m256 fil = _mm256_load_ps(filterCoeffsAlign + i);
+
+            sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(pSrc + i + 0), fil, sum0);
+            sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(pSrc + i + 2), fil, sum1);
+        }
+        sum01 = _mm256_add_ps(_mm256_shuffle_ps(sum0, sum1, _MM_SHUFFLE(1,0,3,2)),
+                              _mm256_shuffle_ps(sum0, sum1, _MM_SHUFFLE(3,2,1,0)));
+        _mm_storeu_ps(dest + 2 * j, _mm_add_ps(_mm256_castps256_ps128(sum01), _mm256_extractf128_ps(sum01, 1)));
+    }
+    return (uint)count;
+}
+
+#endif  // SOUNDTOUCH_INTEGER_SAMPLES
+
+#endif  // SOUNDTOUCH_ALLOW_AVX2
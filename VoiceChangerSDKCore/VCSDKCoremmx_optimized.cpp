@@ -247,39 +247,40 @@ void TDStretchMMX::overlapStereo(short *output, const short *input) const
 
 VCSDKCoreFIRFilterMMX::VCSDKCoreFIRFilterMMX() : VCSDKCoreFIRFilter()
 {
-    filterCoeffsUnalign = NULL;
+    filterCoeffsAlign = NULL;
 }
 
 
 VCSDKCoreFIRFilterMMX::~VCSDKCoreFIRFilterMMX()
 {
-    delete[] filterCoeffsUnalign;
 }
 
 
-// (overloaded) Calculates filter coefficients for MMX routine
-void VCSDKCoreFIRFilterMMX::setCoefficients(const short *coeffs, uint newLength, uint uResultDivFactor)
+// (overloaded) Takes the coefficients arranged for the MMX routine
+void VCSDKCoreFIRFilterMMX::shareCoefficients(const VCSDKCoreFIRCoeffsPtr &coeffs)
 {
-    uint i;
-    VCSDKCoreFIRFilter::setCoefficients(coeffs, newLength, uResultDivFactor);
+    VCSDKCoreFIRFilter::shareCoefficients(coeffs);
+    filterCoeffsAlign = coeffs->coeffsMMX;
+}
+
 
-    // Ensure that filter coeffs array is aligned to 16-byte boundary
-    delete[] filterCoeffsUnalign;
-    filterCoeffsUnalign = new short[2 * newLength + 8];
-    filterCoeffsAlign = (short *)SOUNDTOUCH_ALIGN_POINTER_16(filterCoeffsUnalign);
+// Rearranges the filter coefficients for the MMX routine. The shared coefficient
+// arrays are aligned to VCSDKCORE_ALIGNMENT boundary.
+void VCSDKCoreFIRFilterMMX::arrangeCoefficients(short *dest, const short *coeffs, uint length)
+{
+    uint i;
 
-    // rearrange the filter coefficients for mmx routines
     for (i = 0;i < length; i += 4)
     {
-        filterCoeffsAlign[2 * i + 0] = coeffs[i + 0];
-        filterCoeffsAlign[2 * i + 1] = coeffs[i + 2];
-        filterCoeffsAlign[2 * i + 2] = coeffs[i + 0];
-        filterCoeffsAlign[2 * i + 3] = coeffs[i + 2];
-
-        filterCoeffsAlign[2 * i + 4] = coeffs[i + 1];
-        filterCoeffsAlign[2 * i + 5] = coeffs[i + 3];
-        filterCoeffsAlign[2 * i + 6] = coeffs[i + 1];
-        filterCoeffsAlign[2 * i + 7] = coeffs[i + 3];
+        dest[2 * i + 0] = coeffs[i + 0];
+        dest[2 * i + 1] = coeffs[i + 2];
+        dest[2 * i + 2] = coeffs[i + 0];
+        dest[2 * i + 3] = coeffs[i + 2];
+
+        dest[2 * i + 4] = coeffs[i + 1];
+        dest[2 * i + 5] = coeffs[i + 3];
+        dest[2 * i + 6] = coeffs[i + 1];
+        dest[2 * i + 7] = coeffs[i + 3];
     }
 }
 
@@ -341,6 +342,433 @@ uint VCSDKCoreFIRFilterMMX::evaluateFilterStereo(short *dest, const short *src,
     return (numSamples & 0xfffffffe) - length;
 }
 
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// implementation of SSE2 optimized functions of class 'VCSDKCoreFIRFilterSSE2'
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include <emmintrin.h>
+#include <assert.h>
+
+// SSE2 isn't necessarily enabled for 32bit x86 builds, so enable it per function.
+// The routines get called only if the CPU supports SSE2.
+#if defined(__GNUC__) && !defined(__SSE2__)
+    #define SSE2_TARGET __attribute__((target("sse2")))
+#else
+    #define SSE2_TARGET
+#endif
+
+
+// Sums the 32bit lanes of each of 'a0'...'a3' into the respective lane of the result
+SSE2_TARGET static inline __m128i _sumLanes4(__m128i a0, __m128i a1, __m128i a2, __m128i a3)
+{
+    __m128i s01 = _mm_add_epi32(_mm_unpacklo_epi32(a0, a1), _mm_unpackhi_epi32(a0, a1));
+    __m128i s23 = _mm_add_epi32(_mm_unpacklo_epi32(a2, a3), _mm_unpackhi_epi32(a2, a3));
+
+    return _mm_add_epi32(_mm_unpacklo_epi64(s01, s23), _mm_unpackhi_epi64(s01, s23));
+}
+
+
+// Accumulates taps i..i+7 of a stereo sample at 'pSrc'. The coefficients are
+// interleaved with zeros, 'left' weighting only the left channel & 'right' the right.
+SSE2_TARGET static inline void _stereoTaps(const short *pSrc, __m128i left0, __m128i left1,
+                                           __m128i right0, __m128i right1, __m128i &suml, __m128i &sumr)
+{
+    const __m128i v0 = _mm_loadu_si128((const __m128i *)pSrc);         // taps i..i+3
+    const __m128i v1 = _mm_loadu_si128((const __m128i *)(pSrc + 8));   // taps i+4..i+7
+
+    suml = _mm_add_epi32(suml, _mm_add_epi32(_mm_madd_epi16(v0, left0), _mm_madd_epi16(v1, left1)));
+    sumr = _mm_add_epi32(sumr, _mm_add_epi32(_mm_madd_epi16(v0, right0), _mm_madd_epi16(v1, right1)));
+}
+
+
+// SSE2-optimized version of the filter routine for mono sound. Four output samples
+// are calculated per pass over the coefficients.
+SSE2_TARGET uint VCSDKCoreFIRFilterSSE2::evaluateFilterMono(short *dest, const short *src, uint numSamples) const
+{
+    const __m128i shifter = _mm_cvtsi32_si128((int)resultDivFactor);
+    const uint end = numSamples - length;
+    uint i, j;
+
+    assert(length != 0);
+    assert(((ulongptr)filterCoeffs) % 16 == 0);
+
+    for (j = 0; j + 4 <= end; j += 4)
+    {
+        const short *pSrc = src + j;
+        __m128i sum0, sum1, sum2, sum3, result;
+
+        sum0 = sum1 = sum2 = sum3 = _mm_setzero_si128();
+        for (i = 0; i < length; i += 8)
+        {
+            const __m128i coeffs = _mm_load_si128((const __m128i *)(filterCoeffs + i));
+
+            sum0 = _mm_add_epi32(sum0, _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(pSrc + i)), coeffs));
+            sum1 = _mm_add_epi32(sum1, _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(pSrc + i + 1)), coeffs));
+            sum2 = _mm_add_epi32(sum2, _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(pSrc + i + 2)), coeffs));
+            sum3 = _mm_add_epi32(sum3, _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(pSrc + i + 3)), coeffs));
+        }
+
+        // sum >>= resultDivFactor & saturate to 16 bits
+        result = _mm_sra_epi32(_sumLanes4(sum0, sum1, sum2, sum3), shifter);
+        _mm_storel_epi64((__m128i *)(dest + j), _mm_packs_epi32(result, result));
+    }
+
+    // the last few samples with the plain C++ routine
+    if (j < end)
+    {
+        VCSDKCoreFIRFilter::evaluateFilterMono(dest + j, src + j, numSamples - j);
+    }
+    return end;
+}
+
+
+// SSE2-optimized version of the filter routine for stereo sound. Four stereo output
+// samples are calculated per pass over the coefficients.
+SSE2_TARGET uint VCSDKCoreFIRFilterSSE2::evaluateFilterStereo(short *dest, const short *src, uint numSamples) const
+{
+    const __m128i shifter = _mm_cvtsi32_si128((int)resultDivFactor);
+    const __m128i zero = _mm_setzero_si128();
+    const uint end = numSamples - length;
+    uint i, j;
+
+    assert(length != 0);
+    assert(((ulongptr)filterCoeffs) % 16 == 0);
+
+    for (j = 0; j + 4 <= end; j += 4)
+    {
+        const short *pSrc = src + 2 * j;
+        __m128i suml0, sumr0, suml1, sumr1, suml2, sumr2, suml3, sumr3, result0, result1;
+
+        suml0 = sumr0 = suml1 = sumr1 = suml2 = sumr2 = suml3 = sumr3 = _mm_setzero_si128();
+        for (i = 0; i < length; i += 8)
+        {
+            const __m128i coeffs = _mm_load_si128((const __m128i *)(filterCoeffs + i));
+            const __m128i left0 = _mm_unpacklo_epi16(coeffs, zero);    // c0 0 c1 0 c2 0 c3 0
+            const __m128i left1 = _mm_unpackhi_epi16(coeffs, zero);    // c4 0 c5 0 c6 0 c7 0
+            const __m128i right0 = _mm_slli_epi32(left0, 16);          // 0 c0 0 c1 0 c2 0 c3
+            const __m128i right1 = _mm_slli_epi32(left1, 16);          // 0 c4 0 c5 0 c6 0 c7
+
+            _stereoTaps(pSrc + 2 * i + 0, left0, left1, right0, right1, suml0, sumr0);
+            _stereoTaps(pSrc + 2 * i + 2, left0, left1, right0, right1, suml1, sumr1);
+            _stereoTaps(pSrc + 2 * i + 4, left0, left1, right0, right1, suml2, sumr2);
+            _stereoTaps(pSrc + 2 * i + 6, left0, left1, right0, right1, suml3, sumr3);
+        }
+
+        // sum >>= resultDivFactor & saturate to 16 bits, l0 r0 l1 r1 l2 r2 l3 r3
+        result0 = _mm_sra_epi32(_sumLanes4(suml0, sumr0, suml1, sumr1), shifter);
+        result1 = _mm_sra_epi32(_sumLanes4(suml2, sumr2, suml3, sumr3), shifter);
+        _mm_storeu_si128((__m128i *)(dest + 2 * j), _mm_packs_epi32(result0, result1));
+    }
+
+    // the last few samples with the plain C++ routine
+    if (j < end)
+    {
+        VCSDKCoreFIRFilter::evaluateFilterStereo(dest + 2 * j, src + 2 * j, numSamples - j);
+    }
+    return end;
+}
+
+
+
+// Multiplies two successive taps of 4 channels at 'ptr' by the coefficient pair
+// c_k c_k+1 repeated in 'coeffPair', returns the 4 channel sums
+SSE2_TARGET static inline __m128i _multiTapPair(const short *ptr, uint numChannels, __m128i coeffPair)
+{
+    // a_k a_k+1 b_k b_k+1 c_k c_k+1 d_k d_k+1
+    const __m128i pair = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)ptr),
+                                            _mm_loadl_epi64((const __m128i *)(ptr + numChannels)));
+
+    return _mm_madd_epi16(pair, coeffPair);
+}
+
+
+// SSE2-optimized version of the filter routine for more than 2 channels. The channels
+// are filtered 4 at a time, two taps per multiply-add; with a channel count that isn't
+// divisible by 4, the last group overlaps the previous one.
+SSE2_TARGET uint VCSDKCoreFIRFilterSSE2::evaluateFilterMulti(short *dest, const short *src, uint numSamples, uint numChannels) const
+{
+    const __m128i shifter = _mm_cvtsi32_si128((int)resultDivFactor);
+    const uint end = numSamples - length;
+    uint i, j, c;
+
+    assert(length != 0);
+    assert(((ulongptr)filterCoeffs) % 16 == 0);
+
+    if (numChannels < 4)
+    {
+        return VCSDKCoreFIRFilter::evaluateFilterMulti(dest, src, numSamples, numChannels);
+    }
+
+    for (j = 0; j < end; j ++)
+    {
+        for (c = 0; c < numChannels; c += 4)
+        {
+            const uint first = (c + 4 <= numChannels) ? c : numChannels - 4;
+            const short *ptr = src + j * numChannels + first;
+            __m128i sum = _mm_setzero_si128();
+
+            for (i = 0; i < length; i += 8)
+            {
+                const __m128i coeffs = _mm_load_si128((const __m128i *)(filterCoeffs + i));
+
+                sum = _mm_add_epi32(sum, _multiTapPair(ptr, numChannels, _mm_shuffle_epi32(coeffs, _MM_SHUFFLE(0, 0, 0, 0))));
+                sum = _mm_add_epi32(sum, _multiTapPair(ptr + 2 * numChannels, numChannels, _mm_shuffle_epi32(coeffs, _MM_SHUFFLE(1, 1, 1, 1))));
+                sum = _mm_add_epi32(sum, _multiTapPair(ptr + 4 * numChannels, numChannels, _mm_shuffle_epi32(coeffs, _MM_SHUFFLE(2, 2, 2, 2))));
+                sum = _mm_add_epi32(sum, _multiTapPair(ptr + 6 * numChannels, numChannels, _mm_shuffle_epi32(coeffs, _MM_SHUFFLE(3, 3, 3, 3))));
+                ptr += 8 * numChannels;
+            }
+
+            // sum >>= resultDivFactor & saturate to 16 bits
+            sum = _mm_sra_epi32(sum, shifter);
+            _mm_storel_epi64((__m128i *)(dest + j * numChannels + first), _mm_packs_epi32(sum, sum));
+        }
+    }
+    return end;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// implementation of SSE2 optimized functions of class 'InterpolatePolyphaseSSE2'
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "VCSDKCoreInterpolatePolyphase.hpp"
+
+// Returns the interpolated kernel coefficients for the current 'fract' of 'kernel'
+// as 16bit integers scaled by 2^15, taps 0..7. The float coefficients are the same
+// as in calcCoeffs; the unity tap of phase 0 saturates to 32767. The table rows
+// are aligned.
+SSE2_TARGET static inline __m128i _polyphaseCoeffs16(const float *kernel, int numPhases, float fract)
+{
+    const float pos = fract * (float)numPhases;
+    const int phase = (int)pos;
+    const __m128 t = _mm_set1_ps(pos - (float)phase);
+    const __m128 scale = _mm_set1_ps(32768.0f);
+    const float *row = kernel + phase * 2 * POLYPHASE_TAPS;
+    __m128 c0, c1;
+
+    c0 = _mm_add_ps(_mm_load_ps(row), _mm_mul_ps(t, _mm_load_ps(row + 8)));
+    c1 = _mm_add_ps(_mm_load_ps(row + 4), _mm_mul_ps(t, _mm_load_ps(row + 12)));
+    return _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(c0, scale)), _mm_cvtps_epi32(_mm_mul_ps(c1, scale)));
+}
+
+
+// Rounds 32bit sums scaled by 2^15 to samples, saturated to 16 bits. The sum of
+// the absolute coefficients is below 2, so the sums fit in 32 bits.
+SSE2_TARGET static inline __m128i _polyphaseResult(__m128i sum)
+{
+    sum = _mm_srai_epi32(_mm_add_epi32(sum, _mm_set1_epi32(1 << 14)), 15);
+    return _mm_packs_epi32(sum, sum);
+}
+
+
+// SSE2-optimized polyphase interpolation for mono sound: the 8 taps are one
+// multiply-add
+SSE2_TARGET int InterpolatePolyphaseSSE2::transposeMono(short *pdest, const short *psrc, int &srcSamples)
+{
+    int i = 0;
+    int srcSampleEnd = srcSamples - POLYPHASE_TAPS;
+    int srcCount = 0;
+
+    while (srcCount < srcSampleEnd)
+    {
+        __m128i sum;
+
+        assert(fract < 1.0);
+        sum = _mm_madd_epi16(_mm_loadu_si128((const __m128i *)psrc), _polyphaseCoeffs16(pKernel, numPhases, fract));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+        pdest[i] = (short)_mm_cvtsi128_si32(_polyphaseResult(sum));
+        i ++;
+
+        int whole = advance();
+        psrc += whole;
+        srcCount += whole;
+    }
+    srcSamples = srcCount;
+    return i;
+}
+
+
+// SSE2-optimized polyphase interpolation for stereo sound. The coefficients are
+// interleaved with zeros as in VCSDKCoreFIRFilterSSE2::evaluateFilterStereo.
+SSE2_TARGET int InterpolatePolyphaseSSE2::transposeStereo(short *pdest, const short *psrc, int &srcSamples)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    int srcSampleEnd = srcSamples - POLYPHASE_TAPS;
+    int srcCount = 0;
+
+    while (srcCount < srcSampleEnd)
+    {
+        const __m128i coeffs = _polyphaseCoeffs16(pKernel, numPhases, fract);
+        const __m128i left0 = _mm_unpacklo_epi16(coeffs, zero);    // c0 0 c1 0 c2 0 c3 0
+        const __m128i left1 = _mm_unpackhi_epi16(coeffs, zero);    // c4 0 c5 0 c6 0 c7 0
+        __m128i suml = zero;
+        __m128i sumr = zero;
+
+        assert(fract < 1.0);
+        _stereoTaps(psrc, left0, left1, _mm_slli_epi32(left0, 16), _mm_slli_epi32(left1, 16), suml, sumr);
+
+        // l r in the low 32 bits
+        *(int *)(pdest + 2 * i) = _mm_cvtsi128_si32(_polyphaseResult(_sumLanes4(suml, sumr, zero, zero)));
+        i ++;
+
+        int whole = advance();
+        psrc += 2 * whole;
+        srcCount += whole;
+    }
+    srcSamples = srcCount;
+    return i;
+}
+
+
+// SSE2-optimized polyphase interpolation for more than 2 channels. The channels are
+// interpolated 4 at a time as in VCSDKCoreFIRFilterSSE2::evaluateFilterMulti.
+SSE2_TARGET int InterpolatePolyphaseSSE2::transposeMulti(short *pdest, const short *psrc, int &srcSamples)
+{
+    const uint channels = (uint)numChannels;
+    int i = 0;
+    int srcSampleEnd = srcSamples - POLYPHASE_TAPS;
+    int srcCount = 0;
+
+    if (numChannels < 4)
+    {
+        return VCSDKCoreInterpolatePolyphase::transposeMulti(pdest, psrc, srcSamples);
+    }
+
+    while (srcCount < srcSampleEnd)
+    {
+        const __m128i coeffs = _polyphaseCoeffs16(pKernel, numPhases, fract);
+        const __m128i pair0 = _mm_shuffle_epi32(coeffs, _MM_SHUFFLE(0, 0, 0, 0));
+        const __m128i pair1 = _mm_shuffle_epi32(coeffs, _MM_SHUFFLE(1, 1, 1, 1));
+        const __m128i pair2 = _mm_shuffle_epi32(coeffs, _MM_SHUFFLE(2, 2, 2, 2));
+        const __m128i pair3 = _mm_shuffle_epi32(coeffs, _MM_SHUFFLE(3, 3, 3, 3));
+
+        assert(fract < 1.0);
+        for (uint c = 0; c < channels; c += 4)
+        {
+            const uint first = (c + 4 <= channels) ? c : channels - 4;
+            const short *ptr = psrc + first;
+            __m128i sum;
+
+            sum = _multiTapPair(ptr, channels, pair0);
+            sum = _mm_add_epi32(sum, _multiTapPair(ptr + 2 * channels, channels, pair1));
+            sum = _mm_add_epi32(sum, _multiTapPair(ptr + 4 * channels, channels, pair2));
+            sum = _mm_add_epi32(sum, _multiTapPair(ptr + 6 * channels, channels, pair3));
+            _mm_storel_epi64((__m128i *)(pdest + first), _polyphaseResult(sum));
+        }
+        pdest += channels;
+        i ++;
+
+        int whole = advance();
+        psrc += channels * whole;
+        srcCount += whole;
+    }
+    srcSamples = srcCount;
+    return i;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// implementation of MMX optimized functions of class 'VCSDKCoreAAResamplerMMX'
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "VCSDKCoreAAResampler.hpp"
+
+// Scales a 32bit sum by 2^-14 & saturates it to 16 bits
+static inline short _resamplerResult(int sum)
+{
+    sum >>= 14;
+    return (short)((sum < -32768) ? -32768 : (sum > 32767) ? 32767 : sum);
+}
+
+
+// mmx-optimized version of the resampling routine for mono sound
+int VCSDKCoreAAResamplerMMX::resampleMono(short *pdest, const short *psrc, int &srcSamples)
+{
+    int i = 0;
+    int srcSampleEnd = srcSamples - (int)length;
+    int srcCount = 0;
+
+    while (srcCount < srcSampleEnd)
+    {
+        const __m64 *pVsrc = (const __m64 *)psrc;
+        const __m64 *pVfilter = (const __m64 *)getRow();
+        __m64 accu1 = _mm_setzero_si64();
+        __m64 accu2 = _mm_setzero_si64();
+
+        for (uint k = 0; k < length; k += 8)
+        {
+            accu1 = _mm_add_pi32(accu1, _mm_madd_pi16(pVsrc[0], pVfilter[0]));
+            accu2 = _mm_add_pi32(accu2, _mm_madd_pi16(pVsrc[1], pVfilter[1]));
+            pVsrc += 2;
+            pVfilter += 2;
+        }
+        accu1 = _mm_add_pi32(accu1, accu2);
+        accu1 = _mm_add_pi32(accu1, _mm_srli_si64(accu1, 32));
+        pdest[i] = _resamplerResult(_mm_cvtsi64_si32(accu1));
+        i ++;
+
+        int whole = advance();
+        psrc += whole;
+        srcCount += whole;
+    }
+    _m_empty();  // clear emms state
+
+    srcSamples = srcCount;
+    return i;
+}
+
+
+// mmx-optimized version of the resampling routine for stereo sound. The samples
+// are rearranged as l0 l2 r0 r2 & l1 l3 r1 r3, and the coefficients as c0 c2 c0 c2
+// & c1 c3 c1 c3, so that the sums accumulate as l r.
+int VCSDKCoreAAResamplerMMX::resampleStereo(short *pdest, const short *psrc, int &srcSamples)
+{
+    int i = 0;
+    int srcSampleEnd = srcSamples - (int)length;
+    int srcCount = 0;
+
+    while (srcCount < srcSampleEnd)
+    {
+        const __m64 *pVsrc = (const __m64 *)psrc;
+        const __m64 *pVfilter = (const __m64 *)getRow();
+        __m64 accu = _mm_setzero_si64();
+
+        for (uint k = 0; k < length; k += 4)
+        {
+            __m64 coeffs, temp1, temp2;
+
+            coeffs = _mm_unpacklo_pi16(pVfilter[0], _mm_srli_si64(pVfilter[0], 32));   // = c0 c2 c1 c3
+            temp1 = _mm_unpacklo_pi16(pVsrc[0], pVsrc[1]);  // = l0 l2 r0 r2
+            temp2 = _mm_unpackhi_pi16(pVsrc[0], pVsrc[1]);  // = l1 l3 r1 r3
+
+            accu = _mm_add_pi32(accu, _mm_madd_pi16(temp1, _mm_unpacklo_pi32(coeffs, coeffs)));
+            accu = _mm_add_pi32(accu, _mm_madd_pi16(temp2, _mm_unpackhi_pi32(coeffs, coeffs)));
+            pVsrc += 2;
+            pVfilter ++;
+        }
+        pdest[2 * i] = _resamplerResult(_mm_cvtsi64_si32(accu));
+        pdest[2 * i + 1] = _resamplerResult(_mm_cvtsi64_si32(_mm_srli_si64(accu, 32)));
+        i ++;
+
+        int whole = advance();
+        psrc += 2 * whole;
+        srcCount += whole;
+    }
+    _m_empty();  // clear emms state
+
+    srcSamples = srcCount;
+    return i;
+}
+
 #endif  // SOUNDTOUCH_ALLOW_MMX
 
 
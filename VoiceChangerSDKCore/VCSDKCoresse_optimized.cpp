@@ -21,128 +21,128 @@ using namespace vcsdkcore;
 //
 //////////////////////////////////////////////////////////////////////////////
 
-#include "TDStretch.h"
+#include "VCSDKCoreTDStretch.hpp"
 #include <xmmintrin.h>
+#include <assert.h>
 #include <math.h>
 
+
+// Returns sum of the four floats of 'v'
+static inline float _horizontalSum(__m128 v)
+{
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_add_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(v);
+}
+
+
 // Calculates cross correlation of two buffers
 double TDStretchSSE::calcCrossCorr(const float *pV1, const float *pV2, double &norm) const
 {
     int i;
-    const float *pVec1;
-    const __m128 *pVec2;
     __m128 vSum, vNorm;
 
-    // Note. It means a major slow-down if the routine needs to tolerate
-    // unaligned __m128 memory accesses. It's way faster if we can skip
-    // unaligned slots and use _mm_load_ps instruction instead of _mm_loadu_ps.
-    // This can mean up to ~ 10-fold difference (incl. part of which is
-    // due to skipping every second round for stereo sound though).
-    //
-    // Compile-time define SOUNDTOUCH_ALLOW_NONEXACT_SIMD_OPTIMIZATION is provided
-    // for choosing if this little cheating is allowed.
-
-#ifdef SOUNDTOUCH_ALLOW_NONEXACT_SIMD_OPTIMIZATION
-    // Little cheating allowed, return valid correlation only for
-    // aligned locations, meaning every second round for stereo sound.
-
-    #define _MM_LOAD    _mm_load_ps
-
-    if (((ulongptr)pV1) & 15) return -1e50;    // skip unaligned locations
-
-#else
-    // No cheating allowed, use unaligned load & take the resulting
-    // performance hit.
-    #define _MM_LOAD    _mm_loadu_ps
-#endif
-
     // ensure overlapLength is divisible by 8
     assert((overlapLength % 8) == 0);
 
-    // Calculates the cross-correlation value between 'pV1' and 'pV2' vectors
-    // Note: pV2 _must_ be aligned to 16-bit boundary, pV1 need not.
-    pVec1 = (const float*)pV1;
-    pVec2 = (const __m128*)pV2;
+    // Calculates the cross-correlation value between 'pV1' and 'pV2' vectors.
+    // pV1 points to an arbitrary sample of the input buffer, so use unaligned
+    // loads: on current CPUs they cost about the same as aligned ones, and every
+    // seek offset gets evaluated same way as in the C++ routine.
     vSum = vNorm = _mm_setzero_ps();
 
-    // Unroll the loop by factor of 4 * 4 operations. Use same routine for
-    // stereo & mono, for mono it just means twice the amount of unrolling.
-    for (i = 0; i < channels * overlapLength / 16; i ++)
+    // Unroll the loop by factor of 2 * 4 operations. Use same routine for
+    // stereo & mono, for stereo it just means twice the amount of rounds.
+    for (i = 0; i < channels * overlapLength; i += 8)
     {
         __m128 vTemp;
         // vSum += pV1[0..3] * pV2[0..3]
-        vTemp = _MM_LOAD(pVec1);
-        vSum  = _mm_add_ps(vSum,  _mm_mul_ps(vTemp ,pVec2[0]));
-        vNorm = _mm_add_ps(vNorm, _mm_mul_ps(vTemp ,vTemp));
+        vTemp = _mm_loadu_ps(pV1 + i);
+        vSum  = _mm_add_ps(vSum,  _mm_mul_ps(vTemp, _mm_loadu_ps(pV2 + i)));
+        vNorm = _mm_add_ps(vNorm, _mm_mul_ps(vTemp, vTemp));
 
         // vSum += pV1[4..7] * pV2[4..7]
-        vTemp = _MM_LOAD(pVec1 + 4);
-        vSum  = _mm_add_ps(vSum, _mm_mul_ps(vTemp, pVec2[1]));
-        vNorm = _mm_add_ps(vNorm, _mm_mul_ps(vTemp ,vTemp));
-
-        // vSum += pV1[8..11] * pV2[8..11]
-        vTemp = _MM_LOAD(pVec1 + 8);
-        vSum  = _mm_add_ps(vSum, _mm_mul_ps(vTemp, pVec2[2]));
-        vNorm = _mm_add_ps(vNorm, _mm_mul_ps(vTemp ,vTemp));
-
-        // vSum += pV1[12..15] * pV2[12..15]
-        vTemp = _MM_LOAD(pVec1 + 12);
-        vSum  = _mm_add_ps(vSum, _mm_mul_ps(vTemp, pVec2[3]));
-        vNorm = _mm_add_ps(vNorm, _mm_mul_ps(vTemp ,vTemp));
-
-        pVec1 += 16;
-        pVec2 += 4;
+        vTemp = _mm_loadu_ps(pV1 + i + 4);
+        vSum  = _mm_add_ps(vSum,  _mm_mul_ps(vTemp, _mm_loadu_ps(pV2 + i + 4)));
+        vNorm = _mm_add_ps(vNorm, _mm_mul_ps(vTemp, vTemp));
     }
 
-    // return value = vSum[0] + vSum[1] + vSum[2] + vSum[3]
-    float *pvNorm = (float*)&vNorm;
-    norm = (pvNorm[0] + pvNorm[1] + pvNorm[2] + pvNorm[3]);
+    norm = (double)_horizontalSum(vNorm);
+    return (double)_horizontalSum(vSum) / sqrt(norm < 1e-9 ? 1.0 : norm);
+}
+
 
-    float *pvSum = (float*)&vSum;
-    return (double)(pvSum[0] + pvSum[1] + pvSum[2] + pvSum[3]) / sqrt(norm < 1e-9 ? 1.0 : norm);
+/// Update cross-correlation by accumulating "norm" coefficient by previously calculated value
+double TDStretchSSE::calcCrossCorrAccumulate(const float *pV1, const float *pV2, double &norm) const
+{
+    int i;
+    __m128 vSum;
 
-    /* This is approximately corresponding routine in C-language yet without normalization:
-    double corr, norm;
-    uint i;
+    // cancel first normalizer tap from previous round
+    for (i = 1; i <= channels; i ++)
+    {
+        norm -= pV1[-i] * pV1[-i];
+    }
 
-    // Calculates the cross-correlation value between 'pV1' and 'pV2' vectors
-    corr = norm = 0.0;
-    for (i = 0; i < channels * overlapLength / 16; i ++)
+    vSum = _mm_setzero_ps();
+    for (i = 0; i < channels * overlapLength; i += 8)
     {
-        corr += pV1[0] * pV2[0] +
-                pV1[1] * pV2[1] +
-                pV1[2] * pV2[2] +
-                pV1[3] * pV2[3] +
-                pV1[4] * pV2[4] +
-                pV1[5] * pV2[5] +
-                pV1[6] * pV2[6] +
-                pV1[7] * pV2[7] +
-                pV1[8] * pV2[8] +
-                pV1[9] * pV2[9] +
-                pV1[10] * pV2[10] +
-                pV1[11] * pV2[11] +
-                pV1[12] * pV2[12] +
-                pV1[13] * pV2[13] +
-                pV1[14] * pV2[14] +
-                pV1[15] * pV2[15];
-
-    for (j = 0; j < 15; j ++) norm += pV1[j] * pV1[j];
-
-        pV1 += 16;
-        pV2 += 16;
+        vSum = _mm_add_ps(vSum, _mm_mul_ps(_mm_loadu_ps(pV1 + i), _mm_loadu_ps(pV2 + i)));
+        vSum = _mm_add_ps(vSum, _mm_mul_ps(_mm_loadu_ps(pV1 + i + 4), _mm_loadu_ps(pV2 + i + 4)));
     }
-    return corr / sqrt(norm);
-    */
+
+    // update normalizer with last samples of this round
+    for (int j = 0; j < channels; j ++)
+    {
+        i --;
+        norm += pV1[i] * pV1[i];
+    }
+
+    return (double)_horizontalSum(vSum) / sqrt(norm < 1e-9 ? 1.0 : norm);
 }
 
 
+// SSE-optimized version of the function overlapMono
+void TDStretchSSE::overlapMono(float *pOutput, const float *pInput) const
+{
+    const __m128 vScale = _mm_set1_ps(1.0f / (float)overlapLength);
+    const __m128 vStep = _mm_set1_ps(4.0f);
+    __m128 vPos;
+    int i;
 
-double TDStretchSSE::calcCrossCorrAccumulate(const float *pV1, const float *pV2, double &norm) const
+    // mixing weight of input sample 'i' is i / overlapLength, that of the
+    // mid buffer 1 - i / overlapLength
+    vPos = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    for (i = 0; i < overlapLength; i += 4)
+    {
+        __m128 vMid = _mm_loadu_ps(pMidBuffer + i);
+        __m128 f1 = _mm_mul_ps(vPos, vScale);
+
+        // output = mid + (input - mid) * f1
+        _mm_storeu_ps(pOutput + i, _mm_add_ps(vMid, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(pInput + i), vMid), f1)));
+        vPos = _mm_add_ps(vPos, vStep);
+    }
+}
+
+
+// SSE-optimized version of the function overlapStereo
+void TDStretchSSE::overlapStereo(float *pOutput, const float *pInput) const
 {
-    // call usual calcCrossCorr function because SSE does not show big benefit of
-    // accumulating "norm" value, and also the "norm" rolling algorithm would get
-    // complicated due to SSE-specific alignment-vs-nonexact correlation rules.
-    return calcCrossCorr(pV1, pV2, norm);
+    const __m128 vScale = _mm_set1_ps(1.0f / (float)overlapLength);
+    const __m128 vStep = _mm_set1_ps(2.0f);
+    __m128 vPos;
+    int i;
+
+    // two stereo samples per round, both channels with the same weight
+    vPos = _mm_setr_ps(0.0f, 0.0f, 1.0f, 1.0f);
+    for (i = 0; i < 2 * overlapLength; i += 4)
+    {
+        __m128 vMid = _mm_loadu_ps(pMidBuffer + i);
+        __m128 f1 = _mm_mul_ps(vPos, vScale);
+
+        _mm_storeu_ps(pOutput + i, _mm_add_ps(vMid, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(pInput + i), vMid), f1)));
+        vPos = _mm_add_ps(vPos, vStep);
+    }
 }
 
 
@@ -152,52 +152,75 @@ double TDStretchSSE::calcCrossCorrAccumulate(const float *pV1, const float *pV2,
 //
 //////////////////////////////////////////////////////////////////////////////
 
-#include "FIRFilter.h"
+#include "VCSDKCoreFIRFilter.hpp"
 
-FIRFilterSSE::FIRFilterSSE() : FIRFilter()
+VCSDKCoreFIRFilterSSE::VCSDKCoreFIRFilterSSE() : VCSDKCoreFIRFilter()
 {
     filterCoeffsAlign = NULL;
-    filterCoeffsUnalign = NULL;
+    filterCoeffsMonoAlign = NULL;
 }
 
 
-FIRFilterSSE::~FIRFilterSSE()
+VCSDKCoreFIRFilterSSE::~VCSDKCoreFIRFilterSSE()
 {
-    delete[] filterCoeffsUnalign;
-    filterCoeffsAlign = NULL;
-    filterCoeffsUnalign = NULL;
 }
 
 
-// (overloaded) Calculates filter coefficients for SSE routine
-void FIRFilterSSE::setCoefficients(const float *coeffs, uint newLength, uint uResultDivFactor)
+// (overloaded) Takes the coefficients arranged for the SSE routines
+void VCSDKCoreFIRFilterSSE::shareCoefficients(const VCSDKCoreFIRCoeffsPtr &coeffs)
 {
-    uint i;
-    float fDivider;
-
-    FIRFilter::setCoefficients(coeffs, newLength, uResultDivFactor);
+    VCSDKCoreFIRFilter::shareCoefficients(coeffs);
+    filterCoeffsAlign = coeffs->coeffsSSE;
+    // length is divisible by 8, so the mono coefficients are aligned as well
+    filterCoeffsMonoAlign = coeffs->coeffsSSE + 2 * length;
+}
 
-    // Scale the filter coefficients so that it won't be necessary to scale the filtering result
-    // also rearrange coefficients suitably for SSE
-    // Ensure that filter coeffs array is aligned to 16-byte boundary
-    delete[] filterCoeffsUnalign;
-    filterCoeffsUnalign = new float[2 * newLength + 4];
-    filterCoeffsAlign = (float *)SOUNDTOUCH_ALIGN_POINTER_16(filterCoeffsUnalign);
 
-    fDivider = (float)resultDivider;
+// Scales the filter coefficients so that it won't be necessary to scale the filtering
+// result, and rearranges them for the stereo routine, keeping a scaled copy for mono.
+// The shared coefficient arrays are aligned to VCSDKCORE_ALIGNMENT boundary.
+void VCSDKCoreFIRFilterSSE::arrangeCoefficients(float *dest, const float *coeffs, uint length, float divider)
+{
+    uint i;
+    float *destMono = dest + 2 * length;
 
-    // rearrange the filter coefficients for mmx routines
-    for (i = 0; i < newLength; i ++)
+    for (i = 0; i < length; i ++)
     {
-        filterCoeffsAlign[2 * i + 0] =
-        filterCoeffsAlign[2 * i + 1] = coeffs[i + 0] / fDivider;
+        dest[2 * i + 0] =
+        dest[2 * i + 1] = coeffs[i + 0] / divider;
+        destMono[i] = coeffs[i + 0] / divider;
     }
 }
 
 
 
-// SSE-optimized version of the filter routine for stereo sound
-uint FIRFilterSSE::evaluateFilterStereo(float *dest, const float *source, uint numSamples) const
+// Accumulates the 8 taps at 'pFil' of two stereo samples at 'pSrc', 2*2 filtered
+// values in 'sum' to be added together
+static inline __m128 _stereoTaps(__m128 sum, const float *pSrc, const __m128 *pFil)
+{
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(pSrc)     , pFil[0]));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(pSrc + 4) , pFil[1]));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(pSrc + 8) , pFil[2]));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(pSrc + 12), pFil[3]));
+    return sum;
+}
+
+
+// Adds the hi- and lo-floats of the 2*2 filtered stereo samples in 'sum1' & 'sum2'
+// together and stores the two resulting stereo samples to 'dest'
+static inline void _storeStereo(float *dest, __m128 sum1, __m128 sum2)
+{
+    _mm_storeu_ps(dest, _mm_add_ps(
+                _mm_shuffle_ps(sum1, sum2, _MM_SHUFFLE(1,0,3,2)),   // s2_1 s2_0 s1_3 s1_2
+                _mm_shuffle_ps(sum1, sum2, _MM_SHUFFLE(3,2,1,0))    // s2_3 s2_2 s1_1 s1_0
+                ));
+}
+
+
+// SSE-optimized version of the filter routine for stereo sound. Four stereo output
+// samples are calculated per pass over the coefficients; each of them is summed up
+// in the same order as when calculating two at a time.
+uint VCSDKCoreFIRFilterSSE::evaluateFilterStereo(float *dest, const float *source, uint numSamples) const
 {
     int count = (int)((numSamples - length) & (uint)-2);
     int j;
@@ -212,53 +235,55 @@ uint FIRFilterSSE::evaluateFilterStereo(float *dest, const float *source, uint n
     assert(filterCoeffsAlign != NULL);
     assert(((ulongptr)filterCoeffsAlign) % 16 == 0);
 
-    // filter is evaluated for two stereo samples with each iteration, thus use of 'j += 2'
-    for (j = 0; j < count; j += 2)
+    // filter is evaluated for four stereo samples with each iteration, thus use of 'j += 4'
+    for (j = 0; j + 4 <= count; j += 4)
     {
-        const float *pSrc;
-        const __m128 *pFil;
-        __m128 sum1, sum2;
+        const float *pSrc = source;                                 // source audio data
+        const __m128 *pFil = (const __m128*)filterCoeffsAlign;    // filter coefficients. NOTE: Assumes
+                                                                    // coefficients are aligned to 16-byte boundary
+        __m128 sum1, sum2, sum3, sum4;
         uint i;
 
-        pSrc = (const float*)source;              // source audio data
-        pFil = (const __m128*)filterCoeffsAlign;  // filter coefficients. NOTE: Assumes coefficients
-                                                  // are aligned to 16-byte boundary
-        sum1 = sum2 = _mm_setzero_ps();
+        // sum1...sum4 are accus for 2*2 filtered stereo sound data at the successive
+        // sound sample offsets
+        sum1 = sum2 = sum3 = sum4 = _mm_setzero_ps();
 
         for (i = 0; i < length / 8; i ++)
         {
-            // Unroll loop for efficiency & calculate filter for 2*2 stereo samples
-            // at each pass
+            sum1 = _stereoTaps(sum1, pSrc    , pFil);
+            sum2 = _stereoTaps(sum2, pSrc + 2, pFil);
+            sum3 = _stereoTaps(sum3, pSrc + 4, pFil);
+            sum4 = _stereoTaps(sum4, pSrc + 6, pFil);
 
-            // sum1 is accu for 2*2 filtered stereo sound data at the primary sound data offset
-            // sum2 is accu for 2*2 filtered stereo sound data for the next sound sample offset.
-
-            sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(pSrc)    , pFil[0]));
-            sum2 = _mm_add_ps(sum2, _mm_mul_ps(_mm_loadu_ps(pSrc + 2), pFil[0]));
+            pSrc += 16;
+            pFil += 4;
+        }
 
-            sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(pSrc + 4), pFil[1]));
-            sum2 = _mm_add_ps(sum2, _mm_mul_ps(_mm_loadu_ps(pSrc + 6), pFil[1]));
+        // post-shuffle & add the filtered values and store to dest.
+        _storeStereo(dest, sum1, sum2);
+        _storeStereo(dest + 4, sum3, sum4);
+        source += 8;
+        dest += 8;
+    }
 
-            sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(pSrc + 8) ,  pFil[2]));
-            sum2 = _mm_add_ps(sum2, _mm_mul_ps(_mm_loadu_ps(pSrc + 10), pFil[2]));
+    // the last two stereo samples, if any
+    if (j < count)
+    {
+        const float *pSrc = source;
+        const __m128 *pFil = (const __m128*)filterCoeffsAlign;
+        __m128 sum1, sum2;
+        uint i;
 
-            sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(pSrc + 12), pFil[3]));
-            sum2 = _mm_add_ps(sum2, _mm_mul_ps(_mm_loadu_ps(pSrc + 14), pFil[3]));
+        sum1 = sum2 = _mm_setzero_ps();
+        for (i = 0; i < length / 8; i ++)
+        {
+            sum1 = _stereoTaps(sum1, pSrc    , pFil);
+            sum2 = _stereoTaps(sum2, pSrc + 2, pFil);
 
             pSrc += 16;
             pFil += 4;
         }
-
-        // Now sum1 and sum2 both have a filtered 2-channel sample each, but we still need
-        // to sum the two hi- and lo-floats of these registers together.
-
-        // post-shuffle & add the filtered values and store to dest.
-        _mm_storeu_ps(dest, _mm_add_ps(
-                    _mm_shuffle_ps(sum1, sum2, _MM_SHUFFLE(1,0,3,2)),   // s2_1 s2_0 s1_3 s1_2
-                    _mm_shuffle_ps(sum1, sum2, _MM_SHUFFLE(3,2,1,0))    // s2_3 s2_2 s1_1 s1_0
-                    ));
-        source += 4;
-        dest += 4;
+        _storeStereo(dest, sum1, sum2);
     }
 
     // Ideas for further improvement:
@@ -268,67 +293,321 @@ uint FIRFilterSSE::evaluateFilterStereo(float *dest, const float *source, uint n
     //    boundary, a faster '_mm_store_ps' instruction could be used.
 
     return (uint)count;
+}
 
-    /* original routine in C-language. please notice the C-version has differently
-       organized coefficients though.
-    double suml1, suml2;
-    double sumr1, sumr2;
+
+
+// Accumulates the 8 taps at 'pFil' of the mono sample at 'pSrc', in two accumulators
+// to shorten the dependency chain
+static inline void _monoTaps(const float *pSrc, __m128 fil1, __m128 fil2, __m128 &sum1, __m128 &sum2)
+{
+    sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(pSrc), fil1));
+    sum2 = _mm_add_ps(sum2, _mm_mul_ps(_mm_loadu_ps(pSrc + 4), fil2));
+}
+
+
+// SSE-optimized version of the filter routine for mono sound. Four output samples
+// are calculated per pass over the coefficients; each of them is summed up in the
+// same order as when calculating one at a time.
+uint VCSDKCoreFIRFilterSSE::evaluateFilterMono(float *dest, const float *source, uint numSamples) const
+{
+    uint end = numSamples - length;
     uint i, j;
 
-    for (j = 0; j < count; j += 2)
+    assert(source != NULL);
+    assert(dest != NULL);
+    assert((length % 8) == 0);
+    assert(filterCoeffsMonoAlign != NULL);
+    assert(((ulongptr)filterCoeffsMonoAlign) % 16 == 0);
+
+    for (j = 0; j + 4 <= end; j += 4)
     {
-        const float *ptr;
-        const float *pFil;
-
-        suml1 = sumr1 = 0.0;
-        suml2 = sumr2 = 0.0;
-        ptr = src;
-        pFil = filterCoeffs;
-        for (i = 0; i < lengthLocal; i ++)
+        const float *pSrc = source + j;
+        __m128 sum0a, sum0b, sum1a, sum1b, sum2a, sum2b, sum3a, sum3b;
+
+        sum0a = sum0b = sum1a = sum1b = sum2a = sum2b = sum3a = sum3b = _mm_setzero_ps();
+        for (i = 0; i < length; i += 8)
         {
-            // unroll loop for efficiency.
-
-            suml1 += ptr[0] * pFil[0] +
-                     ptr[2] * pFil[2] +
-                     ptr[4] * pFil[4] +
-                     ptr[6] * pFil[6];
-
-            sumr1 += ptr[1] * pFil[1] +
-                     ptr[3] * pFil[3] +
-                     ptr[5] * pFil[5] +
-                     ptr[7] * pFil[7];
-
-            suml2 += ptr[8] * pFil[0] +
-                     ptr[10] * pFil[2] +
-                     ptr[12] * pFil[4] +
-                     ptr[14] * pFil[6];
-
-            sumr2 += ptr[9] * pFil[1] +
-                     ptr[11] * pFil[3] +
-                     ptr[13] * pFil[5] +
-                     ptr[15] * pFil[7];
-
-            ptr += 16;
-            pFil += 8;
+            const __m128 fil1 = _mm_load_ps(filterCoeffsMonoAlign + i);
+            const __m128 fil2 = _mm_load_ps(filterCoeffsMonoAlign + i + 4);
+
+            _monoTaps(pSrc + i + 0, fil1, fil2, sum0a, sum0b);
+            _monoTaps(pSrc + i + 1, fil1, fil2, sum1a, sum1b);
+            _monoTaps(pSrc + i + 2, fil1, fil2, sum2a, sum2b);
+            _monoTaps(pSrc + i + 3, fil1, fil2, sum3a, sum3b);
         }
-        dest[0] = (float)suml1;
-        dest[1] = (float)sumr1;
-        dest[2] = (float)suml2;
-        dest[3] = (float)sumr2;
 
-        src += 4;
-        dest += 4;
+        // transpose, so that lane k of 'sumN' holds the lane N of output k, and add
+        // the lanes together in the order of _horizontalSum
+        sum0a = _mm_add_ps(sum0a, sum0b);
+        sum1a = _mm_add_ps(sum1a, sum1b);
+        sum2a = _mm_add_ps(sum2a, sum2b);
+        sum3a = _mm_add_ps(sum3a, sum3b);
+        _MM_TRANSPOSE4_PS(sum0a, sum1a, sum2a, sum3a);
+        _mm_storeu_ps(dest + j, _mm_add_ps(_mm_add_ps(sum0a, sum2a), _mm_add_ps(sum1a, sum3a)));
     }
-    */
+
+    // the last few samples one at a time
+    for (; j < end; j ++)
+    {
+        const float *pSrc = source + j;
+        __m128 sum1, sum2;
+
+        sum1 = sum2 = _mm_setzero_ps();
+        for (i = 0; i < length; i += 8)
+        {
+            _monoTaps(pSrc + i, _mm_load_ps(filterCoeffsMonoAlign + i), _mm_load_ps(filterCoeffsMonoAlign + i + 4), sum1, sum2);
+        }
+        dest[j] = _horizontalSum(_mm_add_ps(sum1, sum2));
+    }
+    return end;
 }
 
-#endif  // SOUNDTOUCH_ALLOW_SSE
 
+// Accumulates 4 taps of 4 channels at 'ptr', weighted by the 4 coefficients of 'fil'
+static inline __m128 _multiTaps(__m128 sum, const float *ptr, uint numChannels, __m128 fil)
+{
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(ptr)                  , _mm_shuffle_ps(fil, fil, _MM_SHUFFLE(0, 0, 0, 0))));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(ptr + numChannels)    , _mm_shuffle_ps(fil, fil, _MM_SHUFFLE(1, 1, 1, 1))));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(ptr + 2 * numChannels), _mm_shuffle_ps(fil, fil, _MM_SHUFFLE(2, 2, 2, 2))));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(ptr + 3 * numChannels), _mm_shuffle_ps(fil, fil, _MM_SHUFFLE(3, 3, 3, 3))));
+    return sum;
+}
 
 
+// SSE-optimized version of the filter routine for more than 2 channels. The channels
+// are filtered 4 at a time; with a channel count that isn't divisible by 4, the last
+// group overlaps the previous one.
+uint VCSDKCoreFIRFilterSSE::evaluateFilterMulti(float *dest, const float *source, uint numSamples, uint numChannels) const
+{
+    uint end = numSamples - length;
+    uint i, j, c;
+
+    assert(source != NULL);
+    assert(dest != NULL);
+    assert((length % 8) == 0);
+    assert(filterCoeffsMonoAlign != NULL);
+    assert(((ulongptr)filterCoeffsMonoAlign) % 16 == 0);
 
+    if (numChannels < 4)
+    {
+        return VCSDKCoreFIRFilter::evaluateFilterMulti(dest, source, numSamples, numChannels);
+    }
 
+    for (j = 0; j < end; j ++)
+    {
+        for (c = 0; c < numChannels; c += 4)
+        {
+            const uint first = (c + 4 <= numChannels) ? c : numChannels - 4;
+            const float *ptr = source + j * numChannels + first;
+            __m128 sum1, sum2;
+
+            // two accumulators to shorten the dependency chain
+            sum1 = sum2 = _mm_setzero_ps();
+            for (i = 0; i < length; i += 8)
+            {
+                sum1 = _multiTaps(sum1, ptr, numChannels, _mm_load_ps(filterCoeffsMonoAlign + i));
+                sum2 = _multiTaps(sum2, ptr + 4 * numChannels, numChannels, _mm_load_ps(filterCoeffsMonoAlign + i + 4));
+                ptr += 8 * numChannels;
+            }
+            _mm_storeu_ps(dest + j * numChannels + first, _mm_add_ps(sum1, sum2));
+        }
+    }
+    return end;
+}
 
 
+//////////////////////////////////////////////////////////////////////////////
+//
+// implementation of SSE optimized functions of class 'InterpolatePolyphaseSSE'
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "VCSDKCoreInterpolatePolyphase.hpp"
+
+// Returns the interpolated kernel coefficients for the current 'fract' of
+// 'kernel' in two vectors, taps 0..3 & 4..7. The table rows are aligned.
+static inline void _polyphaseCoeffs(const float *kernel, int numPhases, float fract, __m128 &c0, __m128 &c1)
+{
+    const float pos = fract * (float)numPhases;
+    const int phase = (int)pos;
+    const __m128 t = _mm_set1_ps(pos - (float)phase);
+    const float *row = kernel + phase * 2 * POLYPHASE_TAPS;
+
+    c0 = _mm_add_ps(_mm_load_ps(row), _mm_mul_ps(t, _mm_load_ps(row + 8)));
+    c1 = _mm_add_ps(_mm_load_ps(row + 4), _mm_mul_ps(t, _mm_load_ps(row + 12)));
+}
+
+
+// SSE-optimized polyphase interpolation for mono sound
+int InterpolatePolyphaseSSE::transposeMono(float *pdest, const float *psrc, int &srcSamples)
+{
+    int i = 0;
+    int srcSampleEnd = srcSamples - POLYPHASE_TAPS;
+    int srcCount = 0;
+
+    while (srcCount < srcSampleEnd)
+    {
+        __m128 c0, c1, sum;
+
+        assert(fract < 1.0);
+        _polyphaseCoeffs(pKernel, numPhases, fract, c0, c1);
+        sum = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(psrc), c0), _mm_mul_ps(_mm_loadu_ps(psrc + 4), c1));
+        pdest[i] = _horizontalSum(sum);
+        i ++;
+
+        int whole = advance();
+        psrc += whole;
+        srcCount += whole;
+    }
+    srcSamples = srcCount;
+    return i;
+}
+
+
+// SSE-optimized polyphase interpolation for stereo sound. The coefficients are
+// duplicated for the interleaved channels, and the lanes sum up as L, R, L, R.
+int InterpolatePolyphaseSSE::transposeStereo(float *pdest, const float *psrc, int &srcSamples)
+{
+    int i = 0;
+    int srcSampleEnd = srcSamples - POLYPHASE_TAPS;
+    int srcCount = 0;
+
+    while (srcCount < srcSampleEnd)
+    {
+        __m128 c0, c1, sum;
+
+        assert(fract < 1.0);
+        _polyphaseCoeffs(pKernel, numPhases, fract, c0, c1);
+        sum = _mm_mul_ps(_mm_loadu_ps(psrc), _mm_unpacklo_ps(c0, c0));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(psrc + 4), _mm_unpackhi_ps(c0, c0)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(psrc + 8), _mm_unpacklo_ps(c1, c1)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(psrc + 12), _mm_unpackhi_ps(c1, c1)));
+        sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+        _mm_storel_pi((__m64 *)(pdest + 2 * i), sum);
+        i ++;
+
+        int whole = advance();
+        psrc += 2 * whole;
+        srcCount += whole;
+    }
+    srcSamples = srcCount;
+    return i;
+}
 
 
+
+// SSE-optimized polyphase interpolation for more than 2 channels. The channels are
+// interpolated 4 at a time as in VCSDKCoreFIRFilterSSE::evaluateFilterMulti.
+int InterpolatePolyphaseSSE::transposeMulti(float *pdest, const float *psrc, int &srcSamples)
+{
+    const uint channels = (uint)numChannels;
+    int i = 0;
+    int srcSampleEnd = srcSamples - POLYPHASE_TAPS;
+    int srcCount = 0;
+
+    if (numChannels < 4)
+    {
+        return VCSDKCoreInterpolatePolyphase::transposeMulti(pdest, psrc, srcSamples);
+    }
+
+    while (srcCount < srcSampleEnd)
+    {
+        __m128 c0, c1;
+
+        assert(fract < 1.0);
+        _polyphaseCoeffs(pKernel, numPhases, fract, c0, c1);
+        for (uint c = 0; c < channels; c += 4)
+        {
+            const uint first = (c + 4 <= channels) ? c : channels - 4;
+            __m128 sum;
+
+            sum = _multiTaps(_mm_setzero_ps(), psrc + first, channels, c0);
+            sum = _multiTaps(sum, psrc + 4 * channels + first, channels, c1);
+            _mm_storeu_ps(pdest + first, sum);
+        }
+        pdest += channels;
+        i ++;
+
+        int whole = advance();
+        psrc += channels * whole;
+        srcCount += whole;
+    }
+    srcSamples = srcCount;
+    return i;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// implementation of SSE optimized functions of class 'VCSDKCoreAAResamplerSSE'
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "VCSDKCoreAAResampler.hpp"
+
+// SSE-optimized version of the resampling routine for mono sound. The kernel
+// table rows are aligned, the filter length is divisible by 8.
+int VCSDKCoreAAResamplerSSE::resampleMono(float *pdest, const float *psrc, int &srcSamples)
+{
+    int i = 0;
+    int srcSampleEnd = srcSamples - (int)length;
+    int srcCount = 0;
+
+    while (srcCount < srcSampleEnd)
+    {
+        const float *coeffs = getRow();
+        __m128 sum1 = _mm_setzero_ps();
+        __m128 sum2 = _mm_setzero_ps();
+
+        for (uint k = 0; k < length; k += 8)
+        {
+            sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(psrc + k), _mm_load_ps(coeffs + k)));
+            sum2 = _mm_add_ps(sum2, _mm_mul_ps(_mm_loadu_ps(psrc + k + 4), _mm_load_ps(coeffs + k + 4)));
+        }
+        pdest[i] = _horizontalSum(_mm_add_ps(sum1, sum2));
+        i ++;
+
+        int whole = advance();
+        psrc += whole;
+        srcCount += whole;
+    }
+    srcSamples = srcCount;
+    return i;
+}
+
+
+// SSE-optimized version of the resampling routine for stereo sound. The
+// coefficients are duplicated for the interleaved channels, and the lanes sum
+// up as L, R, L, R.
+int VCSDKCoreAAResamplerSSE::resampleStereo(float *pdest, const float *psrc, int &srcSamples)
+{
+    int i = 0;
+    int srcSampleEnd = srcSamples - (int)length;
+    int srcCount = 0;
+
+    while (srcCount < srcSampleEnd)
+    {
+        const float *coeffs = getRow();
+        __m128 sum1 = _mm_setzero_ps();
+        __m128 sum2 = _mm_setzero_ps();
+
+        for (uint k = 0; k < length; k += 4)
+        {
+            __m128 c = _mm_load_ps(coeffs + k);
+            sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(psrc + 2 * k), _mm_unpacklo_ps(c, c)));
+            sum2 = _mm_add_ps(sum2, _mm_mul_ps(_mm_loadu_ps(psrc + 2 * k + 4), _mm_unpackhi_ps(c, c)));
+        }
+        sum1 = _mm_add_ps(sum1, sum2);
+        sum1 = _mm_add_ps(sum1, _mm_movehl_ps(sum1, sum1));
+        _mm_storel_pi((__m64 *)(pdest + 2 * i), sum1);
+        i ++;
+
+        int whole = advance();
+        psrc += 2 * whole;
+        srcCount += whole;
+    }
+    srcSamples = srcCount;
+    return i;
+}
+
+#endif  // SOUNDTOUCH_ALLOW_SSE
@@ -6,6 +6,8 @@
 //
 
 #include "VoiceChangerSDKPublic.h"
+#include <string.h>
+#include <thread>
 
 
 #define DR_WAV_IMPLEMENTATION // 必须加上下面这个宏定义，否则会报错
@@ -13,6 +15,57 @@
 #include "dr_wav.h"
 
 
+/** 对外接口均为16bit PCM。浮点版本(SOUNDTOUCH_FLOAT_SAMPLES)内部以[-1, 1)范围的float处理，
+ *  在输入输出时逐块转换(栈上缓冲，不分配内存)；整数版本直接传递。
+ */
+#define KVOICECHANGER_CONVERT_BLOCK_SAMPLES     1024
+
+#ifdef SOUNDTOUCH_FLOAT_SAMPLES
+static void corePutPcm(vcsdkcore::VCSDKCore *core, const short *samples, uint numSamples) {
+    float block[KVOICECHANGER_CONVERT_BLOCK_SAMPLES];
+    while (numSamples > 0) {
+        uint count = (numSamples > KVOICECHANGER_CONVERT_BLOCK_SAMPLES) ? KVOICECHANGER_CONVERT_BLOCK_SAMPLES : numSamples;
+        for (uint i = 0; i < count; i ++) {
+            block[i] = samples[i] * (1.0f / 32768.0f);
+        }
+        core->putSamples(block, count);
+        samples += count;
+        numSamples -= count;
+    }
+}
+
+// 四舍五入并饱和到16bit范围
+static inline short sampleToPcm(float sample) {
+    float value = sample * 32768.0f;
+    value += (value >= 0) ? 0.5f : -0.5f;
+    return (short)((value < -32768.0f) ? -32768.0f : (value > 32767.0f) ? 32767.0f : value);
+}
+
+static uint coreReceivePcm(vcsdkcore::VCSDKCore *core, short *output, uint maxSamples) {
+    float block[KVOICECHANGER_CONVERT_BLOCK_SAMPLES];
+    uint total = 0;
+    while (total < maxSamples) {
+        uint space = maxSamples - total;
+        uint count = core->receiveSamples(block, (space > KVOICECHANGER_CONVERT_BLOCK_SAMPLES) ? KVOICECHANGER_CONVERT_BLOCK_SAMPLES : space);
+        if (count == 0) break;
+        for (uint i = 0; i < count; i ++) {
+            output[total + i] = sampleToPcm(block[i]);
+        }
+        total += count;
+    }
+    return total;
+}
+#else
+static inline void corePutPcm(vcsdkcore::VCSDKCore *core, const short *samples, uint numSamples) {
+    core->putSamples(samples, numSamples);
+}
+
+static inline uint coreReceivePcm(vcsdkcore::VCSDKCore *core, short *output, uint maxSamples) {
+    return core->receiveSamples(output, maxSamples);
+}
+#endif // SOUNDTOUCH_FLOAT_SAMPLES
+
+
 
 VoiceChangerSDKPublic::VoiceChangerSDKPublic() {
     
@@ -30,12 +83,18 @@ VoiceChangerSDKPublic::VoiceChangerSDKPublic() {
     _vcsdkCore->setSetting(SETTING_SEEKWINDOW_MS, 15); // 叠加的时候寻找窗的范围长度（ms）
     _vcsdkCore->setSetting(SETTING_OVERLAP_MS, 8);  //  叠加范围（ms），样例中用的是8
 
+    _frameSize = 0;
+    _frameDelay = 0;
+    _framePrimeRemaining = 0;
+    _frameDeficit = 0;
+    _frameUnderruns = 0;
     
+    _offlineThreads = 1;
 }
 
 VoiceChangerSDKPublic::~VoiceChangerSDKPublic() {
     
-    
+    delete _vcsdkCore;
 }
 
 
@@ -142,15 +201,143 @@ void testNewSound() {
 // --- --- ---
 /** 1. 实时输入CSSampleBuffer数据处理
  * putSamples输入,receiveSamples输出处理后的sampleBuffer。
+ * 直接调用VCSDKCore，不经过文件，稳定运行后不再分配内存。
+ */
+void VoiceChangerSDKPublic::setStreamSampleRate(uint32_t sampleRate) {
+    _vcsdkCore->clear();
+    _vcsdkCore->setSampleRate(sampleRate);
+}
+
+// 丢弃内部缓存的数据，重新开始一段新的流
+void VoiceChangerSDKPublic::resetStream() {
+    _vcsdkCore->clear();
+}
+
 // 往ST中输入buffer
-void VoiceChangerSDKPublic::putSamples(const short *samples,uint length) {
-    _vcsdkCore->putSamples(samples, length);
+void VoiceChangerSDKPublic::putSamples(const short *samples, uint length) {
+    corePutPcm(_vcsdkCore, samples, length);
 }
+
 // 处理完成的buffers从ST中输出
-void VoiceChangerSDKPublic::receiveSample(short *buffer,uint length) {
-    _vcsdkCore->receiveSamples(buffer,length);
+uint VoiceChangerSDKPublic::receiveSamples(short *buffer, uint length) {
+    return coreReceivePcm(_vcsdkCore, buffer, length);
+}
+
+size_t VoiceChangerSDKPublic::process(const short *in, size_t n, short *out, size_t cap) {
+    if (in != NULL && n > 0) {
+        corePutPcm(_vcsdkCore, in, (uint)n);
+    }
+    if (out == NULL || cap == 0) {
+        return 0;
+    }
+    return coreReceivePcm(_vcsdkCore, out, (uint)cap);
+}
+
+// 流结束: 冲出管道中残留的数据，超出cap的部分可继续用receiveSamples取出
+size_t VoiceChangerSDKPublic::flushStream(short *out, size_t cap) {
+    _vcsdkCore->flush();
+    if (out == NULL || cap == 0) {
+        return 0;
+    }
+    return coreReceivePcm(_vcsdkCore, out, (uint)cap);
+}
+
+// 已处理完成、可立即取出的采样点数
+size_t VoiceChangerSDKPublic::getReadySampleCount() {
+    return _vcsdkCore->numSamples();
+}
+
+// 仍缓存在内部的采样点数: 待处理的输入 + 尚未取出的输出
+size_t VoiceChangerSDKPublic::getBufferedSampleCount() {
+    return _vcsdkCore->numUnprocessedSamples() + _vcsdkCore->numSamples();
 }
+
+
+
+/** 固定帧模式: 每次输入一帧、输出正好一帧
+ *
+ *  管道的最大滞后量只取决于变声参数(VCSDKCore::getLatencySamples)，
+ *  开头一次性输出同样长度的静音作为固定延时，之后每帧的输出都已在管道中准备好，
+ *  单次调用的开销是确定的。
  */
+#define KVOICECHANGER_MAX_FRAME_SAMPLES     4096
+
+bool VoiceChangerSDKPublic::setFrameMode(uint32_t sampleRate, uint32_t frameSize) {
+    if (sampleRate == 0 || frameSize == 0 || frameSize > KVOICECHANGER_MAX_FRAME_SAMPLES) {
+        _frameSize = 0;
+        return false;
+    }
+    
+    setStreamSampleRate(sampleRate);
+    
+    _frameSize = frameSize;
+    _frameDelay = _vcsdkCore->getLatencySamples();
+    // 预先分配处理缓冲区，逐帧处理时不再分配内存
+    _vcsdkCore->prepare(frameSize);
+    _framePrimeRemaining = _frameDelay;
+    _frameDeficit = 0;
+    _frameUnderruns = 0;
+    return true;
+}
+
+bool VoiceChangerSDKPublic::processFrame(const short *in, short *out) {
+    if (_frameSize == 0 || in == NULL || out == NULL) {
+        return false;
+    }
+    
+    corePutPcm(_vcsdkCore, in, _frameSize);
+    
+    // 之前补过静音的部分，丢弃同样多的数据，保持延时不变
+    if (_frameDeficit > 0) {
+        uint available = _vcsdkCore->numSamples();
+        uint drop = (available < _frameDeficit) ? available : _frameDeficit;
+        _frameDeficit -= _vcsdkCore->receiveSamples(drop);
+    }
+    
+    uint pos = 0;
+    if (_framePrimeRemaining > 0) {
+        pos = (_framePrimeRemaining < _frameSize) ? _framePrimeRemaining : _frameSize;
+        memset(out, 0, pos * sizeof(short));
+        _framePrimeRemaining -= pos;
+    }
+    
+    if (_frameDeficit == 0) {
+        pos += coreReceivePcm(_vcsdkCore, out + pos, _frameSize - pos);
+    }
+    
+    if (pos < _frameSize) {
+        // 数据不足(变声参数不满足tempo * rate == 1，或处理中途修改了参数)
+        memset(out + pos, 0, (_frameSize - pos) * sizeof(short));
+        _frameDeficit += _frameSize - pos;
+        _frameUnderruns ++;
+        return false;
+    }
+    return true;
+}
+
+uint32_t VoiceChangerSDKPublic::getFrameDelaySamples() {
+    return _frameDelay;
+}
+
+uint64_t VoiceChangerSDKPublic::getFrameUnderrunCount() {
+    return _frameUnderruns;
+}
+
+
+uint32_t VoiceChangerSDKPublic::getLatencySamples() {
+    return _vcsdkCore->getLatencySamples();
+}
+
+bool VoiceChangerSDKPublic::setTargetLatencyMs(uint32_t latencyMs) {
+    if (latencyMs == 0) {
+        // 恢复默认参数
+        _vcsdkCore->setSetting(SETTING_SEQUENCE_MS, 40);
+        _vcsdkCore->setSetting(SETTING_SEEKWINDOW_MS, 15);
+        _vcsdkCore->setSetting(SETTING_OVERLAP_MS, 8);
+        return true;
+    }
+    return _vcsdkCore->setSetting(SETTING_TARGET_LATENCY_MS, (int)latencyMs) != FALSE;
+}
 
 
 /** 2. 读取文件get SampleBuffer
@@ -195,6 +382,258 @@ int16_t *wavRead_s16(char *filename, uint32_t *sampleRate, uint64_t *totalSample
 }
 
 
+/** 分块读写: 每个块从原文件读取的采样点数(单声道)
+ *  内存占用只与块大小有关，与文件时长无关。
+ */
+#define KVOICECHANGER_FILE_BLOCK_SAMPLES    4096
+
+
+// 立体声混合为单声道，dest可以与src相同(原地处理)
+static void downmixStereoToMono(short *dest, const short *src, uint numFrames) {
+    for (uint i = 0; i < numFrames; i ++) {
+        dest[i] = (short)((src[2 * i] + src[2 * i + 1]) >> 1);
+    }
+}
+
+
+/** 变声输出目标: WAV写入器(文件或内存)，或调用方提供的PCM缓冲区。
+ *  pWav为NULL时输出到pcm，最多写capacity个采样点。
+ */
+typedef struct {
+    drwav *pWav;
+    short *pcm;
+    size_t capacity;
+    size_t written;
+} VoiceChangerOutput;
+
+
+// 把VCSDKCore中已处理完成的数据追加写入输出目标
+static bool writeReadySamples(vcsdkcore::VCSDKCore *core, VoiceChangerOutput *out) {
+    uint numSamples;
+    if (out->pWav == NULL) {
+        // 直接接收到调用方的缓冲区，无需中间拷贝
+        while (out->written < out->capacity) {
+            size_t space = out->capacity - out->written;
+            numSamples = coreReceivePcm(core, out->pcm + out->written,
+                                        (space > KVOICECHANGER_FILE_BLOCK_SAMPLES) ? KVOICECHANGER_FILE_BLOCK_SAMPLES : (uint)space);
+            if (numSamples == 0) break;
+            out->written += numSamples;
+        }
+        // 缓冲区已满但仍有未取出的数据，说明缓冲区不足
+        return out->written < out->capacity || core->numSamples() == 0;
+    }
+    
+    short block[KVOICECHANGER_FILE_BLOCK_SAMPLES];
+    while ((numSamples = coreReceivePcm(core, block, KVOICECHANGER_FILE_BLOCK_SAMPLES)) > 0) {
+        if (drwav_write(out->pWav, numSamples, block) != numSamples) {
+            return false;
+        }
+        out->written += numSamples;
+    }
+    return true;
+}
+
+
+// 冲出管道中残留的数据，输出总长度正好为getOutputSampleCount预测的长度
+static bool flushToOutput(vcsdkcore::VCSDKCore *core, VoiceChangerOutput *out) {
+    core->flush();
+    return writeReadySamples(core, out);
+}
+
+
+/** 读取WAV(文件或内存)数据，逐块变声后写入输出目标
+ *
+ *  此处是一个cycle，不需要等待其他回调
+ *  逐块读取、变声、写入，处理完最后一块后自动走出循环
+ */
+static bool voiceChangeWav(vcsdkcore::VCSDKCore *core, drwav *pWavIn, VoiceChangerOutput *out) {
+    uint channels = pWavIn->channels;
+    drwav_uint64 numRead;
+    
+#ifdef SOUNDTOUCH_FLOAT_SAMPLES
+    // 浮点版本直接读取float，保留24bit/32bit浮点源的精度
+    float inBlock[KVOICECHANGER_FILE_BLOCK_SAMPLES * 2];
+    
+    while ((numRead = drwav_read_f32(pWavIn, KVOICECHANGER_FILE_BLOCK_SAMPLES * channels, inBlock)) > 0) {
+        uint numFrames = (uint)(numRead / channels);
+        if (channels == 2) {
+            for (uint i = 0; i < numFrames; i ++) {
+                inBlock[i] = 0.5f * (inBlock[2 * i] + inBlock[2 * i + 1]);
+            }
+        }
+        core->putSamples(inBlock, numFrames);
+#else
+    short inBlock[KVOICECHANGER_FILE_BLOCK_SAMPLES * 2];
+    
+    while ((numRead = drwav_read_s16(pWavIn, KVOICECHANGER_FILE_BLOCK_SAMPLES * channels, inBlock)) > 0) {
+        uint numFrames = (uint)(numRead / channels);
+        if (channels == 2) {
+            downmixStereoToMono(inBlock, inBlock, numFrames);
+        }
+        core->putSamples(inBlock, numFrames);
+#endif // SOUNDTOUCH_FLOAT_SAMPLES
+        
+        if (!writeReadySamples(core, out)) {
+            return false;
+        }
+    }
+    return flushToOutput(core, out);
+}
+
+
+// 内存中交错PCM数据逐块变声后写入输出目标，单声道数据直接输入不做拷贝
+static bool voiceChangePcm(vcsdkcore::VCSDKCore *core, const short *pcmIn, size_t inFrames, uint channels, VoiceChangerOutput *out) {
+    short inBlock[KVOICECHANGER_FILE_BLOCK_SAMPLES];
+    
+    for (size_t pos = 0; pos < inFrames; pos += KVOICECHANGER_FILE_BLOCK_SAMPLES) {
+        uint numFrames = (uint)((inFrames - pos > KVOICECHANGER_FILE_BLOCK_SAMPLES) ? KVOICECHANGER_FILE_BLOCK_SAMPLES : inFrames - pos);
+        if (channels == 2) {
+            downmixStereoToMono(inBlock, pcmIn + 2 * pos, numFrames);
+            corePutPcm(core, inBlock, numFrames);
+        } else {
+            corePutPcm(core, pcmIn + pos, numFrames);
+        }
+        
+        if (!writeReadySamples(core, out)) {
+            return false;
+        }
+    }
+    return flushToOutput(core, out);
+}
+
+
+/** 整段变声(多线程): 输入为整段单声道数据，VCSDKCore::processSegmented分段并行处理后写入输出目标
+ *  整数版本输出到调用方缓冲区时直接写入，不做中间拷贝。
+ */
+static bool voiceChangeSegmented(vcsdkcore::VCSDKCore *core, const vcsdkcore::SAMPLETYPE *input, size_t numFrames,
+                                 uint numThreads, VoiceChangerOutput *out) {
+    size_t numOut = (size_t)core->getOutputSampleCount(numFrames);
+    
+    if (out->pWav == NULL && out->capacity - out->written < numOut) {
+        return false;
+    }
+#ifndef SOUNDTOUCH_FLOAT_SAMPLES
+    if (out->pWav == NULL) {
+        out->written += (size_t)core->processSegmented(input, numFrames, out->pcm + out->written, numThreads);
+        return true;
+    }
+#endif
+    
+    vcsdkcore::SAMPLETYPE *processed = (vcsdkcore::SAMPLETYPE *)malloc((numOut + 1) * sizeof(vcsdkcore::SAMPLETYPE));
+    if (processed == NULL) {
+        return false;
+    }
+    numOut = (size_t)core->processSegmented(input, numFrames, processed, numThreads);
+    
+    bool result = true;
+    short block[KVOICECHANGER_FILE_BLOCK_SAMPLES];
+    for (size_t pos = 0; pos < numOut && result; pos += KVOICECHANGER_FILE_BLOCK_SAMPLES) {
+        uint count = (uint)((numOut - pos > KVOICECHANGER_FILE_BLOCK_SAMPLES) ? KVOICECHANGER_FILE_BLOCK_SAMPLES : numOut - pos);
+        short *dest = (out->pWav == NULL) ? out->pcm + out->written : block;
+#ifdef SOUNDTOUCH_FLOAT_SAMPLES
+        for (uint i = 0; i < count; i ++) {
+            dest[i] = sampleToPcm(processed[pos + i]);
+        }
+#else
+        dest = processed + pos;
+#endif
+        if (out->pWav != NULL && drwav_write(out->pWav, count, dest) != count) {
+            result = false;
+        } else {
+            out->written += count;
+        }
+    }
+    free(processed);
+    return result;
+}
+
+
+// 整个WAV读入内存，混合为单声道后多线程变声
+static bool voiceChangeWavSegmented(vcsdkcore::VCSDKCore *core, drwav *pWavIn, uint numThreads, VoiceChangerOutput *out) {
+    uint channels = pWavIn->channels;
+    size_t numFrames = (size_t)(pWavIn->totalSampleCount / channels);
+    
+    vcsdkcore::SAMPLETYPE *input = (vcsdkcore::SAMPLETYPE *)malloc((numFrames * channels + 1) * sizeof(vcsdkcore::SAMPLETYPE));
+    if (input == NULL) {
+        return false;
+    }
+#ifdef SOUNDTOUCH_FLOAT_SAMPLES
+    numFrames = (size_t)(drwav_read_f32(pWavIn, numFrames * channels, input) / channels);
+    if (channels == 2) {
+        for (size_t i = 0; i < numFrames; i ++) {
+            input[i] = 0.5f * (input[2 * i] + input[2 * i + 1]);
+        }
+    }
+#else
+    numFrames = (size_t)(drwav_read_s16(pWavIn, numFrames * channels, input) / channels);
+    if (channels == 2) {
+        downmixStereoToMono(input, input, (uint)numFrames);
+    }
+#endif // SOUNDTOUCH_FLOAT_SAMPLES
+    
+    bool result = voiceChangeSegmented(core, input, numFrames, numThreads, out);
+    free(input);
+    return result;
+}
+
+
+// 内存中交错PCM数据转换为整段单声道后多线程变声，整数版本的单声道数据直接使用
+static bool voiceChangePcmSegmented(vcsdkcore::VCSDKCore *core, const short *pcmIn, size_t inFrames, uint channels,
+                                    uint numThreads, VoiceChangerOutput *out) {
+#ifndef SOUNDTOUCH_FLOAT_SAMPLES
+    if (channels == 1) {
+        return voiceChangeSegmented(core, pcmIn, inFrames, numThreads, out);
+    }
+#endif
+    vcsdkcore::SAMPLETYPE *input = (vcsdkcore::SAMPLETYPE *)malloc((inFrames + 1) * sizeof(vcsdkcore::SAMPLETYPE));
+    if (input == NULL) {
+        return false;
+    }
+    for (size_t i = 0; i < inFrames; i ++) {
+        int value = (channels == 2) ? ((pcmIn[2 * i] + pcmIn[2 * i + 1]) >> 1) : pcmIn[i];
+#ifdef SOUNDTOUCH_FLOAT_SAMPLES
+        input[i] = value * (1.0f / 32768.0f);
+#else
+        input[i] = (short)value;
+#endif
+    }
+    bool result = voiceChangeSegmented(core, input, inFrames, numThreads, out);
+    free(input);
+    return result;
+}
+
+
+// 单声道16bit PCM输出格式
+static drwav_data_format monoOutputFormat(uint32_t sampleRate) {
+    drwav_data_format format;
+    format.container = drwav_container_riff;
+    format.format = DR_WAVE_FORMAT_PCM;
+    format.channels = 1;
+    format.sampleRate = (drwav_uint32) sampleRate;
+    format.bitsPerSample = 16;
+    return format;
+}
+
+
+// 打开WAV输入并按输入格式准备VCSDKCore，仅支持单声道和立体声
+static bool prepareWavInput(vcsdkcore::VCSDKCore *core, drwav *pWavIn) {
+    if (pWavIn == NULL) {
+        return false;
+    }
+    if (pWavIn->channels != 1 && pWavIn->channels != 2) {
+        return false;
+    }
+    core->clear();
+    core->setSampleRate(pWavIn->sampleRate);
+    return true;
+}
+
+
+uint64_t VoiceChangerSDKPublic::getOutputSampleCount(uint64_t inputSampleCount) {
+    return _vcsdkCore->getOutputSampleCount(inputSampleCount);
+}
+
+
 bool VoiceChangerSDKPublic::readFileToVoiceChanger(char *originAudioPath,char *outAudioPath) {
     
     bool isGenerateOutFile = false;
@@ -204,37 +643,143 @@ bool VoiceChangerSDKPublic::readFileToVoiceChanger(char *originAudioPath,char *o
     if (file != NULL) {
         // 文件已经存在
         // 移除文件
+        fclose(file);
         remove(outAudioPath);
     }
     
-    uint32_t sampleRate = 0;
-    uint64_t totalSampleCount = 0;
-    uint32_t channels = 0;
-    short *data_in = wavRead_s16(originAudioPath, &sampleRate, &totalSampleCount, &channels);
+    drwav *pWavIn = drwav_open_file(originAudioPath);
+    if (!prepareWavInput(_vcsdkCore, pWavIn)) {
+        drwav_close(pWavIn);
+        return false;
+    }
+    
+    // 输出长度由变声参数唯一确定，文件头一次写好，之后只做顺序追加
+    uint64_t outSampleCount = getOutputSampleCount(pWavIn->totalSampleCount / pWavIn->channels);
+    drwav_data_format format = monoOutputFormat(pWavIn->sampleRate);
     
-    _vcsdkCore->putSamples(data_in, totalSampleCount);
+    VoiceChangerOutput out = {};
+    out.pWav = drwav_open_file_write_sequential(outAudioPath, &format, outSampleCount);
+    if (out.pWav != NULL) {
+        // 若不想阻塞主线程，可在外部自己开设其他线程处理即可。
+        isGenerateOutFile = (_offlineThreads > 1) ? voiceChangeWavSegmented(_vcsdkCore, pWavIn, _offlineThreads, &out)
+                                                : voiceChangeWav(_vcsdkCore, pWavIn, &out);
+        drwav_close(out.pWav);
+    }
+    drwav_close(pWavIn);
     
+    return isGenerateOutFile;
+}
+
+
+size_t VoiceChangerSDKPublic::processPcmToVoiceChanger(const short *pcmIn, size_t inFrames, uint32_t channels, uint32_t sampleRate,
+                                                       short *pcmOut, size_t outCapacity) {
+    if (pcmIn == NULL || (channels != 1 && channels != 2) || sampleRate == 0) {
+        return 0;
+    }
+    _vcsdkCore->clear();
+    _vcsdkCore->setSampleRate(sampleRate);
     
-    short *samples = new short[totalSampleCount];
+    uint64_t outSampleCount = getOutputSampleCount(inFrames);
+    if (pcmOut == NULL || outCapacity < outSampleCount) {
+        return 0;
+    }
     
-    // 此处是一个cycle，不需要等待其他回调
-    // 在变声文件完成后，会自动走出循环
-    // 若不想阻塞主线程，可在外部自己开设其他线程处理即可。
-    int numSamples = 0;
-    do {
-        //
-        numSamples = _vcsdkCore->receiveSamples(samples,totalSampleCount);
-        
+    VoiceChangerOutput out = {};
+    out.pcm = pcmOut;
+    out.capacity = outCapacity;
+    bool ok = (_offlineThreads > 1) ? voiceChangePcmSegmented(_vcsdkCore, pcmIn, inFrames, channels, _offlineThreads, &out)
+                                    : voiceChangePcm(_vcsdkCore, pcmIn, inFrames, channels, &out);
+    if (!ok) {
+        return 0;
+    }
+    return out.written;
+}
 
-    } while (numSamples>0);
+
+size_t VoiceChangerSDKPublic::processWavToVoiceChanger(const void *wavData, size_t wavSize, short *pcmOut, size_t outCapacity,
+                                                       uint32_t *pSampleRate) {
+    size_t result = 0;
     
-    isGenerateOutFile = true;
+    drwav *pWavIn = drwav_open_memory(wavData, wavSize);
+    if (!prepareWavInput(_vcsdkCore, pWavIn)) {
+        drwav_close(pWavIn);
+        return 0;
+    }
+    if (pSampleRate != NULL) {
+        *pSampleRate = pWavIn->sampleRate;
+    }
     
-    wavWrite_s16(outAudioPath, samples, sampleRate, totalSampleCount);
+    uint64_t outSampleCount = getOutputSampleCount(pWavIn->totalSampleCount / pWavIn->channels);
+    if (pcmOut == NULL) {
+        // 仅查询所需的输出缓冲区大小
+        result = (size_t)outSampleCount;
+    } else if (outCapacity >= outSampleCount) {
+        VoiceChangerOutput out = {};
+        out.pcm = pcmOut;
+        out.capacity = outCapacity;
+        bool ok = (_offlineThreads > 1) ? voiceChangeWavSegmented(_vcsdkCore, pWavIn, _offlineThreads, &out)
+                                        : voiceChangeWav(_vcsdkCore, pWavIn, &out);
+        if (ok) {
+            result = out.written;
+        }
+    }
+    drwav_close(pWavIn);
     
-    delete [] samples;
+    return result;
+}
+
+
+bool VoiceChangerSDKPublic::processWavToWavData(const void *wavData, size_t wavSize, void **ppOutWavData, size_t *pOutWavSize) {
+    bool isGenerateOutData = false;
     
-    return isGenerateOutFile;
+    if (ppOutWavData == NULL || pOutWavSize == NULL) {
+        return false;
+    }
+    *ppOutWavData = NULL;
+    *pOutWavSize = 0;
+    
+    drwav *pWavIn = drwav_open_memory(wavData, wavSize);
+    if (!prepareWavInput(_vcsdkCore, pWavIn)) {
+        drwav_close(pWavIn);
+        return false;
+    }
+    
+    uint64_t outSampleCount = getOutputSampleCount(pWavIn->totalSampleCount / pWavIn->channels);
+    drwav_data_format format = monoOutputFormat(pWavIn->sampleRate);
+    
+    VoiceChangerOutput out = {};
+    out.pWav = drwav_open_memory_write_sequential(ppOutWavData, pOutWavSize, &format, outSampleCount);
+    if (out.pWav != NULL) {
+        isGenerateOutData = (_offlineThreads > 1) ? voiceChangeWavSegmented(_vcsdkCore, pWavIn, _offlineThreads, &out)
+                                                : voiceChangeWav(_vcsdkCore, pWavIn, &out);
+        // 关闭后*ppOutWavData/*pOutWavSize才是完整的WAV数据
+        drwav_close(out.pWav);
+    }
+    drwav_close(pWavIn);
+    
+    if (!isGenerateOutData) {
+        freeWavData(*ppOutWavData);
+        *ppOutWavData = NULL;
+        *pOutWavSize = 0;
+    }
+    return isGenerateOutData;
+}
+
+
+void VoiceChangerSDKPublic::freeWavData(void *wavData) {
+    drwav_free(wavData);
+}
+
+
+void VoiceChangerSDKPublic::setOfflineThreadCount(uint32_t numThreads) {
+    if (numThreads == 0) {
+        numThreads = std::thread::hardware_concurrency();
+    }
+    _offlineThreads = (numThreads > 0) ? numThreads : 1;
+}
+
+uint32_t VoiceChangerSDKPublic::getOfflineThreadCount() {
+    return _offlineThreads;
 }
 
 
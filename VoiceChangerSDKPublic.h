@@ -17,6 +17,8 @@
 #define VOICECHANGERSDKPUBLIC_H // VoiceChangerSDKPublic_h
 
 
+#include <stddef.h>
+#include <stdint.h>
 #include "VCSDKCore.h"
 
 
@@ -26,6 +28,19 @@ class VoiceChangerSDKPublic {
 private:
     class  vcsdkcore::VCSDKCore *_vcsdkCore;
     
+    // 固定帧模式
+    uint32_t _frameSize;
+    uint32_t _frameDelay;
+    uint32_t _framePrimeRemaining;
+    uint32_t _frameDeficit;
+    uint64_t _frameUnderruns;
+    
+    // 离线分段多线程
+    uint32_t _offlineThreads;
+    
+    // 拥有_vcsdkCore，不可复制
+    VoiceChangerSDKPublic(const VoiceChangerSDKPublic &);
+    VoiceChangerSDKPublic &operator=(const VoiceChangerSDKPublic &);
     
 
 public:
@@ -72,6 +87,91 @@ public:
     // 读取文件read file to get SampleBuffer
     bool readFileToVoiceChanger(char *originAudioPath,char *outAudioPath);
     
+    // 预测输出采样数: 以当前变声参数处理inputSampleCount个(单声道)采样点后，
+    // 输出的准确采样点数，可用于一次性分配输出缓冲区。
+    uint64_t getOutputSampleCount(uint64_t inputSampleCount);
+    
+    
+    /** 内存数据变声，无需临时文件。输出均为单声道16bit PCM，立体声输入会先混合为单声道。
+     *
+     *  1、processPcmToVoiceChanger: 输入交错的PCM数据及格式，输出到调用方提供的缓冲区，
+     *     outCapacity(采样点数)需不小于getOutputSampleCount(inFrames)。
+     *     返回写入的采样点数，失败返回0。
+     *  2、processWavToVoiceChanger: 输入内存中的WAV数据，输出PCM到调用方提供的缓冲区。
+     *     pcmOut传NULL时仅返回所需的缓冲区大小(采样点数)；pSampleRate可选，返回采样率。
+     *  3、processWavToWavData: 输入内存中的WAV数据，输出一个新的WAV数据块，
+     *     使用完毕后需调用freeWavData释放。
+     */
+    size_t processPcmToVoiceChanger(const short *pcmIn, size_t inFrames, uint32_t channels, uint32_t sampleRate,
+                                    short *pcmOut, size_t outCapacity);
+    
+    size_t processWavToVoiceChanger(const void *wavData, size_t wavSize, short *pcmOut, size_t outCapacity,
+                                    uint32_t *pSampleRate = NULL);
+    
+    bool processWavToWavData(const void *wavData, size_t wavSize, void **ppOutWavData, size_t *pOutWavSize);
+    
+    static void freeWavData(void *wavData);
+    
+    
+    /** 离线转换多线程: 文件/内存数据变声(readFileToVoiceChanger、processPcmToVoiceChanger、
+     *  processWavToVoiceChanger、processWavToWavData)把整段音频分段，在numThreads个线程上并行处理，
+     *  分段接缝处按相关性对齐后交叉淡化，输出长度与单线程相同。
+     *  需把整个输入读入内存；默认1为单线程逐块处理，传0使用全部CPU核。
+     */
+    void setOfflineThreadCount(uint32_t numThreads);
+    uint32_t getOfflineThreadCount();
+    
+    
+    /** 实时流式变声(单声道16bit PCM)，适用于10ms/20ms音频回调，稳定运行后不再分配内存。
+     *
+     *  1、setStreamSampleRate: 开始前设置输入采样率，同时清空内部缓冲；resetStream仅清空缓冲。
+     *  2、process: 输入n个采样点，输出最多cap个已处理完成的采样点，返回实际输出数；
+     *     in传NULL时只取输出。也可分开调用putSamples/receiveSamples。
+     *     输出的采样点数随内部处理批次变化，未取出的数据保留到下次调用。
+     *  3、getReadySampleCount: 可立即取出的采样点数；
+     *     getBufferedSampleCount: 仍缓存在内部的采样点数(待处理输入 + 未取出输出)。
+     *  4、flushStream: 流结束时冲出剩余数据。
+     *  5、流式输出与离线转换逐位一致，与每次输入的块大小无关。
+     *  6、Linux下每个实例占用约10个内存映射(环形缓冲区)，同时存在的实例超过约1600个后，
+     *     其余实例改用普通缓冲区，见VCSDKCoreType.h中的VCSDKCORE_MIRRORED_FIFO_MAX。
+     */
+    void setStreamSampleRate(uint32_t sampleRate);
+    void resetStream();
+    
+    void putSamples(const short *samples, uint length);
+    uint receiveSamples(short *buffer, uint length);
+    size_t process(const short *in, size_t n, short *out, size_t cap);
+    size_t flushStream(short *out, size_t cap);
+    
+    size_t getReadySampleCount();
+    size_t getBufferedSampleCount();
+    
+    
+    /** 固定帧模式(如Opus/WebRTC的10ms/20ms帧)，每次调用输入一帧、输出正好一帧。
+     *
+     *  1、setFrameMode: 设置采样率和帧长(采样点数，不超过4096)，同时清空内部缓冲。
+     *     需在变声种类配置之后调用，修改变声种类后需重新调用。
+     *  2、processFrame: in/out均为frameSize个采样点。开头先输出getFrameDelaySamples()个静音，
+     *     之后输出与输入一一对应，延时固定不变。
+     *  3、仅适用于tempo * rate == 1的变声种类(只变调不变速，如萝莉音、大叔音)，
+     *     否则输出会不足，此时补静音并返回false，getFrameUnderrunCount()计数。
+     */
+    bool setFrameMode(uint32_t sampleRate, uint32_t frameSize);
+    bool processFrame(const short *in, short *out);
+    uint32_t getFrameDelaySamples();
+    uint64_t getFrameUnderrunCount();
+    
+    
+    /** 延时控制(实时语音)
+     *
+     *  1、getLatencySamples: 以当前变声种类和参数，处理管道的最大延时(输出采样点数)。
+     *  2、setTargetLatencyMs: 按延时预算(如20ms)自动选择帧长/搜索窗/叠加长度，
+     *     代替默认的40/15/8ms，修改变声种类后自动重新选择；传0恢复默认参数。
+     *     预算过小无法满足时使用最短参数并返回false。
+     */
+    uint32_t getLatencySamples();
+    bool setTargetLatencyMs(uint32_t latencyMs);
+    
     
     // update version -- 每个变声种类功能
     